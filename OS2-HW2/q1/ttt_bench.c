@@ -0,0 +1,313 @@
+#define _GNU_SOURCE         // sched_setaffinity(), CPU_SET
+#include <stdio.h>          // Standard I/O library
+#include <stdlib.h>         // Standard library for general functions
+#include <string.h>         // String manipulation functions
+#include <unistd.h>         // dup()
+#include <fcntl.h>          // open()
+#include <getopt.h>         // Command line option parsing
+#include <math.h>           // sqrt()
+#include <sched.h>          // Pinning to a core
+#include <time.h>           // Monotonic clock
+
+/*
+ * Microbenchmarks of ttt's engine, linked against a copy's own ttt.c
+ * (built with -DTTT_NO_MAIN, leaving out its main()), so `make bench` in any copy measures that
+ * copy's functions. Each benchmark is calibrated until one repetition takes
+ * the target time (which also warms it up), then timed over several
+ * repetitions on a pinned core; ns/op is reported with its spread.
+ */
+
+#define SIZE 3           // Must match ttt.c
+#define INPUT_COUNT 256  // Boards and strategies cycled through, so no single input is measured
+#define MAX_REPS 100     // Most repetitions kept for the statistics
+
+// ttt.c's engine
+void initializeBoard(char board[SIZE][SIZE]);
+void displayBoard(char board[SIZE][SIZE]);
+int validateStrategy(const char *strategy);
+void getBoardIndices(int number, int *row, int *col);
+int isWinningMove(char board[SIZE][SIZE], char player);
+int isBoardFull(char board[SIZE][SIZE]);
+void makeAIMove(char board[SIZE][SIZE], const char *strategy, char aiMark);
+
+/**
+ * @brief A benchmark: a name and a loop running its operation a given number of times.
+ */
+struct benchmark {
+    const char *name;                   // Name in the report
+    long (*run)(long iterations);       // Runs the operation; returns a value so it is not optimized away
+};
+
+char boards[INPUT_COUNT][SIZE][SIZE];  // Positions from random play, some won, some full
+char strategies[INPUT_COUNT][10];      // Random valid AI strategies
+char players[INPUT_COUNT][10];         // Random orders in which scripted players pick slots
+volatile long sink;                    // Where results go, so the compiler keeps every call
+
+/**
+ * @brief Shuffles "123456789" into a random slot order.
+ *
+ * @param order Receives 9 digits and a terminator.
+ * @param seed State for rand_r().
+ */
+void random_order(char order[10], unsigned int *seed) {
+    strcpy(order, "123456789");
+    for (int i = 8; i > 0; i--) {
+        int j = rand_r(seed) % (i + 1);
+        char swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+}
+
+/**
+ * @brief Fills the inputs: strategies, player orders, and boards after 0 to 9 random moves.
+ */
+void make_inputs(void) {
+    unsigned int seed = 1;
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        random_order(strategies[i], &seed);
+        random_order(players[i], &seed);
+        initializeBoard(boards[i]);
+        int moves = i % 10;
+        for (int move = 0; move < moves; move++) {
+            int row, col;
+            getBoardIndices(players[i][move] - '0', &row, &col);
+            boards[i][row][col] = move % 2 == 0 ? 'X' : 'O';
+        }
+    }
+}
+
+/**
+ * @brief Plays a game the way ttt's main loop does, with a scripted player instead of scanf().
+ *
+ * @param strategy The AI's strategy.
+ * @param player The order in which the player picks free slots.
+ * @return int 1 if the AI won, -1 if it lost, 0 for a draw.
+ */
+int simulate_game(const char *strategy, const char *player) {
+    char board[SIZE][SIZE];
+    initializeBoard(board);
+    int next = 0;  // Next slot of player to try
+    while (1) {
+        makeAIMove(board, strategy, 'X');
+        displayBoard(board);
+        if (isWinningMove(board, 'X')) {
+            return 1;
+        }
+        if (isBoardFull(board)) {
+            return 0;
+        }
+
+        int row, col;
+        do {
+            getBoardIndices(player[next++] - '0', &row, &col);
+        } while (board[row][col] != ' ');
+        board[row][col] = 'O';
+        displayBoard(board);
+        if (isWinningMove(board, 'O')) {
+            return -1;
+        }
+        if (isBoardFull(board)) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief Checks positions for an AI win.
+ */
+long run_is_winning_move(long iterations) {
+    long total = 0;
+    for (long i = 0; i < iterations; i++) {
+        total += isWinningMove(boards[i % INPUT_COUNT], 'X');
+    }
+    return total;
+}
+
+/**
+ * @brief Checks positions for a full board.
+ */
+long run_is_board_full(long iterations) {
+    long total = 0;
+    for (long i = 0; i < iterations; i++) {
+        total += isBoardFull(boards[i % INPUT_COUNT]);
+    }
+    return total;
+}
+
+/**
+ * @brief Plays the AI's move on a copy of each position.
+ */
+long run_make_ai_move(long iterations) {
+    long total = 0;
+    char board[SIZE][SIZE];
+    for (long i = 0; i < iterations; i++) {
+        memcpy(board, boards[i % INPUT_COUNT], sizeof(board));
+        if (isBoardFull(board)) {
+            initializeBoard(board);  // makeAIMove() needs a free slot
+        }
+        makeAIMove(board, strategies[i % INPUT_COUNT], 'X');
+        total += board[1][1];
+    }
+    return total;
+}
+
+/**
+ * @brief Validates strategies, as ttt does with its argument.
+ */
+long run_validate_strategy(long iterations) {
+    long total = 0;
+    for (long i = 0; i < iterations; i++) {
+        total += validateStrategy(strategies[i % INPUT_COUNT]);
+    }
+    return total;
+}
+
+/**
+ * @brief Plays whole games, boards printed to /dev/null as ttt prints them.
+ */
+long run_game(long iterations) {
+    long total = 0;
+    for (long i = 0; i < iterations; i++) {
+        total += simulate_game(strategies[i % INPUT_COUNT], players[(i / INPUT_COUNT + i) % INPUT_COUNT]);
+    }
+    return total;
+}
+
+struct benchmark benchmarks[] = {
+    {"isWinningMove", run_is_winning_move},
+    {"isBoardFull", run_is_board_full},
+    {"makeAIMove", run_make_ai_move},
+    {"validateStrategy", run_validate_strategy},
+    {"game", run_game},
+};
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds.
+ */
+long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Times one repetition of a benchmark.
+ *
+ * @return long long Nanoseconds it took.
+ */
+long long time_run(const struct benchmark *benchmark, long iterations) {
+    long long start = now_ns();
+    sink = benchmark->run(iterations);
+    return now_ns() - start;
+}
+
+/**
+ * @brief Calibrates, warms up and times a benchmark, then prints its line of the report.
+ *
+ * Iterations double until one repetition takes target_ns; those runs are
+ * the warm-up. Then reps repetitions are timed.
+ *
+ * @param benchmark The benchmark.
+ * @param reps Timed repetitions.
+ * @param target_ns How long one repetition should take.
+ * @param report Where the report goes.
+ */
+void measure(const struct benchmark *benchmark, int reps, long long target_ns, FILE *report) {
+    long iterations = 1;
+    while (time_run(benchmark, iterations) < target_ns && iterations < (1L << 40)) {
+        iterations *= 2;
+    }
+
+    double per_op[MAX_REPS];
+    double sum = 0, min = 0, max = 0;
+    for (int r = 0; r < reps; r++) {
+        per_op[r] = (double)time_run(benchmark, iterations) / iterations;
+        sum += per_op[r];
+        min = r == 0 || per_op[r] < min ? per_op[r] : min;
+        max = r == 0 || per_op[r] > max ? per_op[r] : max;
+    }
+    double mean = sum / reps;
+    double variance = 0;
+    for (int r = 0; r < reps; r++) {
+        variance += (per_op[r] - mean) * (per_op[r] - mean);
+    }
+    variance = reps > 1 ? variance / (reps - 1) : 0;
+    double stddev = sqrt(variance);
+    fprintf(report, "%-18s %12.2f %10.2f %6.1f%% %12.2f %12.2f %12ld\n", benchmark->name, mean, stddev,
+            mean > 0 ? 100 * stddev / mean : 0, min, max, iterations);
+    fflush(report);
+}
+
+/**
+ * @brief Runs the benchmarks and prints ns/op with its spread.
+ *
+ * Options: -r repetitions (10), -t milliseconds per repetition (20),
+ * -c core to pin to (0; -1 leaves the thread unpinned), -b only the
+ * benchmarks whose name contains the text.
+ */
+int main(int argc, char *argv[]) {
+    int reps = 10;
+    long long target_ms = 20;
+    int cpu = 0;
+    const char *only = NULL;
+    int option;
+    while ((option = getopt(argc, argv, "r:t:c:b:")) != -1) {
+        switch (option) {
+            case 'r':
+                reps = atoi(optarg);
+                break;
+            case 't':
+                target_ms = atoll(optarg);
+                break;
+            case 'c':
+                cpu = atoi(optarg);
+                break;
+            case 'b':
+                only = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-r repetitions] [-t ms per repetition] [-c cpu] [-b name]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (reps < 1 || reps > MAX_REPS || target_ms < 1) {
+        fprintf(stderr, "Repetitions must be 1-%d and the time per repetition at least 1 ms\n", MAX_REPS);
+        exit(EXIT_FAILURE);
+    }
+
+    // The engine prints its moves and boards; send them to /dev/null and the report to the real stdout
+    FILE *report = fdopen(dup(STDOUT_FILENO), "w");
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (report == NULL || null_fd == -1) {
+        perror("Error redirecting the engine's output");
+        exit(EXIT_FAILURE);
+    }
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    // Pin to one core, so migrations and another core's clock speed do not show up as variance
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+            perror("Error pinning to the CPU");
+            exit(EXIT_FAILURE);
+        }
+        fprintf(report, "Pinned to CPU %d, %d repetitions of %lld ms\n", cpu, reps, target_ms);
+    } else {
+        fprintf(report, "Unpinned, %d repetitions of %lld ms\n", reps, target_ms);
+    }
+
+    make_inputs();
+    fprintf(report, "%-18s %12s %10s %7s %12s %12s %12s\n", "benchmark", "ns/op", "stddev", "rsd", "min", "max",
+            "iterations");
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        if (only == NULL || strstr(benchmarks[i].name, only) != NULL) {
+            measure(&benchmarks[i], reps, target_ms * 1000000LL, report);
+        }
+    }
+    fclose(report);
+    return 0;
+}
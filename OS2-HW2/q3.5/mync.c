@@ -8,6 +8,7 @@
 #include <netinet/in.h>
 #include <netdb.h>
 #include <arpa/inet.h>
+#include "buffer_pool.h"
 
 /**
  * @brief Sets up a TCP server on the specified port and waits for incoming connections.
@@ -154,15 +155,26 @@ void redirect_io(int input_fd, int output_fd, char *command) {
 /**
  * @brief Handles input and output streams
  * 
+ * Data is relayed through a ring buffer taken from a pool, so each readv()
+ * and writev() moves up to buffer_size bytes instead of a fixed 256.
+ * 
  * @param input_fd The file descriptor for input.
  * @param output_fd The file descriptor for output.
+ * @param buffer_size The ring buffer size for this session.
  */
-void handle_io(int input_fd, int output_fd) {
-    char buffer[256]; // Buffer to store data read from input
+void handle_io(int input_fd, int output_fd, size_t buffer_size) {
+    struct buffer_pool pool; // Pool bounded to the single ring this relay needs
+    buffer_pool_init(&pool, buffer_size);
+    struct ring_buffer *ring = buffer_pool_acquire(&pool, buffer_size);
+    if (ring == NULL) {
+        perror("buffer allocation failed"); // Print error message if the ring cannot be allocated
+        exit(1); // Exit the program
+    }
+
     ssize_t n; // Number of bytes read
     // Read data from input and write to output until end of file is reached
-    while ((n = read(input_fd, buffer, sizeof(buffer))) > 0) {
-        if (write(output_fd, buffer, n) != n) {
+    while ((n = ring_buffer_read_from(ring, input_fd)) > 0) {
+        if (ring_buffer_drain(ring, output_fd) == -1) {
             perror("write failed"); // Print error message if write fails
             exit(1); // Exit the program
         }
@@ -172,11 +184,14 @@ void handle_io(int input_fd, int output_fd) {
         perror("read failed"); // Print error message if read fails
         exit(1); // Exit the program
     }
+
+    buffer_pool_release(&pool, ring); // Return the ring to the pool
+    buffer_pool_destroy(&pool); // Free the pooled memory
 }
 
 int main(int argc, char *argv[]) {
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s [-e command] -i input_mode [-o output_mode] [-b bidirectional_mode]\n", argv[0]);
+        fprintf(stderr, "Usage: %s [-e command] -i input_mode [-o output_mode] [-b bidirectional_mode] [-s buffer_size]\n", argv[0]);
         exit(1); // Print usage message and exit if arguments are insufficient
     }
 
@@ -184,6 +199,7 @@ int main(int argc, char *argv[]) {
     int output_fd = STDOUT_FILENO; // Default output file descriptor
     char *command = NULL; // Command to execute
     int bidirectional = 0; // Flag to indicate bidirectional communication
+    size_t buffer_size = RING_MIN_SIZE; // Relay ring buffer size
 
     // Parse command-line arguments
     for (int i = 1; i < argc; i++) {
@@ -230,6 +246,20 @@ int main(int argc, char *argv[]) {
         } else if (strcmp(argv[i], "-e") == 0) { // Check for command option
             i++;
             command = argv[i]; // Set command to execute
+        } else if (strcmp(argv[i], "-s") == 0) { // Check for buffer size option
+            i++;
+            char *end;
+            unsigned long size = strtoul(argv[i], &end, 10); // Parse the size, allowing K/M suffixes
+            if (*end == 'k' || *end == 'K') {
+                size *= 1024;
+            } else if (*end == 'm' || *end == 'M') {
+                size *= 1024 * 1024;
+            }
+            if (size < RING_MIN_SIZE || size > RING_MAX_SIZE) {
+                fprintf(stderr, "Buffer size must be between 4K and 1M\n"); // Print error for out-of-range size
+                exit(1); // Exit the program
+            }
+            buffer_size = ring_size_round(size); // Round to a pool size class
         }
     }
 
@@ -241,7 +271,7 @@ int main(int argc, char *argv[]) {
             redirect_io(input_fd, output_fd, command); // Redirect IO for unidirectional communication
         }
     } else {
-        handle_io(input_fd, output_fd); // Handle IO for default input/output
+        handle_io(input_fd, output_fd, buffer_size); // Handle IO for default input/output
     }
 
     return 0; // Return success
@@ -180,6 +180,7 @@ void makePlayerMove(char board[SIZE][SIZE], char playerMark) {
     }
 }
 
+#ifndef TTT_NO_MAIN  // The engine benchmark links the game rules without main()
 /**
  * @brief The main function for the Tic-Tac-Toe game.
  * 
@@ -244,4 +245,5 @@ int main(int argc, char *argv[]) {
     }
 
     return 0;  // Return success
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,364 @@
+#define _GNU_SOURCE  // accept4()
+#include <stdio.h>            // Error messages
+#include <stdlib.h>           // Memory allocation
+#include <string.h>           // memcpy()
+#include <unistd.h>           // close()
+#include <errno.h>            // Error number definitions
+#include <sys/socket.h>       // sendmsg(), SO_ZEROCOPY, MSG_ZEROCOPY
+#include <netinet/in.h>       // IP_RECVERR
+#include <linux/errqueue.h>   // struct sock_extended_err
+#include "broadcast.h"
+#include "metrics.h"
+#include "log.h"
+
+/**
+ * @brief Drops one reference to a chunk, freeing it with the last.
+ */
+static void chunk_unref(struct broadcast_chunk *chunk) {
+    if (--chunk->refs == 0) {
+        free(chunk);
+    }
+}
+
+/**
+ * @brief Releases the references a watcher holds on every chunk from its cursor to the newest.
+ */
+static void watcher_release_queue(struct watcher *watcher) {
+    struct broadcast_chunk *chunk = watcher->cursor;
+    while (chunk != NULL) {
+        struct broadcast_chunk *next = chunk->next;
+        chunk_unref(chunk);
+        chunk = next;
+    }
+    watcher->cursor = NULL;
+    watcher->offset = 0;
+}
+
+/**
+ * @brief Disconnects a watcher and releases everything it holds.
+ *
+ * The connection is reset rather than closed gracefully, so unsent data is
+ * discarded at once. Zerocopy sends still in flight keep their pages pinned
+ * in the kernel, so their chunks can be released without waiting for the
+ * completions this socket will no longer report.
+ */
+static void watcher_drop(struct watcher *watcher) {
+    struct broadcast *broadcast = watcher->broadcast;
+    for (struct watcher **link = &broadcast->watchers; *link != NULL; link = &(*link)->next) {
+        if (*link == watcher) {
+            *link = watcher->next;
+            break;
+        }
+    }
+    watcher_release_queue(watcher);
+    for (int i = 0; i < watcher->inflight_count; i++) {
+        chunk_unref(watcher->inflight[(watcher->inflight_head + i) % BROADCAST_INFLIGHT_MAX].chunk);
+    }
+    event_loop_remove(broadcast->loop, watcher->fd);
+    setsockopt(watcher->fd, SOL_SOCKET, SO_LINGER, &(struct linger){1, 0}, sizeof(struct linger));
+    close(watcher->fd);
+    free(watcher);
+    metrics.watchers_active--;
+}
+
+/**
+ * @brief Jumps a watcher to the end of the stream, discarding every chunk it has not started.
+ */
+static void watcher_skip(struct watcher *watcher) {
+    watcher_release_queue(watcher);
+    metrics.watcher_bytes_skipped += watcher->broadcast->published - watcher->position;
+    watcher->position = watcher->broadcast->published;
+    watcher->skipping = 0;
+}
+
+/**
+ * @brief Marks n bytes from the cursor as sent, releasing each chunk as it is finished.
+ */
+static void watcher_advance(struct watcher *watcher, size_t n) {
+    watcher->position += n;
+    while (n > 0) {
+        size_t left = watcher->cursor->length - watcher->offset;
+        if (n < left) {
+            watcher->offset += n;
+            return;
+        }
+        n -= left;
+        struct broadcast_chunk *next = watcher->cursor->next;
+        chunk_unref(watcher->cursor);
+        watcher->cursor = next;
+        watcher->offset = 0;
+    }
+    if (watcher->skipping && watcher->offset == 0) {
+        watcher_skip(watcher);  // The partly sent chunk is finished; now skip the rest
+    }
+}
+
+/**
+ * @brief Records a zerocopy send so the chunks it covers outlive the kernel's use of them.
+ */
+static void watcher_track_zerocopy(struct watcher *watcher, struct broadcast_chunk *const *chunks, int count) {
+    for (int i = 0; i < count; i++) {
+        int slot = (watcher->inflight_head + watcher->inflight_count) % BROADCAST_INFLIGHT_MAX;
+        watcher->inflight[slot].id = watcher->zerocopy_next;
+        watcher->inflight[slot].chunk = chunks[i];
+        watcher->inflight_count++;
+        chunks[i]->refs++;
+    }
+    watcher->zerocopy_next++;
+    metrics.watcher_zerocopy_sends++;
+}
+
+/**
+ * @brief Releases the chunks of zerocopy sends the kernel reports as finished.
+ *
+ * @return int 0 once the error queue is empty, -1 if the socket has a real error.
+ */
+static int watcher_reap_zerocopy(struct watcher *watcher) {
+    for (;;) {
+        char control[128];
+        struct msghdr message = {0};
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        if (recvmsg(watcher->fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+            return errno == EAGAIN ? 0 : -1;
+        }
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            struct sock_extended_err *error = (struct sock_extended_err *)CMSG_DATA(cmsg);
+            if (error->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                return -1;
+            }
+            // Completions cover the id range [ee_info, ee_data] and arrive in order
+            while (watcher->inflight_count > 0 &&
+                   (int)(error->ee_data - watcher->inflight[watcher->inflight_head].id) >= 0) {
+                chunk_unref(watcher->inflight[watcher->inflight_head].chunk);
+                watcher->inflight_head = (watcher->inflight_head + 1) % BROADCAST_INFLIGHT_MAX;
+                watcher->inflight_count--;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Writes as much of a watcher's backlog as its socket takes without blocking.
+ *
+ * Up to BROADCAST_IOV_MAX chunks go out per sendmsg(). Large sends use
+ * MSG_ZEROCOPY when the socket supports it and there is room to track them.
+ *
+ * @return int 0 on success (including a full socket), -1 if the watcher was dropped.
+ */
+static int watcher_flush(struct watcher *watcher) {
+    while (watcher->cursor != NULL) {
+        struct iovec iov[BROADCAST_IOV_MAX];
+        struct broadcast_chunk *chunks[BROADCAST_IOV_MAX];
+        int count = 0;
+        size_t total = 0;
+        size_t offset = watcher->offset;
+        for (struct broadcast_chunk *chunk = watcher->cursor; chunk != NULL && count < BROADCAST_IOV_MAX;
+             chunk = chunk->next) {
+            iov[count].iov_base = chunk->data + offset;
+            iov[count].iov_len = chunk->length - offset;
+            chunks[count++] = chunk;
+            total += chunk->length - offset;
+            offset = 0;
+        }
+
+        int flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+        if (watcher->zerocopy && total >= BROADCAST_ZEROCOPY_MIN &&
+            watcher->inflight_count + count <= BROADCAST_INFLIGHT_MAX) {
+            flags |= MSG_ZEROCOPY;
+        }
+        struct msghdr message = {0};
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t n = sendmsg(watcher->fd, &message, flags);
+        if (n == -1 && errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+            watcher->zerocopy = 0;  // Out of pinned-page budget; copy from now on
+            continue;
+        }
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1 && errno == EAGAIN) {
+            break;
+        }
+        if (n == -1) {
+            watcher_drop(watcher);
+            return -1;
+        }
+        if (flags & MSG_ZEROCOPY) {
+            watcher_track_zerocopy(watcher, chunks, count);
+        }
+        metrics.watcher_bytes_out += n;
+        watcher_advance(watcher, n);
+    }
+
+    int writing = watcher->cursor != NULL;
+    if (writing != watcher->writing) {
+        event_loop_modify(watcher->broadcast->loop, watcher->fd, writing ? POLLIN | POLLOUT : POLLIN);
+        watcher->writing = writing;
+    }
+    return 0;
+}
+
+/**
+ * @brief Handles a watcher socket: drains its backlog, reaps zerocopy completions and notices hang-ups.
+ *
+ * Watchers are read-only; anything they send is discarded.
+ */
+static void watcher_event(struct event_loop *loop, int fd, short revents, void *data) {
+    struct watcher *watcher = data;
+    if ((revents & POLLERR) && watcher_reap_zerocopy(watcher) == -1) {
+        watcher_drop(watcher);
+        return;
+    }
+    if (revents & (POLLIN | POLLHUP)) {
+        char discard[512];
+        ssize_t n = recv(fd, discard, sizeof(discard), MSG_DONTWAIT);
+        if (n == 0 || (n == -1 && errno != EAGAIN && errno != EINTR)) {
+            watcher_drop(watcher);
+            return;
+        }
+    }
+    if (revents & POLLOUT) {
+        watcher_flush(watcher);
+    }
+}
+
+/**
+ * @brief Initializes a broadcast with no watchers.
+ *
+ * @param broadcast The broadcast.
+ * @param loop The event loop watcher sockets are served from.
+ * @param lag_limit Bytes a watcher may fall behind before lag_policy applies.
+ * @param lag_policy Whether a lagging watcher is dropped or skipped ahead.
+ */
+void broadcast_init(struct broadcast *broadcast, struct event_loop *loop, size_t lag_limit,
+                    enum broadcast_lag_policy lag_policy) {
+    broadcast->loop = loop;
+    broadcast->watchers = NULL;
+    broadcast->newest = NULL;
+    broadcast->published = 0;
+    broadcast->lag_limit = lag_limit;
+    broadcast->lag_policy = lag_policy;
+}
+
+/**
+ * @brief Adds a connected stream socket as a watcher. It receives the stream from the next chunk published.
+ *
+ * @param broadcast The broadcast.
+ * @param fd A connected, non-blocking stream socket; owned by the broadcast from now on.
+ * @return int 0 on success, -1 if the watcher could not be registered (fd is closed).
+ */
+int broadcast_add_watcher(struct broadcast *broadcast, int fd) {
+    struct watcher *watcher = calloc(1, sizeof(*watcher));
+    if (watcher == NULL || event_loop_add(broadcast->loop, fd, POLLIN, watcher_event, watcher) == -1) {
+        free(watcher);
+        close(fd);
+        return -1;
+    }
+    watcher->fd = fd;
+    watcher->broadcast = broadcast;
+    watcher->position = broadcast->published;
+    // Only TCP sockets accept SO_ZEROCOPY; Unix sockets copy
+    watcher->zerocopy = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &(int){1}, sizeof(int)) == 0;
+    watcher->next = broadcast->watchers;
+    broadcast->watchers = watcher;
+    metrics.watchers_active++;
+    return 0;
+}
+
+/**
+ * @brief Publishes bytes to every watcher.
+ *
+ * The bytes are copied once into a shared chunk. Watchers with an empty
+ * backlog are written immediately; a watcher more than lag_limit bytes
+ * behind is dropped or skipped ahead.
+ *
+ * @param broadcast The broadcast.
+ * @param iov The bytes, possibly in several pieces.
+ * @param iovcnt Number of pieces.
+ */
+void broadcast_publish(struct broadcast *broadcast, const struct iovec *iov, int iovcnt) {
+    size_t length = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        length += iov[i].iov_len;
+    }
+    if (broadcast->watchers == NULL) {
+        broadcast->published += length;  // Nobody to copy for
+        return;
+    }
+    struct broadcast_chunk *chunk = malloc(sizeof(*chunk) + length);
+    if (chunk == NULL) {
+        log_error("Error allocating a broadcast chunk: %s", strerror(errno));
+        return;  // Watchers miss this piece rather than stall the game
+    }
+    chunk->next = NULL;
+    chunk->length = 0;
+    chunk->refs = 1;  // The broadcast's reference while it is the newest chunk
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(chunk->data + chunk->length, iov[i].iov_base, iov[i].iov_len);
+        chunk->length += iov[i].iov_len;
+    }
+    if (broadcast->newest != NULL) {
+        broadcast->newest->next = chunk;
+        chunk_unref(broadcast->newest);
+    }
+    broadcast->newest = chunk;
+    broadcast->published += length;
+
+    struct watcher *watcher = broadcast->watchers;
+    while (watcher != NULL) {
+        struct watcher *next = watcher->next;  // The watcher may be dropped below
+        chunk->refs++;
+        if (watcher->cursor == NULL) {
+            watcher->cursor = chunk;  // Caught up, so this chunk starts its backlog
+            watcher->offset = 0;
+        }
+        if (broadcast->published - watcher->position > broadcast->lag_limit) {
+            if (broadcast->lag_policy == BROADCAST_DROP) {
+                metrics.watchers_dropped++;
+                watcher_drop(watcher);
+                watcher = next;
+                continue;
+            }
+            if (watcher->offset == 0) {
+                watcher_skip(watcher);
+            } else {
+                watcher->skipping = 1;  // Finish the partly sent chunk first so the stream is not torn
+            }
+        }
+        if (watcher->cursor == chunk && watcher->offset == 0) {
+            watcher_flush(watcher);
+        }
+        watcher = next;
+    }
+}
+
+/**
+ * @brief Accepts watcher connections on a listener.
+ */
+static void broadcast_accept_event(struct event_loop *loop, int fd, short revents, void *data) {
+    int watcher_fd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (watcher_fd == -1) {
+        return;  // EAGAIN or a connection that went away before accept
+    }
+    metrics.connections_accepted++;
+    broadcast_add_watcher(data, watcher_fd);
+}
+
+/**
+ * @brief Serves watcher connections from a listening socket.
+ *
+ * @param broadcast The broadcast new watchers join.
+ * @param listen_fd A non-blocking listening stream socket.
+ */
+void broadcast_serve(struct broadcast *broadcast, int listen_fd) {
+    if (event_loop_add(broadcast->loop, listen_fd, POLLIN, broadcast_accept_event, broadcast) == -1) {
+        perror("Error registering watcher listener");
+        exit(1);
+    }
+}
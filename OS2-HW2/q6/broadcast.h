@@ -0,0 +1,87 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <stddef.h>   // size_t
+#include <sys/uio.h>  // struct iovec
+#include "event_loop.h"
+
+#define BROADCAST_IOV_MAX 16          // Chunks gathered into one sendmsg() per watcher
+#define BROADCAST_ZEROCOPY_MIN 16384  // Sends at least this large use MSG_ZEROCOPY where the socket allows it
+#define BROADCAST_INFLIGHT_MAX 64     // Chunk references held for unfinished zerocopy sends, per watcher
+
+/**
+ * @brief One published piece of the stream, shared by every watcher instead of copied per watcher.
+ *
+ * Chunks are linked in publish order. Each holds one reference per watcher
+ * that has yet to send it, one per unfinished zerocopy send that covers it,
+ * and one from the broadcast while it is the newest chunk.
+ */
+struct broadcast_chunk {
+    struct broadcast_chunk *next;  // Next chunk in publish order, NULL for the newest
+    unsigned int refs;             // Holders; freed when it drops to zero
+    size_t length;                 // Bytes in data
+    char data[];                   // The bytes, copied once when published
+};
+
+/**
+ * @brief What happens to a watcher that falls more than the lag limit behind.
+ */
+enum broadcast_lag_policy {
+    BROADCAST_DROP,  // Disconnect it
+    BROADCAST_SKIP,  // Discard what it has not sent and resume at the next chunk published
+};
+
+struct broadcast;
+
+/**
+ * @brief A zerocopy send whose pages the kernel may still be reading.
+ */
+struct broadcast_inflight {
+    unsigned int id;                // Completion id the kernel assigned to the send
+    struct broadcast_chunk *chunk;  // Chunk kept alive until the id completes
+};
+
+/**
+ * @brief A read-only peer receiving the broadcast stream.
+ */
+struct watcher {
+    int fd;                            // Non-blocking stream socket
+    struct broadcast *broadcast;       // The stream it watches
+    struct broadcast_chunk *cursor;    // First chunk not fully sent; NULL when caught up
+    size_t offset;                     // Bytes of cursor already sent
+    unsigned long long position;       // Stream bytes sent or skipped so far
+    int skipping;                      // Skip ahead once the partly sent cursor is finished
+    int zerocopy;                      // SO_ZEROCOPY is enabled on fd
+    unsigned int zerocopy_next;        // Id the kernel gives the next zerocopy send
+    struct broadcast_inflight inflight[BROADCAST_INFLIGHT_MAX];  // Unfinished zerocopy sends, oldest first
+    int inflight_head;                 // Index of the oldest entry
+    int inflight_count;                // Entries in use
+    int writing;                       // POLLOUT is requested
+    struct watcher *next;              // Next watcher of the broadcast
+};
+
+/**
+ * @brief A byte stream fanned out to any number of watchers.
+ *
+ * Publishing copies the bytes once into a chunk and writes them to every
+ * watcher that can take them without blocking; the rest are sent from the
+ * event loop as their sockets drain. A watcher that falls more than
+ * lag_limit bytes behind is dropped or skipped ahead, so a slow watcher
+ * never holds back the publisher.
+ */
+struct broadcast {
+    struct event_loop *loop;               // Loop the watcher sockets are registered with
+    struct watcher *watchers;              // Connected watchers
+    struct broadcast_chunk *newest;        // Last chunk published, referenced so the next can be linked to it
+    unsigned long long published;          // Stream bytes published so far
+    size_t lag_limit;                      // Bytes a watcher may fall behind
+    enum broadcast_lag_policy lag_policy;  // Applied past lag_limit
+};
+
+void broadcast_init(struct broadcast *broadcast, struct event_loop *loop, size_t lag_limit,
+                    enum broadcast_lag_policy lag_policy);
+int broadcast_add_watcher(struct broadcast *broadcast, int fd);
+void broadcast_publish(struct broadcast *broadcast, const struct iovec *iov, int iovcnt);
+void broadcast_serve(struct broadcast *broadcast, int listen_fd);
+
+#endif
@@ -0,0 +1,242 @@
+#include <stdlib.h>   // Memory allocation
+#include <errno.h>    // Error number definitions
+#include <sys/uio.h>  // Scatter/gather I/O (readv/writev)
+#include "buffer_pool.h"
+
+/**
+ * @brief Rounds a requested buffer size to the pool's power-of-two size class.
+ *
+ * @param size The requested size in bytes.
+ * @return size_t The size clamped to [RING_MIN_SIZE, RING_MAX_SIZE] and rounded up to a power of two.
+ */
+size_t ring_size_round(size_t size) {
+    size_t rounded = RING_MIN_SIZE;
+    while (rounded < size && rounded < RING_MAX_SIZE) {
+        rounded <<= 1;  // Double until the request fits or the maximum is reached
+    }
+    return rounded;
+}
+
+/**
+ * @brief Maps a rounded buffer size to its free-list index.
+ *
+ * @param size A size returned by ring_size_round().
+ * @return int The size class index.
+ */
+static int ring_size_class(size_t size) {
+    int index = 0;
+    while ((size_t)RING_MIN_SIZE << index < size) {
+        index++;
+    }
+    return index;
+}
+
+/**
+ * @brief Initializes an empty buffer pool.
+ *
+ * @param pool The pool to initialize.
+ * @param max_bytes Upper bound on buffer memory owned by the pool, 0 for no bound.
+ */
+void buffer_pool_init(struct buffer_pool *pool, size_t max_bytes) {
+    for (int i = 0; i < RING_SIZE_CLASSES; i++) {
+        pool->free_lists[i] = NULL;
+    }
+    pool->max_bytes = max_bytes;
+    pool->allocated_bytes = 0;
+}
+
+/**
+ * @brief Frees every idle buffer held by the pool.
+ *
+ * Buffers still acquired by callers are not tracked and must be released first.
+ *
+ * @param pool The pool to destroy.
+ */
+void buffer_pool_destroy(struct buffer_pool *pool) {
+    for (int i = 0; i < RING_SIZE_CLASSES; i++) {
+        struct ring_buffer *ring = pool->free_lists[i];
+        while (ring != NULL) {
+            struct ring_buffer *next = ring->next_free;
+            pool->allocated_bytes -= ring->capacity;
+            free(ring->data);
+            free(ring);
+            ring = next;
+        }
+        pool->free_lists[i] = NULL;
+    }
+}
+
+/**
+ * @brief Takes an empty ring buffer of at least the given size from the pool.
+ *
+ * @param pool The pool to take the buffer from.
+ * @param size The requested capacity in bytes (rounded to a size class).
+ * @return struct ring_buffer* The buffer, or NULL if the memory bound would be exceeded or allocation fails.
+ */
+struct ring_buffer *buffer_pool_acquire(struct buffer_pool *pool, size_t size) {
+    size_t capacity = ring_size_round(size);
+    int index = ring_size_class(capacity);
+
+    // Reuse an idle buffer of the same class if there is one
+    struct ring_buffer *ring = pool->free_lists[index];
+    if (ring != NULL) {
+        pool->free_lists[index] = ring->next_free;
+    } else {
+        if (pool->max_bytes != 0 && pool->allocated_bytes + capacity > pool->max_bytes) {
+            errno = ENOBUFS;
+            return NULL;  // Keep memory use bounded
+        }
+        ring = malloc(sizeof(*ring));
+        if (ring == NULL) {
+            return NULL;
+        }
+        ring->data = malloc(capacity);
+        if (ring->data == NULL) {
+            free(ring);
+            return NULL;
+        }
+        ring->capacity = capacity;
+        pool->allocated_bytes += capacity;
+    }
+
+    ring->head = 0;
+    ring->tail = 0;
+    ring->next_free = NULL;
+    return ring;
+}
+
+/**
+ * @brief Returns a ring buffer to the pool for reuse.
+ *
+ * @param pool The pool the buffer was acquired from.
+ * @param ring The buffer to release (may be NULL).
+ */
+void buffer_pool_release(struct buffer_pool *pool, struct ring_buffer *ring) {
+    if (ring == NULL) {
+        return;
+    }
+    int index = ring_size_class(ring->capacity);
+    ring->next_free = pool->free_lists[index];
+    pool->free_lists[index] = ring;
+}
+
+/**
+ * @brief Returns the number of buffered bytes waiting to be written.
+ *
+ * @param ring The ring buffer.
+ * @return size_t The number of used bytes.
+ */
+size_t ring_buffer_used(const struct ring_buffer *ring) {
+    return ring->tail - ring->head;
+}
+
+/**
+ * @brief Returns the number of bytes that can still be read into the ring.
+ *
+ * @param ring The ring buffer.
+ * @return size_t The number of free bytes.
+ */
+size_t ring_buffer_space(const struct ring_buffer *ring) {
+    return ring->capacity - ring_buffer_used(ring);
+}
+
+/**
+ * @brief Reads from a descriptor into the free space of the ring.
+ *
+ * The free space may wrap around the end of the array, so it is described
+ * by up to two iovecs and filled with a single readv().
+ *
+ * @param ring The ring buffer to fill.
+ * @param fd The descriptor to read from.
+ * @return ssize_t The result of readv(), or 0 if the ring is full.
+ */
+ssize_t ring_buffer_read_from(struct ring_buffer *ring, int fd) {
+    size_t space = ring_buffer_space(ring);
+    if (space == 0) {
+        return 0;
+    }
+
+    size_t mask = ring->capacity - 1;
+    size_t start = ring->tail & mask;
+    size_t first = ring->capacity - start;  // Contiguous bytes before the wrap point
+    if (first > space) {
+        first = space;
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_base = ring->data + start;
+    iov[0].iov_len = first;
+    iov[1].iov_base = ring->data;
+    iov[1].iov_len = space - first;
+
+    ssize_t n = readv(fd, iov, iov[1].iov_len > 0 ? 2 : 1);
+    if (n > 0) {
+        ring->tail += n;
+    }
+    return n;
+}
+
+/**
+ * @brief Writes buffered bytes from the ring to a descriptor.
+ *
+ * Like ring_buffer_read_from(), the used region is passed to a single writev()
+ * even when it wraps around the end of the array.
+ *
+ * @param ring The ring buffer to drain.
+ * @param fd The descriptor to write to.
+ * @return ssize_t The result of writev(), or 0 if the ring is empty.
+ */
+ssize_t ring_buffer_write_to(struct ring_buffer *ring, int fd) {
+    size_t used = ring_buffer_used(ring);
+    if (used == 0) {
+        return 0;
+    }
+
+    size_t mask = ring->capacity - 1;
+    size_t start = ring->head & mask;
+    size_t first = ring->capacity - start;  // Contiguous bytes before the wrap point
+    if (first > used) {
+        first = used;
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_base = ring->data + start;
+    iov[0].iov_len = first;
+    iov[1].iov_base = ring->data;
+    iov[1].iov_len = used - first;
+
+    ssize_t n = writev(fd, iov, iov[1].iov_len > 0 ? 2 : 1);
+    if (n > 0) {
+        ring->head += n;
+    }
+    return n;
+}
+
+/**
+ * @brief Writes everything buffered in the ring, retrying on partial writes.
+ *
+ * On a non-blocking descriptor it stops once the descriptor is full; what
+ * is left stays in the ring for the next call.
+ *
+ * @param ring The ring buffer to drain.
+ * @param fd The descriptor to write to.
+ * @return int The number of writev() calls that wrote data, or -1 on a write error (errno is set).
+ */
+int ring_buffer_drain(struct ring_buffer *ring, int fd) {
+    int writes = 0;
+    while (ring_buffer_used(ring) > 0) {
+        ssize_t n = ring_buffer_write_to(ring, fd);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return writes;
+            }
+            return -1;
+        }
+        writes++;
+    }
+    ring->head = ring->tail = 0;  // Empty ring: restart at offset 0 so the next read is contiguous
+    return writes;
+}
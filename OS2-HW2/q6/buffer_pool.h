@@ -0,0 +1,49 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>     // size_t
+#include <sys/types.h>  // ssize_t
+
+#define RING_MIN_SIZE (4 * 1024)     // Smallest ring buffer handed out by the pool (4 KB)
+#define RING_MAX_SIZE (1024 * 1024)  // Largest ring buffer handed out by the pool (1 MB)
+#define RING_SIZE_CLASSES 9          // Power-of-two size classes from 4 KB to 1 MB
+
+/**
+ * @brief A single-reader/single-writer byte ring backed by a power-of-two array.
+ *
+ * head and tail are free-running counters; the used region is [head, tail).
+ */
+struct ring_buffer {
+    char *data;                     // Backing storage
+    size_t capacity;                // Size of data, always a power of two
+    size_t head;                    // Total bytes consumed
+    size_t tail;                    // Total bytes produced
+    struct ring_buffer *next_free;  // Link in the pool free list while unused
+};
+
+/**
+ * @brief A pool of reusable ring buffers grouped by size class.
+ *
+ * Released buffers are kept on a per-class free list and handed out again,
+ * so steady-state relaying never touches the allocator. The total bytes ever
+ * allocated are capped by max_bytes.
+ */
+struct buffer_pool {
+    struct ring_buffer *free_lists[RING_SIZE_CLASSES];  // Idle buffers per size class
+    size_t max_bytes;        // Upper bound on allocated buffer memory (0 = unlimited)
+    size_t allocated_bytes;  // Buffer memory currently owned by the pool
+};
+
+size_t ring_size_round(size_t size);
+void buffer_pool_init(struct buffer_pool *pool, size_t max_bytes);
+void buffer_pool_destroy(struct buffer_pool *pool);
+struct ring_buffer *buffer_pool_acquire(struct buffer_pool *pool, size_t size);
+void buffer_pool_release(struct buffer_pool *pool, struct ring_buffer *ring);
+
+size_t ring_buffer_used(const struct ring_buffer *ring);
+size_t ring_buffer_space(const struct ring_buffer *ring);
+ssize_t ring_buffer_read_from(struct ring_buffer *ring, int fd);
+ssize_t ring_buffer_write_to(struct ring_buffer *ring, int fd);
+int ring_buffer_drain(struct ring_buffer *ring, int fd);
+
+#endif
@@ -0,0 +1,143 @@
+#define _GNU_SOURCE  // wait4()
+#include <stdio.h>         // Error messages
+#include <stdlib.h>        // exit()
+#include <unistd.h>        // close(), syscall()
+#include <errno.h>         // Error number definitions
+#include <signal.h>        // Signal masks
+#include <time.h>          // Monotonic clock
+#include <sys/wait.h>      // wait4()
+#include <sys/syscall.h>   // SYS_pidfd_open
+#include <sys/signalfd.h>  // signalfd() fallback for kernels without pidfd
+#include "child_watch.h"
+
+static struct child_process *watched = NULL;  // Children not yet reaped
+static int sigchld_fd = -1;                   // SIGCHLD signalfd, created on first fallback
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds.
+ */
+static long long child_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Reaps a child if it has exited, then runs its exit callback.
+ *
+ * @return int 1 if the child was reaped, 0 if it is still running.
+ */
+static int child_reap(struct event_loop *loop, struct child_process *child) {
+    pid_t reaped = wait4(child->pid, &child->status, WNOHANG, &child->usage);
+    if (reaped != child->pid) {
+        return 0;
+    }
+    child->runtime_ns = child_clock_ns() - child->start_ns;
+
+    // Stop watching before the callback, which may free the child
+    for (struct child_process **link = &watched; *link != NULL; link = &(*link)->next) {
+        if (*link == child) {
+            *link = child->next;
+            break;
+        }
+    }
+    if (child->pidfd != -1) {
+        event_loop_remove(loop, child->pidfd);
+        close(child->pidfd);
+        child->pidfd = -1;
+    }
+    child->on_exit(child, child->data);
+    return 1;
+}
+
+/**
+ * @brief Handles a readable pidfd: the child has exited.
+ */
+static void child_pidfd_event(struct event_loop *loop, int fd, short revents, void *data) {
+    child_reap(loop, data);
+}
+
+/**
+ * @brief Handles the SIGCHLD signalfd: tries to reap every child watched without a pidfd.
+ */
+static void child_signalfd_event(struct event_loop *loop, int fd, short revents, void *data) {
+    struct signalfd_siginfo info;
+    while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+        // Signals coalesce, so the list below is scanned regardless of how many arrived
+    }
+    struct child_process *child = watched;
+    while (child != NULL) {
+        struct child_process *next = child->next;  // child_reap() may unlink and free child
+        if (child->pidfd == -1) {
+            child_reap(loop, child);
+        }
+        child = next;
+    }
+}
+
+/**
+ * @brief Creates the SIGCHLD signalfd used when pidfd_open() is unavailable.
+ *
+ * SIGCHLD is blocked so it is only delivered through the descriptor; spawned
+ * commands must unblock it before exec.
+ */
+static void child_signalfd_open(struct event_loop *loop) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1) {
+        perror("Error blocking SIGCHLD");
+        exit(1);
+    }
+    sigchld_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sigchld_fd == -1) {
+        perror("Error creating SIGCHLD signalfd");
+        exit(1);
+    }
+    if (event_loop_add(loop, sigchld_fd, POLLIN, child_signalfd_event, NULL) == -1) {
+        perror("Error registering SIGCHLD signalfd");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Supervises a child from the event loop instead of blocking in wait().
+ *
+ * Uses a pidfd, which becomes readable when the child exits. On kernels
+ * without pidfd_open() it falls back to one shared SIGCHLD signalfd. Either
+ * way the child is reaped with wait4() so its resource usage is recorded.
+ *
+ * @param loop The event loop.
+ * @param child Storage for the child's state; must stay valid until on_exit runs.
+ * @param pid The child's process id.
+ * @param on_exit Run once the child has been reaped.
+ * @param data Passed to on_exit.
+ */
+void child_watch(struct event_loop *loop, struct child_process *child, pid_t pid,
+                 child_exit_handler on_exit, void *data) {
+    child->pid = pid;
+    child->start_ns = child_clock_ns();
+    child->runtime_ns = 0;
+    child->status = 0;
+    child->on_exit = on_exit;
+    child->data = data;
+    child->next = watched;
+    watched = child;
+
+    child->pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (child->pidfd != -1) {
+        if (event_loop_add(loop, child->pidfd, POLLIN, child_pidfd_event, child) == -1) {
+            perror("Error registering pidfd");
+            exit(1);
+        }
+        return;
+    }
+    if (errno != ENOSYS) {
+        perror("Error opening pidfd");
+        exit(1);
+    }
+    if (sigchld_fd == -1) {
+        child_signalfd_open(loop);
+    }
+    child_reap(loop, child);  // It may have exited before SIGCHLD was blocked
+}
@@ -0,0 +1,38 @@
+#ifndef CHILD_WATCH_H
+#define CHILD_WATCH_H
+
+#include <sys/types.h>     // pid_t
+#include <sys/resource.h>  // struct rusage
+#include "event_loop.h"
+
+struct child_process;
+
+/**
+ * @brief Callback run once a watched child has been reaped.
+ *
+ * The child is no longer watched when it runs, so the callback may free it.
+ *
+ * @param child The reaped child, with status, runtime and usage filled in.
+ * @param data The pointer given to child_watch().
+ */
+typedef void (*child_exit_handler)(struct child_process *child, void *data);
+
+/**
+ * @brief A child process supervised by the event loop, embedded in its owner (e.g. a session).
+ */
+struct child_process {
+    pid_t pid;                     // Process id
+    int pidfd;                     // Readable once the child exits; -1 when the SIGCHLD signalfd is used
+    long long start_ns;            // Monotonic time the watch started
+    long long runtime_ns;          // Wall-clock lifetime, set when reaped
+    int status;                    // wait() status, set when reaped
+    struct rusage usage;           // Resources the child used, set when reaped
+    child_exit_handler on_exit;    // Run after the child is reaped
+    void *data;                    // Passed to on_exit
+    struct child_process *next;    // Next watched child
+};
+
+void child_watch(struct event_loop *loop, struct child_process *child, pid_t pid,
+                 child_exit_handler on_exit, void *data);
+
+#endif
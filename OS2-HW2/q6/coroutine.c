@@ -0,0 +1,280 @@
+#include <stdlib.h>    // Memory allocation
+#include <unistd.h>    // read(), write(), sysconf()
+#include <errno.h>     // Error number definitions
+#include <sys/mman.h>  // Stack mappings
+#include "coroutine.h"
+
+#ifndef COROUTINE_UCONTEXT
+/*
+ * Saves the callee-saved registers on the current stack, stores the stack
+ * pointer in *save_sp, switches to load_sp and restores the registers saved
+ * there. Everything else is caller-saved under the System V ABI, so this is
+ * a complete context switch without the signal-mask system call that
+ * swapcontext() makes.
+ */
+void coroutine_switch(void **save_sp, void *load_sp);
+__asm__(
+    ".text\n"
+    ".globl coroutine_switch\n"
+    ".type coroutine_switch, @function\n"
+    "coroutine_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size coroutine_switch, .-coroutine_switch\n");
+#endif
+
+static struct coroutine *starting;  // Coroutine whose entry is running for the first time
+
+/**
+ * @brief Switches from the resumer to a coroutine.
+ */
+static void coroutine_enter(struct coroutine *coroutine) {
+#ifdef COROUTINE_UCONTEXT
+    swapcontext(&coroutine->resumer_context, &coroutine->context);
+#else
+    coroutine_switch(&coroutine->resumer_sp, coroutine->sp);
+#endif
+}
+
+/**
+ * @brief Switches from a coroutine back to its resumer.
+ */
+static void coroutine_leave(struct coroutine *coroutine) {
+#ifdef COROUTINE_UCONTEXT
+    swapcontext(&coroutine->context, &coroutine->resumer_context);
+#else
+    coroutine_switch(&coroutine->sp, coroutine->resumer_sp);
+#endif
+}
+
+/**
+ * @brief First code run on a coroutine's stack: runs the body, then switches back for good.
+ */
+static void coroutine_entry(void) {
+    struct coroutine *coroutine = starting;
+    coroutine->body(coroutine, coroutine->arg);
+    coroutine->finished = 1;
+    coroutine_leave(coroutine);  // Never resumed again
+    abort();
+}
+
+/**
+ * @brief Returns the size of a stack mapping: the usable stack plus one guard page.
+ */
+static size_t coroutine_mapping_size(void) {
+    return COROUTINE_STACK_SIZE + sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * @brief Initializes an empty pool.
+ *
+ * @param pool The pool.
+ * @param loop The loop that resumes coroutines waiting on descriptors.
+ */
+void coroutine_pool_init(struct coroutine_pool *pool, struct event_loop *loop) {
+    pool->loop = loop;
+    pool->free_list = NULL;
+    pool->idle = 0;
+    pool->active = 0;
+}
+
+/**
+ * @brief Creates a coroutine on a pooled stack. It does not run until coroutine_resume().
+ *
+ * @param pool The pool.
+ * @param body The code to run.
+ * @param done Called by the resumer after body returns, or NULL.
+ * @param arg Passed to body and done.
+ * @return struct coroutine* The coroutine, or NULL if no stack could be mapped.
+ */
+struct coroutine *coroutine_create(struct coroutine_pool *pool, coroutine_fn body, coroutine_fn done, void *arg) {
+    struct coroutine *coroutine = pool->free_list;
+    if (coroutine != NULL) {
+        pool->free_list = coroutine->next_free;
+        pool->idle--;
+    } else {
+        coroutine = malloc(sizeof(*coroutine));
+        if (coroutine == NULL) {
+            return NULL;
+        }
+        // The lowest page stays inaccessible, so an overflow faults instead of corrupting memory
+        coroutine->stack = mmap(NULL, coroutine_mapping_size(), PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (coroutine->stack == MAP_FAILED) {
+            free(coroutine);
+            return NULL;
+        }
+        mprotect(coroutine->stack, sysconf(_SC_PAGESIZE), PROT_NONE);
+    }
+    coroutine->pool = pool;
+    coroutine->body = body;
+    coroutine->done = done;
+    coroutine->arg = arg;
+    coroutine->finished = 0;
+    coroutine->waiting_handle = -1;
+
+#ifdef COROUTINE_UCONTEXT
+    getcontext(&coroutine->context);
+    coroutine->context.uc_stack.ss_sp = coroutine->stack + sysconf(_SC_PAGESIZE);
+    coroutine->context.uc_stack.ss_size = COROUTINE_STACK_SIZE;
+    coroutine->context.uc_link = NULL;  // coroutine_entry() never returns
+    makecontext(&coroutine->context, coroutine_entry, 0);
+#else
+    // Lay out the frame coroutine_switch() pops: six registers, then coroutine_entry as the return
+    // address, then a dummy return address so coroutine_entry starts with the ABI's stack alignment
+    void **top = (void **)(coroutine->stack + coroutine_mapping_size());
+    *--top = NULL;
+    *--top = (void *)coroutine_entry;
+    for (int i = 0; i < 6; i++) {
+        *--top = NULL;
+    }
+    coroutine->sp = top;
+#endif
+    pool->active++;
+    return coroutine;
+}
+
+/**
+ * @brief Runs a coroutine until it suspends or finishes; calls its done callback if it finished.
+ *
+ * @param coroutine A suspended or new coroutine.
+ */
+void coroutine_resume(struct coroutine *coroutine) {
+    starting = coroutine;
+    coroutine_enter(coroutine);
+    if (coroutine->finished && coroutine->done != NULL) {
+        coroutine->done(coroutine, coroutine->arg);
+    }
+}
+
+/**
+ * @brief Suspends the running coroutine and returns to whoever resumed it.
+ *
+ * @param coroutine The running coroutine.
+ */
+void coroutine_yield(struct coroutine *coroutine) {
+    coroutine_leave(coroutine);
+}
+
+/**
+ * @brief Event callback: the descriptor a coroutine waits on is ready.
+ */
+static void coroutine_wake(struct event_loop *loop, int fd, short revents, void *data) {
+    struct coroutine *coroutine = data;
+    event_loop_remove_handle(loop, coroutine->waiting_handle);  // Not by fd: other sessions may wait on it too
+    coroutine->waiting_handle = -1;
+    coroutine_resume(coroutine);
+}
+
+/**
+ * @brief Has the event loop resume a coroutine once a descriptor is ready.
+ *
+ * Used to start a new coroutine from the loop rather than from code that
+ * cannot cope with its done callback running right away.
+ *
+ * @param coroutine A new or suspended coroutine.
+ * @param fd The descriptor.
+ * @param events POLLIN or POLLOUT.
+ * @return int 0 on success, -1 if it could not be registered with the loop.
+ */
+int coroutine_schedule(struct coroutine *coroutine, int fd, short events) {
+    int handle = event_loop_add(coroutine->pool->loop, fd, events, coroutine_wake, coroutine);
+    if (handle == -1) {
+        return -1;
+    }
+    coroutine->waiting_handle = handle;
+    return 0;
+}
+
+/**
+ * @brief Suspends the running coroutine until a descriptor is ready.
+ *
+ * @param coroutine The running coroutine.
+ * @param fd The descriptor.
+ * @param events POLLIN or POLLOUT.
+ * @return int 0 once ready, -1 if it could not be registered with the loop.
+ */
+int coroutine_wait(struct coroutine *coroutine, int fd, short events) {
+    if (coroutine_schedule(coroutine, fd, events) == -1) {
+        return -1;
+    }
+    coroutine_yield(coroutine);
+    return 0;
+}
+
+/**
+ * @brief Reads from a non-blocking descriptor, suspending the coroutine while nothing is available.
+ *
+ * @return ssize_t As read(), never failing with EAGAIN.
+ */
+ssize_t coroutine_read(struct coroutine *coroutine, int fd, void *buffer, size_t length) {
+    while (1) {
+        ssize_t n = read(fd, buffer, length);
+        if (n >= 0 || (errno != EAGAIN && errno != EINTR)) {
+            return n;
+        }
+        if (errno == EAGAIN && coroutine_wait(coroutine, fd, POLLIN) == -1) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief Writes all of a buffer to a non-blocking descriptor, suspending the coroutine while it is full.
+ *
+ * @return int 0 on success, -1 on error (errno is set).
+ */
+int coroutine_write_all(struct coroutine *coroutine, int fd, const void *buffer, size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = write(fd, (const char *)buffer + written, length - written);
+        if (n > 0) {
+            written += n;
+        } else if (n == -1 && errno == EAGAIN) {
+            if (coroutine_wait(coroutine, fd, POLLOUT) == -1) {
+                return -1;
+            }
+        } else if (n == -1 && errno != EINTR) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns a coroutine's stack to the pool. Must not be called on the coroutine's own stack.
+ *
+ * A suspended coroutine is abandoned: its wait is cancelled and its body
+ * never resumes, so it must not own anything only its body would free.
+ *
+ * @param coroutine A finished or suspended coroutine.
+ */
+void coroutine_release(struct coroutine *coroutine) {
+    struct coroutine_pool *pool = coroutine->pool;
+    if (coroutine->waiting_handle != -1) {
+        event_loop_remove_handle(pool->loop, coroutine->waiting_handle);
+        coroutine->waiting_handle = -1;
+    }
+    pool->active--;
+    if (pool->idle < COROUTINE_POOL_MAX) {
+        coroutine->next_free = pool->free_list;
+        pool->free_list = coroutine;
+        pool->idle++;
+        return;
+    }
+    munmap(coroutine->stack, coroutine_mapping_size());
+    free(coroutine);
+}
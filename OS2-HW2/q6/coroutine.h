@@ -0,0 +1,74 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include <stddef.h>     // size_t
+#include <sys/types.h>  // ssize_t
+#include "event_loop.h"
+
+#if !defined(__x86_64__) && !defined(COROUTINE_UCONTEXT)
+#define COROUTINE_UCONTEXT  // No hand-written context switch for this architecture; use swapcontext()
+#endif
+#ifdef COROUTINE_UCONTEXT
+#include <ucontext.h>   // ucontext_t
+#endif
+
+#define COROUTINE_STACK_SIZE (64 * 1024)  // Usable stack per coroutine, committed as touched; a guard page sits below it
+#define COROUTINE_POOL_MAX 4096           // Idle stacks kept for reuse, beyond which they are unmapped
+
+struct coroutine;
+
+/**
+ * @brief Body of a coroutine; returning finishes it.
+ */
+typedef void (*coroutine_fn)(struct coroutine *coroutine, void *arg);
+
+/**
+ * @brief A stackful coroutine: straight-line code that suspends while its descriptor would block.
+ *
+ * The event loop resumes it when the descriptor it waits on becomes ready;
+ * when the body returns, done is called from the loop, outside the
+ * coroutine's stack, so it may release the coroutine.
+ */
+struct coroutine {
+#ifdef COROUTINE_UCONTEXT
+    ucontext_t context;           // Saved context while suspended
+    ucontext_t resumer_context;   // Context of whoever resumed it, while it runs
+#else
+    void *sp;                     // Saved stack pointer while suspended
+    void *resumer_sp;             // Stack pointer of whoever resumed it, while it runs
+#endif
+    char *stack;                  // Mapping holding the guard page and the stack
+    struct coroutine_pool *pool;  // Pool the stack came from
+    coroutine_fn body;            // Code run on the stack
+    coroutine_fn done;            // Called by the resumer once body has returned
+    void *arg;                    // Passed to body and done
+    int finished;                 // body has returned
+    int waiting_handle;           // Its registration with the loop while suspended, or -1
+    struct coroutine *next_free;  // Link in the pool's free list
+};
+
+/**
+ * @brief Pooled coroutine stacks, and the loop their coroutines wait on.
+ *
+ * Stacks are mapped once with a guard page and reused, so starting a
+ * session costs no system call in steady state and only the stack pages
+ * a coroutine actually touches take memory.
+ */
+struct coroutine_pool {
+    struct event_loop *loop;       // Resumes waiting coroutines
+    struct coroutine *free_list;   // Idle coroutines with their stacks
+    int idle;                      // Entries on free_list
+    int active;                    // Coroutines handed out and not yet released
+};
+
+void coroutine_pool_init(struct coroutine_pool *pool, struct event_loop *loop);
+struct coroutine *coroutine_create(struct coroutine_pool *pool, coroutine_fn body, coroutine_fn done, void *arg);
+void coroutine_resume(struct coroutine *coroutine);
+void coroutine_yield(struct coroutine *coroutine);
+int coroutine_schedule(struct coroutine *coroutine, int fd, short events);
+int coroutine_wait(struct coroutine *coroutine, int fd, short events);
+ssize_t coroutine_read(struct coroutine *coroutine, int fd, void *buffer, size_t length);
+int coroutine_write_all(struct coroutine *coroutine, int fd, const void *buffer, size_t length);
+void coroutine_release(struct coroutine *coroutine);
+
+#endif
@@ -0,0 +1,210 @@
+#include <stdlib.h>  // Memory allocation
+#include <errno.h>   // Error number definitions
+#include "event_loop.h"
+
+/**
+ * @brief Initializes an empty event loop.
+ *
+ * @param loop The loop to initialize.
+ */
+void event_loop_init(struct event_loop *loop) {
+    loop->fds = NULL;
+    loop->entries = NULL;
+    loop->count = 0;
+    loop->capacity = 0;
+    loop->free_slots = -1;
+    loop->fd_slots = NULL;
+    loop->fd_capacity = 0;
+    loop->running = 1;
+}
+
+/**
+ * @brief Frees the loop's arrays. Registered descriptors are not closed.
+ *
+ * @param loop The loop to destroy.
+ */
+void event_loop_destroy(struct event_loop *loop) {
+    free(loop->fds);
+    free(loop->entries);
+    free(loop->fd_slots);
+    loop->fds = NULL;
+    loop->entries = NULL;
+    loop->fd_slots = NULL;
+    loop->count = 0;
+    loop->capacity = 0;
+    loop->free_slots = -1;
+    loop->fd_capacity = 0;
+}
+
+/**
+ * @brief Makes room for a new slot and for a descriptor in fd_slots.
+ *
+ * @param loop The loop.
+ * @param fd The descriptor about to be registered.
+ * @return int 0 on success, -1 if memory could not be allocated.
+ */
+static int event_loop_reserve(struct event_loop *loop, int fd) {
+    if (fd >= loop->fd_capacity) {
+        int fd_capacity = loop->fd_capacity == 0 ? 64 : loop->fd_capacity;
+        while (fd_capacity <= fd) {
+            fd_capacity *= 2;  // Grow geometrically
+        }
+        int *fd_slots = realloc(loop->fd_slots, fd_capacity * sizeof(*fd_slots));
+        if (fd_slots == NULL) {
+            return -1;
+        }
+        for (int i = loop->fd_capacity; i < fd_capacity; i++) {
+            fd_slots[i] = -1;
+        }
+        loop->fd_slots = fd_slots;
+        loop->fd_capacity = fd_capacity;
+    }
+    if (loop->free_slots == -1 && loop->count == loop->capacity) {
+        int capacity = loop->capacity == 0 ? 16 : loop->capacity * 2;  // Grow geometrically
+        struct pollfd *fds = realloc(loop->fds, capacity * sizeof(*fds));
+        if (fds == NULL) {
+            return -1;
+        }
+        loop->fds = fds;
+        struct event_entry *entries = realloc(loop->entries, capacity * sizeof(*entries));
+        if (entries == NULL) {
+            return -1;
+        }
+        loop->entries = entries;
+        loop->capacity = capacity;
+    }
+    return 0;
+}
+
+/**
+ * @brief Registers a descriptor with the loop.
+ *
+ * @param loop The loop.
+ * @param fd The descriptor to watch; it may already be registered.
+ * @param events The poll() events to wait for.
+ * @param handler The callback to run when the descriptor is ready.
+ * @param data Passed to the callback.
+ * @return int The registration's handle (0 or more), or -1 if fd is negative or memory could not be allocated.
+ */
+int event_loop_add(struct event_loop *loop, int fd, short events, event_handler handler, void *data) {
+    if (fd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+    if (event_loop_reserve(loop, fd) == -1) {
+        return -1;
+    }
+    int slot = loop->free_slots;
+    if (slot != -1) {
+        loop->free_slots = loop->entries[slot].next;
+    } else {
+        slot = loop->count++;
+    }
+    loop->fds[slot].fd = fd;
+    loop->fds[slot].events = events;
+    loop->fds[slot].revents = 0;  // A slot freed this round is not dispatched for its old registration
+    loop->entries[slot].handler = handler;
+    loop->entries[slot].data = data;
+    loop->entries[slot].next = loop->fd_slots[fd];
+    loop->fd_slots[fd] = slot;
+    return slot;
+}
+
+/**
+ * @brief Changes the events a registration is watched for.
+ *
+ * @param loop The loop.
+ * @param handle The registration, from event_loop_add().
+ * @param events The new poll() events.
+ */
+void event_loop_modify_handle(struct event_loop *loop, int handle, short events) {
+    loop->fds[handle].events = events;
+}
+
+/**
+ * @brief Changes the events a descriptor's latest registration is watched for.
+ *
+ * @param loop The loop.
+ * @param fd The registered descriptor.
+ * @param events The new poll() events.
+ */
+void event_loop_modify(struct event_loop *loop, int fd, short events) {
+    if (fd >= 0 && fd < loop->fd_capacity && loop->fd_slots[fd] != -1) {
+        event_loop_modify_handle(loop, loop->fd_slots[fd], events);
+    }
+}
+
+/**
+ * @brief Unregisters one registration. Safe to call from inside a handler.
+ *
+ * @param loop The loop.
+ * @param handle The registration, from event_loop_add(); it may be reused by later registrations.
+ */
+void event_loop_remove_handle(struct event_loop *loop, int handle) {
+    int fd = loop->fds[handle].fd;
+    if (fd < 0) {
+        return;  // Already removed
+    }
+    // Unlink it from its descriptor's chain, usually of one
+    for (int *link = &loop->fd_slots[fd]; *link != -1; link = &loop->entries[*link].next) {
+        if (*link == handle) {
+            *link = loop->entries[handle].next;
+            break;
+        }
+    }
+    loop->fds[handle].fd = -1;  // poll() ignores negative descriptors
+    loop->fds[handle].revents = 0;
+    loop->entries[handle].next = loop->free_slots;
+    loop->free_slots = handle;
+}
+
+/**
+ * @brief Unregisters a descriptor's latest registration. Safe to call from inside a handler.
+ *
+ * @param loop The loop.
+ * @param fd The registered descriptor.
+ */
+void event_loop_remove(struct event_loop *loop, int fd) {
+    if (fd >= 0 && fd < loop->fd_capacity && loop->fd_slots[fd] != -1) {
+        event_loop_remove_handle(loop, loop->fd_slots[fd]);
+    }
+}
+
+/**
+ * @brief Polls once and dispatches every ready descriptor.
+ *
+ * Descriptors added by handlers during this round are dispatched in the next one.
+ *
+ * @param loop The loop.
+ * @param timeout_ms The poll() timeout (-1 blocks).
+ * @return int The poll() result; -1 with errno EINTR when a signal interrupted the wait.
+ */
+int event_loop_run_once(struct event_loop *loop, int timeout_ms) {
+    int ready = poll(loop->fds, loop->count, timeout_ms);
+    if (ready <= 0) {
+        return ready;
+    }
+    int count = loop->count;  // Only dispatch the descriptors that were polled
+    int left = ready;         // Ready slots not reached yet; the scan stops at the last one
+    for (int i = 0; i < count && left > 0; i++) {
+        short revents = loop->fds[i].revents;
+        if (revents == 0) {
+            continue;
+        }
+        left--;
+        loop->fds[i].revents = 0;
+        if (loop->fds[i].fd >= 0) {
+            loop->entries[i].handler(loop, loop->fds[i].fd, revents, loop->entries[i].data);
+        }
+    }
+    return ready;
+}
+
+/**
+ * @brief Asks the loop's owner to stop calling event_loop_run_once().
+ *
+ * @param loop The loop.
+ */
+void event_loop_stop(struct event_loop *loop) {
+    loop->running = 0;
+}
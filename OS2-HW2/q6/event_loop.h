@@ -0,0 +1,59 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <poll.h>  // struct pollfd
+
+struct event_loop;
+
+/**
+ * @brief Callback invoked when a registered descriptor is ready.
+ *
+ * @param loop The loop that dispatched the event.
+ * @param fd The ready descriptor.
+ * @param revents The poll() revents for the descriptor.
+ * @param data The pointer given at registration.
+ */
+typedef void (*event_handler)(struct event_loop *loop, int fd, short revents, void *data);
+
+/**
+ * @brief A registered descriptor's callback and its user data.
+ */
+struct event_entry {
+    event_handler handler;  // Called when the descriptor is ready
+    void *data;             // Passed back to the handler
+    int next;               // Older registration of the same descriptor, or the next free slot; -1 ends the chain
+};
+
+/**
+ * @brief A poll()-based dispatcher over a growable set of descriptors.
+ *
+ * fds[i] and entries[i] describe the same registration, and i is its handle:
+ * a slot keeps its index while registered, so a descriptor may be registered
+ * more than once (a socket's reads and writes, or STDOUT shared by several
+ * sessions) and each registration is modified or removed on its own.
+ * Removed slots are marked with fd -1, which poll() skips, and reused by
+ * later registrations. fd_slots finds a descriptor's latest registration,
+ * so modifying and removing are O(1) whatever the number of descriptors.
+ */
+struct event_loop {
+    struct pollfd *fds;            // Descriptors passed to poll()
+    struct event_entry *entries;   // Handlers, parallel to fds
+    int count;                     // Slots passed to poll(): every slot ever used, registered or free
+    int capacity;                  // Allocated slots
+    int free_slots;                // First free slot below count, -1 if none
+    int *fd_slots;                 // Per descriptor: slot of its latest registration, -1 if none
+    int fd_capacity;               // Entries in fd_slots
+    int running;                   // Cleared by event_loop_stop()
+};
+
+void event_loop_init(struct event_loop *loop);
+void event_loop_destroy(struct event_loop *loop);
+int event_loop_add(struct event_loop *loop, int fd, short events, event_handler handler, void *data);
+void event_loop_modify(struct event_loop *loop, int fd, short events);
+void event_loop_remove(struct event_loop *loop, int fd);
+void event_loop_modify_handle(struct event_loop *loop, int handle, short events);
+void event_loop_remove_handle(struct event_loop *loop, int handle);
+int event_loop_run_once(struct event_loop *loop, int timeout_ms);
+void event_loop_stop(struct event_loop *loop);
+
+#endif
@@ -0,0 +1,517 @@
+#include <stdlib.h>        // Memory allocation
+#include <string.h>        // memcpy(), memset()
+#include <unistd.h>        // read(), write(), pread(), close(), ftruncate(), sysconf()
+#include <errno.h>         // Error number definitions
+#include <fcntl.h>         // open(), posix_fadvise()
+#include <sys/mman.h>      // mmap(), madvise()
+#include <sys/stat.h>      // fstat()
+#include "game_log.h"
+
+_Static_assert(sizeof(struct game_log_file_header) == 16, "the file header has no padding");
+_Static_assert(sizeof(struct game_log_block_header) == 24, "the block header has no padding");
+_Static_assert(GAME_LOG_BLOCK_GAMES <= 65536, "dedup indices are 16 bits");
+
+/**
+ * @brief FNV-1a over a block's payload.
+ */
+static uint32_t payload_checksum(const unsigned char *bytes, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Returns the length of a game record from its first byte.
+ */
+static int record_length(unsigned char first) {
+    return 1 + ((first & 15) + 1) / 2;
+}
+
+/**
+ * @brief Reads exactly size bytes, unless the file ends first.
+ *
+ * @return ssize_t Bytes read (less than size at the end of the file), or -1 on error.
+ */
+static ssize_t read_full(int fd, void *buffer, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = read(fd, (char *)buffer + done, size - done);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+/**
+ * @brief Checks a block header read from a log.
+ *
+ * @return int 1 if it can start a block, 0 if not.
+ */
+static int block_header_valid(const struct game_log_block_header *header) {
+    return header->magic == GAME_LOG_BLOCK_MAGIC && header->payload_bytes <= GAME_LOG_PAYLOAD_MAX &&
+           header->game_count <= GAME_LOG_BLOCK_GAMES && header->strategy_count <= GAME_LOG_STRATEGIES &&
+           header->codec <= GAME_LOG_DEDUP &&
+           header->payload_bytes >= (uint32_t)header->strategy_count * GAME_LOG_STRATEGY_LEN;
+}
+
+/**
+ * @brief Opens a log for appending, creating it if it is new or empty.
+ *
+ * An existing log is walked block header by block header. A block a crash
+ * left incomplete at the end of the file is cut off, so new blocks follow
+ * the last complete one; an invalid header anywhere else is corruption,
+ * and the file is left untouched.
+ *
+ * @param log The writer to set up.
+ * @param path The log file.
+ * @param compress Store blocks with the dedup codec when that is smaller.
+ * @return int 0 on success, -1 on error (errno is set; EINVAL for a file that is not a game log).
+ */
+int game_log_open(struct game_log_writer *log, const char *path, int compress) {
+    memset(log, 0, sizeof(*log));
+    log->compress = compress;
+    log->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (log->fd == -1) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(log->fd, &st) == -1) {
+        close(log->fd);
+        return -1;
+    }
+
+    struct game_log_file_header file_header;
+    if (st.st_size == 0) {
+        memset(&file_header, 0, sizeof(file_header));
+        memcpy(file_header.magic, GAME_LOG_MAGIC, sizeof(file_header.magic));
+        file_header.version = GAME_LOG_VERSION;
+        if (write(log->fd, &file_header, sizeof(file_header)) != sizeof(file_header)) {
+            close(log->fd);
+            return -1;
+        }
+        return 0;
+    }
+    if (pread(log->fd, &file_header, sizeof(file_header), 0) != sizeof(file_header) ||
+        memcmp(file_header.magic, GAME_LOG_MAGIC, sizeof(file_header.magic)) != 0 ||
+        file_header.version != GAME_LOG_VERSION) {
+        close(log->fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    off_t end = sizeof(file_header);
+    struct game_log_block_header header;
+    while (st.st_size - end >= (off_t)sizeof(header)) {
+        if (pread(log->fd, &header, sizeof(header), end) != sizeof(header)) {
+            close(log->fd);
+            return -1;
+        }
+        if (!block_header_valid(&header)) {
+            close(log->fd);
+            errno = EINVAL;  // Corrupt, not torn: a block header is written whole before its payload
+            return -1;
+        }
+        if (st.st_size - end - (off_t)sizeof(header) < header.payload_bytes) {
+            break;  // The payload runs past the end: the last append was torn
+        }
+        end += sizeof(header) + header.payload_bytes;
+    }
+    if (end < st.st_size && ftruncate(log->fd, end) == -1) {
+        close(log->fd);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Encodes the block's records with the dedup codec.
+ *
+ * @param log The writer.
+ * @param out Where the encoding goes.
+ * @return size_t Its length.
+ */
+static size_t encode_dedup(struct game_log_writer *log, unsigned char *out) {
+    memset(log->dedup_keys, 0, sizeof(log->dedup_keys));
+    unsigned char *distinct_records = out + 2;
+    size_t distinct_bytes = 0;
+    uint32_t distinct = 0;
+    size_t offset = 0;
+    for (uint32_t game = 0; game < log->game_count; game++) {
+        const unsigned char *record = log->records + offset;
+        int length = record_length(record[0]);
+        uint64_t key = 0;
+        memcpy(&key, record, length);
+        key++;  // Never 0, which marks a free slot
+        uint32_t slot = (uint32_t)((key * 0x9e3779b97f4a7c15ULL) >> 32) & (GAME_LOG_DEDUP_SLOTS - 1);
+        while (log->dedup_keys[slot] != 0 && log->dedup_keys[slot] != key) {
+            slot = (slot + 1) & (GAME_LOG_DEDUP_SLOTS - 1);
+        }
+        if (log->dedup_keys[slot] == 0) {
+            log->dedup_keys[slot] = key;
+            log->dedup_index[slot] = distinct++;
+            memcpy(distinct_records + distinct_bytes, record, length);
+            distinct_bytes += length;
+        }
+        log->game_index[game] = log->dedup_index[slot];
+        offset += length;
+    }
+
+    out[0] = distinct & 0xff;
+    out[1] = distinct >> 8;
+    unsigned char *indices = distinct_records + distinct_bytes;
+    int wide = distinct > 256;
+    for (uint32_t game = 0; game < log->game_count; game++) {
+        if (wide) {
+            indices[2 * game] = log->game_index[game] & 0xff;
+            indices[2 * game + 1] = log->game_index[game] >> 8;
+        } else {
+            indices[game] = log->game_index[game];
+        }
+    }
+    return 2 + distinct_bytes + (size_t)log->game_count * (wide ? 2 : 1);
+}
+
+/**
+ * @brief Writes the games added since the last flush as one block, with one write().
+ *
+ * @param log The writer.
+ * @return int 0 on success (or nothing to write), -1 if the write failed; the block is dropped either way.
+ */
+int game_log_flush(struct game_log_writer *log) {
+    if (log->game_count == 0) {
+        return 0;
+    }
+    struct game_log_block_header header;
+    memset(&header, 0, sizeof(header));
+    unsigned char *payload = log->block + sizeof(header);
+    size_t size = 0;
+    for (int i = 0; i < log->strategy_count; i++) {
+        memcpy(payload + size, log->strategies[i], GAME_LOG_STRATEGY_LEN);
+        size += GAME_LOG_STRATEGY_LEN;
+    }
+    header.codec = GAME_LOG_RAW;
+    if (log->compress) {
+        size_t encoded = encode_dedup(log, payload + size);
+        if (encoded < log->used) {
+            header.codec = GAME_LOG_DEDUP;
+            size += encoded;
+        }
+    }
+    if (header.codec == GAME_LOG_RAW) {
+        memcpy(payload + size, log->records, log->used);
+        size += log->used;
+    }
+    header.magic = GAME_LOG_BLOCK_MAGIC;
+    header.payload_bytes = size;
+    header.game_count = log->game_count;
+    header.move_count = log->move_count;
+    header.strategy_count = log->strategy_count;
+    header.checksum = payload_checksum(payload, size);
+    memcpy(log->block, &header, sizeof(header));
+
+    // O_APPEND places the block after the last one; a short write is finished, or cut off on the next open
+    size_t total = sizeof(header) + size, done = 0;
+    int result = 0;
+    while (done < total) {
+        ssize_t n = write(log->fd, log->block + done, total - done);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            result = -1;
+            break;
+        }
+        done += n;
+    }
+    if (result == 0) {
+        log->games_logged += log->game_count;
+        log->bytes_logged += total;
+    }
+    log->used = 0;
+    log->game_count = log->move_count = 0;
+    log->strategy_count = 0;
+    memset(log->strategies, 0, sizeof(log->strategies));
+    return result;
+}
+
+/**
+ * @brief Adds a finished or abandoned game to the current block, writing the block first if it is full.
+ *
+ * @param log The writer.
+ * @param strategy The AI's strategy.
+ * @param history Slots (1-9) in the order they were played, the AI's first.
+ * @param moves Entries in history (0-9).
+ * @param result How the game ended.
+ */
+void game_log_add(struct game_log_writer *log, const char *strategy, const unsigned char *history, int moves,
+                  enum game_result result) {
+    if (log->game_count == GAME_LOG_BLOCK_GAMES) {
+        game_log_flush(log);
+    }
+    int index = 0;
+    while (index < log->strategy_count && strncmp(log->strategies[index], strategy, GAME_LOG_STRATEGY_LEN) != 0) {
+        index++;
+    }
+    if (index == GAME_LOG_STRATEGIES) {
+        game_log_flush(log);  // Every strategy a block can name is taken; a new block starts with this one
+        index = 0;
+    }
+    if (index == log->strategy_count) {
+        strncpy(log->strategies[index], strategy, GAME_LOG_STRATEGY_LEN - 1);
+        log->strategy_count++;
+    }
+
+    unsigned char *record = log->records + log->used;
+    record[0] = moves | (unsigned)result << 4 | (unsigned)index << 6;
+    for (int i = 0; i < moves; i++) {
+        if (i % 2 == 0) {
+            record[1 + i / 2] = history[i];
+        } else {
+            record[1 + i / 2] |= history[i] << 4;
+        }
+    }
+    log->used += record_length(record[0]);
+    log->game_count++;
+    log->move_count += moves;
+}
+
+/**
+ * @brief Opens a log for reading, mapped or streamed.
+ *
+ * Either way memory stays bounded: a stream reads one block at a time into
+ * a buffer of the largest block's size, and a mapping hands pages already
+ * read back to the kernel every GAME_LOG_RELEASE_BYTES.
+ *
+ * @param reader The reader to set up.
+ * @param path The log file.
+ * @param use_mmap Map the file instead of reading it.
+ * @return int 0 on success, -1 on error (errno is set; EINVAL for a file that is not a game log).
+ */
+int game_log_reader_open(struct game_log_reader *reader, const char *path, int use_mmap) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (reader->fd == -1) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(reader->fd, &st) == -1) {
+        close(reader->fd);
+        return -1;
+    }
+
+    struct game_log_file_header file_header;
+    if (use_mmap && st.st_size >= (off_t)sizeof(file_header)) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+        if (map == MAP_FAILED) {
+            close(reader->fd);
+            return -1;
+        }
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        reader->mapped = 1;
+        reader->map = map;
+        reader->map_size = st.st_size;
+        memcpy(&file_header, reader->map, sizeof(file_header));
+    } else {
+        reader->buffer = malloc(GAME_LOG_PAYLOAD_MAX);
+        if (reader->buffer == NULL) {
+            close(reader->fd);
+            return -1;
+        }
+        posix_fadvise(reader->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        if (read_full(reader->fd, &file_header, sizeof(file_header)) != sizeof(file_header)) {
+            memset(&file_header, 0, sizeof(file_header));
+        }
+    }
+    if (memcmp(file_header.magic, GAME_LOG_MAGIC, sizeof(file_header.magic)) != 0 ||
+        file_header.version != GAME_LOG_VERSION) {
+        game_log_reader_close(reader);
+        errno = EINVAL;
+        return -1;
+    }
+    reader->offset = sizeof(file_header);
+    return 0;
+}
+
+/**
+ * @brief Moves to the next block and checks it.
+ *
+ * @param reader The reader.
+ * @return int 1 for a block, 0 at the end of the log (torn is set if it ends in an
+ *         incomplete block), -1 for a corrupt block (errno EINVAL) or a read error.
+ */
+int game_log_next_block(struct game_log_reader *reader) {
+    struct game_log_block_header *header = &reader->header;
+    if (reader->mapped) {
+        size_t left = reader->map_size - reader->offset;
+        if (left == 0) {
+            return 0;
+        }
+        if (left < sizeof(*header)) {
+            reader->torn = 1;
+            return 0;
+        }
+        memcpy(header, reader->map + reader->offset, sizeof(*header));
+        if (!block_header_valid(header)) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (left - sizeof(*header) < header->payload_bytes) {
+            reader->torn = 1;
+            return 0;
+        }
+
+        // Pages before this block are done with; dropping them keeps the resident set bounded
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t done = reader->offset & ~(page - 1);
+        if (done - reader->released >= GAME_LOG_RELEASE_BYTES) {
+            madvise((void *)(reader->map + reader->released), done - reader->released, MADV_DONTNEED);
+            reader->released = done;
+        }
+        reader->payload = reader->map + reader->offset + sizeof(*header);
+    } else {
+        ssize_t n = read_full(reader->fd, header, sizeof(*header));
+        if (n == -1) {
+            return -1;
+        }
+        if (n == 0) {
+            return 0;
+        }
+        if (n < (ssize_t)sizeof(*header)) {
+            reader->torn = 1;
+            return 0;
+        }
+        if (!block_header_valid(header)) {
+            errno = EINVAL;
+            return -1;
+        }
+        n = read_full(reader->fd, reader->buffer, header->payload_bytes);
+        if (n == -1) {
+            return -1;
+        }
+        if ((size_t)n < header->payload_bytes) {
+            reader->torn = 1;
+            return 0;
+        }
+        reader->payload = reader->buffer;
+    }
+    if (payload_checksum(reader->payload, header->payload_bytes) != header->checksum) {
+        errno = EINVAL;
+        return -1;  // offset stays at the corrupt block
+    }
+    reader->offset += sizeof(*header) + header->payload_bytes;
+    for (int i = 0; i < header->strategy_count; i++) {
+        memcpy(reader->strategies[i], reader->payload + i * GAME_LOG_STRATEGY_LEN, GAME_LOG_STRATEGY_LEN);
+        reader->strategies[i][GAME_LOG_STRATEGY_LEN - 1] = '\0';
+    }
+    return 1;
+}
+
+/**
+ * @brief Decodes one game record.
+ *
+ * @param reader The reader, for the block's strategies.
+ * @param record The record.
+ * @param end End of the payload.
+ * @param game Receives the game.
+ * @return int The record's length, or -1 if it is cut off or names no strategy of the block.
+ */
+static int record_decode(const struct game_log_reader *reader, const unsigned char *record, const unsigned char *end,
+                         struct game_log_game *game) {
+    int length = record_length(record[0]);
+    int strategy = record[0] >> 6;
+    game->moves = record[0] & 15;
+    if (game->moves > 9 || end - record < length || strategy >= reader->header.strategy_count) {
+        return -1;
+    }
+    game->strategy = reader->strategies[strategy];
+    game->strategy_index = strategy;
+    game->result = (record[0] >> 4) & 3;
+    for (int i = 0; i < game->moves; i++) {
+        game->history[i] = (record[1 + i / 2] >> (4 * (i & 1))) & 15;
+    }
+    return length;
+}
+
+/**
+ * @brief Hands each game of the current block to a function, in the order they were logged.
+ *
+ * @param reader The reader, after game_log_next_block() returned 1.
+ * @param visit Called with each game.
+ * @param arg Passed to visit.
+ * @return int 0 on success, -1 for a block whose games do not decode (errno EINVAL).
+ */
+int game_log_block_games(struct game_log_reader *reader, void (*visit)(const struct game_log_game *game, void *arg),
+                         void *arg) {
+    const struct game_log_block_header *header = &reader->header;
+    const unsigned char *p = reader->payload + header->strategy_count * GAME_LOG_STRATEGY_LEN;
+    const unsigned char *end = reader->payload + header->payload_bytes;
+    struct game_log_game game;
+
+    if (header->codec == GAME_LOG_RAW) {
+        for (uint32_t i = 0; i < header->game_count; i++) {
+            int length = p < end ? record_decode(reader, p, end, &game) : -1;
+            if (length == -1) {
+                errno = EINVAL;
+                return -1;
+            }
+            visit(&game, arg);
+            p += length;
+        }
+        return 0;
+    }
+
+    // Dedup: decode the distinct games once, then visit them by index
+    if (end - p < 2) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint32_t distinct = p[0] | (uint32_t)p[1] << 8;
+    p += 2;
+    if (distinct > GAME_LOG_BLOCK_GAMES) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (uint32_t i = 0; i < distinct; i++) {
+        int length = p < end ? record_decode(reader, p, end, &reader->distinct[i]) : -1;
+        if (length == -1) {
+            errno = EINVAL;
+            return -1;
+        }
+        p += length;
+    }
+    int wide = distinct > 256;
+    if ((size_t)(end - p) != (size_t)header->game_count * (wide ? 2 : 1)) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (uint32_t i = 0; i < header->game_count; i++) {
+        uint32_t index = wide ? (p[2 * i] | (uint32_t)p[2 * i + 1] << 8) : p[i];
+        if (index >= distinct) {
+            errno = EINVAL;
+            return -1;
+        }
+        visit(&reader->distinct[index], arg);
+    }
+    return 0;
+}
+
+/**
+ * @brief Closes a reader.
+ */
+void game_log_reader_close(struct game_log_reader *reader) {
+    if (reader->mapped) {
+        munmap((void *)reader->map, reader->map_size);
+    }
+    free(reader->buffer);
+    close(reader->fd);
+}
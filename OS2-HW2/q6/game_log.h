@@ -0,0 +1,125 @@
+#ifndef GAME_LOG_H
+#define GAME_LOG_H
+
+#include <stddef.h>  // size_t
+#include <stdint.h>  // Fixed-size fields of the file format
+
+#define GAME_LOG_MAGIC "TTTGLOG1"     // First bytes of a game log
+#define GAME_LOG_VERSION 1            // Layout of the blocks below
+#define GAME_LOG_BLOCK_MAGIC 0x4b4c4247u  // "GBLK", starts every block
+#define GAME_LOG_BLOCK_GAMES 16384    // Games per block, at most
+#define GAME_LOG_RECORD_MAX 6         // Bytes of the longest game record (9 moves)
+#define GAME_LOG_STRATEGIES 4         // Strategies one block can name (2 bits per record)
+#define GAME_LOG_STRATEGY_LEN 10      // A strategy and its terminator ("minimax" fits)
+#define GAME_LOG_PAYLOAD_MAX (GAME_LOG_STRATEGIES * GAME_LOG_STRATEGY_LEN + 2 + \
+                              GAME_LOG_BLOCK_GAMES * (GAME_LOG_RECORD_MAX + 2))  // Largest block payload
+#define GAME_LOG_DEDUP_SLOTS (2 * GAME_LOG_BLOCK_GAMES)  // Hash table of the dedup codec, a power of two
+#define GAME_LOG_RELEASE_BYTES (64 << 20)  // Mapped bytes read before they are handed back to the kernel
+
+/**
+ * @brief How a game ended.
+ */
+enum game_result {
+    GAME_DRAW,        // The board filled up
+    GAME_AI_WIN,      // The AI (X) completed a line
+    GAME_AI_LOST,     // The player (O) completed a line
+    GAME_ABANDONED,   // The player left before the end (and the game was not saved to resume with -G)
+};
+
+/**
+ * @brief How a block's games are stored.
+ *
+ * A game record is one byte (moves in the low nibble, the result in the
+ * next 2 bits, the strategy's index in the block in the top 2 bits) and
+ * then the moves, two slots (1-9) per byte, first move in the low nibble.
+ */
+enum game_log_codec {
+    GAME_LOG_RAW,    // The records, one after the other
+    GAME_LOG_DEDUP,  // Each distinct record once, then one index per game (1 byte, or 2 past 256 distinct)
+};
+
+/**
+ * @brief Start of a game log file.
+ */
+struct game_log_file_header {
+    char magic[8];      // GAME_LOG_MAGIC
+    uint16_t version;   // GAME_LOG_VERSION
+    uint16_t flags;     // Unused, 0
+    uint32_t reserved;  // Unused, 0
+};
+
+/**
+ * @brief Start of a block; the payload follows: the strategies, then the games in the block's codec.
+ */
+struct game_log_block_header {
+    uint32_t magic;           // GAME_LOG_BLOCK_MAGIC
+    uint32_t payload_bytes;   // Bytes after this header
+    uint32_t game_count;      // Games in the block
+    uint32_t move_count;      // Moves of those games
+    uint8_t codec;            // enum game_log_codec
+    uint8_t strategy_count;   // Strategies at the start of the payload, GAME_LOG_STRATEGY_LEN bytes each
+    uint16_t reserved;        // Unused, 0
+    uint32_t checksum;        // FNV-1a of the payload
+};
+
+/**
+ * @brief One game as the reader hands it out.
+ */
+struct game_log_game {
+    const char *strategy;   // The AI's strategy
+    int strategy_index;     // Its index among the block's strategies
+    int result;             // enum game_result
+    int moves;              // Entries in history
+    unsigned char history[9];  // Slots (1-9) in the order they were played, the AI's first
+};
+
+/**
+ * @brief Appends games to a log, a block per write().
+ */
+struct game_log_writer {
+    int fd;                           // The log, opened for appending
+    int compress;                     // Use the dedup codec when it is smaller
+    unsigned char records[GAME_LOG_BLOCK_GAMES * GAME_LOG_RECORD_MAX];  // The block's records so far
+    size_t used;                      // Bytes in records
+    uint32_t game_count;              // Games in the block
+    uint32_t move_count;              // Their moves
+    char strategies[GAME_LOG_STRATEGIES][GAME_LOG_STRATEGY_LEN];  // Strategies the block names
+    int strategy_count;               // Entries in strategies
+    uint64_t dedup_keys[GAME_LOG_DEDUP_SLOTS];     // Dedup hash table: record bytes plus one, 0 if empty
+    uint16_t dedup_index[GAME_LOG_DEDUP_SLOTS];    // The record's index among the distinct ones
+    uint16_t game_index[GAME_LOG_BLOCK_GAMES];     // Dedup: each game's distinct record
+    unsigned char block[sizeof(struct game_log_block_header) + GAME_LOG_PAYLOAD_MAX];  // The block being encoded
+    unsigned long long games_logged;  // Games written so far
+    unsigned long long bytes_logged;  // Bytes written so far
+};
+
+/**
+ * @brief Reads a log block by block, from a mapping or through a bounded buffer.
+ */
+struct game_log_reader {
+    int fd;                           // The log
+    int mapped;                       // Reading from map, not through buffer
+    const unsigned char *map;         // The mapped file
+    size_t map_size;                  // Its size
+    size_t offset;                    // Next byte of the file to read
+    size_t released;                  // Mapped bytes already handed back to the kernel
+    int torn;                         // The log ends in an incomplete block (a crash mid-write)
+    unsigned char *buffer;            // Streaming: the current block's payload
+    struct game_log_block_header header;  // The current block
+    const unsigned char *payload;     // Its payload
+    char strategies[GAME_LOG_STRATEGIES][GAME_LOG_STRATEGY_LEN];  // Its strategies, terminated
+    struct game_log_game distinct[GAME_LOG_BLOCK_GAMES];  // Dedup: the block's distinct games, decoded once
+};
+
+int game_log_open(struct game_log_writer *log, const char *path, int compress);
+void game_log_add(struct game_log_writer *log, const char *strategy, const unsigned char *history, int moves,
+                  enum game_result result);
+int game_log_flush(struct game_log_writer *log);
+
+int game_log_reader_open(struct game_log_reader *reader, const char *path, int use_mmap);
+int game_log_next_block(struct game_log_reader *reader);
+int game_log_block_games(struct game_log_reader *reader, void (*visit)(const struct game_log_game *game, void *arg),
+                         void *arg);
+void game_log_reader_close(struct game_log_reader *reader);
+
+#endif
@@ -0,0 +1,299 @@
+#include <stdio.h>         // Error messages
+#include <stdlib.h>        // Memory allocation
+#include <string.h>        // memcpy(), memset()
+#include <stddef.h>        // offsetof()
+#include <unistd.h>        // close(), ftruncate(), sysconf()
+#include <errno.h>         // Error number definitions
+#include <fcntl.h>         // open()
+#include <time.h>          // Save times
+#include <sys/mman.h>      // mmap(), msync()
+#include <sys/stat.h>      // fstat()
+#include "game_store.h"
+
+_Static_assert(sizeof(struct game_record) == 64, "a record is one cache line");
+_Static_assert(sizeof(struct game_store_header) == 64, "the header is one cache line");
+
+/**
+ * @brief FNV-1a over a record's bytes before its checksum.
+ */
+static uint32_t record_checksum(const struct game_record *record) {
+    const unsigned char *bytes = (const unsigned char *)record;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(struct game_record, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash | 1;  // Never 0, so a zeroed (new) record is invalid
+}
+
+/**
+ * @brief Returns the current copy of a slot: the valid one saved last.
+ *
+ * @return struct game_record* The copy, or NULL if neither is valid (a slot never written).
+ */
+static struct game_record *slot_current(struct game_slot *slot) {
+    struct game_record *current = NULL;
+    for (int i = 0; i < 2; i++) {
+        struct game_record *copy = &slot->copies[i];
+        if (atomic_load_explicit(&copy->checksum, memory_order_acquire) != record_checksum(copy)) {
+            continue;  // Never written, or a save was interrupted
+        }
+        if (current == NULL || copy->sequence > current->sequence) {
+            current = copy;
+        }
+    }
+    return current;
+}
+
+/**
+ * @brief Returns the id of the game in a slot, 0 if it is free.
+ */
+static uint32_t slot_game_id(struct game_slot *slot) {
+    struct game_record *current = slot_current(slot);
+    return current != NULL ? current->game_id : 0;
+}
+
+/**
+ * @brief Writes a slot's other copy and publishes it, making it current in one step.
+ *
+ * The copy is filled in, then its checksum is stored; until then the
+ * current copy stays valid, so a crash mid-save loses only that save.
+ * With durability on, the copy is flushed to disk before returning.
+ *
+ * @param store The store.
+ * @param slot The slot.
+ * @param state What to save, or NULL to free the slot.
+ */
+static void slot_write(struct game_store *store, int slot, const struct game_state *state) {
+    struct game_slot *target = &store->slots[slot];
+    struct game_record *current = slot_current(target);
+    struct game_record *record = current == &target->copies[0] ? &target->copies[1] : &target->copies[0];
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    atomic_store_explicit(&record->checksum, 0, memory_order_relaxed);
+    memset(record, 0, offsetof(struct game_record, checksum));
+    record->sequence = current != NULL ? current->sequence + 1 : 1;
+    record->saved_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    if (state != NULL) {
+        record->game_id = state->id;
+        record->session = state->session;
+        for (int i = 0; i < SIZE * SIZE; i++) {
+            char cell = state->board[i / SIZE][i % SIZE];
+            record->board |= (uint32_t)(cell == 'X' ? 1 : cell == 'O' ? 2 : 0) << (2 * i);
+        }
+        record->moves = state->moves;
+        memcpy(record->history, state->history, sizeof(record->history));
+        memcpy(record->strategy, state->strategy, sizeof(record->strategy));
+    }
+    atomic_store_explicit(&record->checksum, record_checksum(record), memory_order_release);
+    store->ids[slot] = record->game_id;
+
+    if (store->durable) {
+        long page = sysconf(_SC_PAGESIZE);
+        uintptr_t start = (uintptr_t)record & ~(uintptr_t)(page - 1);
+        msync((void *)start, (uintptr_t)(record + 1) - start, MS_SYNC);
+    }
+}
+
+/**
+ * @brief Opens a store file, creating it with GAME_STORE_SLOTS free slots if it is new or empty.
+ *
+ * @param store The store to set up.
+ * @param path The file.
+ * @param durable msync() every save, so it survives a power loss as well as a crash.
+ * @return int 0 on success, -1 on error (errno is set; EINVAL for a file that is not a store).
+ */
+int game_store_open(struct game_store *store, const char *path, int durable) {
+    memset(store, 0, sizeof(*store));
+    store->durable = durable;
+    store->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (store->fd == -1) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(store->fd, &st) == -1) {
+        close(store->fd);
+        return -1;
+    }
+    int created = st.st_size == 0;
+    size_t size = created ? sizeof(struct game_store_header) + GAME_STORE_SLOTS * sizeof(struct game_slot)
+                          : (size_t)st.st_size;
+    if (created && ftruncate(store->fd, size) == -1) {
+        close(store->fd);
+        return -1;
+    }
+    if (size < sizeof(struct game_store_header)) {
+        close(store->fd);
+        errno = EINVAL;
+        return -1;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd, 0);
+    if (map == MAP_FAILED) {
+        close(store->fd);
+        return -1;
+    }
+    store->header = map;
+    store->map_size = size;
+    store->slots = (struct game_slot *)(store->header + 1);
+    if (created) {
+        memcpy(store->header->magic, GAME_STORE_MAGIC, sizeof(store->header->magic));
+        store->header->version = GAME_STORE_VERSION;
+        store->header->slot_count = GAME_STORE_SLOTS;
+        store->header->next_id = 1;
+    }
+    if (memcmp(store->header->magic, GAME_STORE_MAGIC, sizeof(store->header->magic)) != 0 ||
+        store->header->version != GAME_STORE_VERSION ||
+        size != sizeof(struct game_store_header) + store->header->slot_count * sizeof(struct game_slot)) {
+        munmap(map, size);
+        close(store->fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    store->owned = calloc(store->header->slot_count, 1);
+    store->ids = calloc(store->header->slot_count, sizeof(*store->ids));
+    if (store->owned == NULL || store->ids == NULL) {
+        free(store->owned);
+        free(store->ids);
+        munmap(map, size);
+        close(store->fd);
+        return -1;
+    }
+    // A crash may have saved a game before its id was counted in the header
+    for (uint32_t i = 0; i < store->header->slot_count; i++) {
+        uint32_t id = slot_game_id(&store->slots[i]);
+        store->ids[i] = id;
+        if (id >= store->header->next_id) {
+            store->header->next_id = id + 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Takes a slot for a new game and saves its empty board.
+ *
+ * A free slot is used if there is one; otherwise the game abandoned
+ * longest ago is overwritten.
+ *
+ * @param store The store.
+ * @param session The session starting the game.
+ * @param id Receives the new game's id.
+ * @return int The slot, or -1 if live games hold every slot.
+ */
+int game_store_claim(struct game_store *store, uint32_t session, uint32_t *id) {
+    int chosen = -1;
+    uint64_t oldest = UINT64_MAX;
+    for (uint32_t i = 0; i < store->header->slot_count; i++) {
+        if (store->owned[i]) {
+            continue;
+        }
+        if (store->ids[i] == 0) {
+            chosen = i;
+            break;
+        }
+        struct game_record *current = slot_current(&store->slots[i]);
+        if (current != NULL && current->saved_ns < oldest) {
+            oldest = current->saved_ns;
+            chosen = i;
+        }
+    }
+    if (chosen == -1) {
+        return -1;
+    }
+    struct game_state state;
+    memset(&state, 0, sizeof(state));
+    state.id = store->header->next_id++;
+    state.session = session;
+    memset(state.board, ' ', sizeof(state.board));
+    slot_write(store, chosen, &state);
+    store->owned[chosen] = 1;
+    *id = state.id;
+    return chosen;
+}
+
+/**
+ * @brief Saves a game's position into its slot.
+ *
+ * @param store The store.
+ * @param slot The game's slot, from game_store_claim() or game_store_find().
+ * @param state The game.
+ */
+void game_store_save(struct game_store *store, int slot, const struct game_state *state) {
+    slot_write(store, slot, state);
+}
+
+/**
+ * @brief Finds an unfinished game no live session is playing, and claims its slot.
+ *
+ * @param store The store.
+ * @param id The game's id.
+ * @return int The slot, or -1 if there is no such game or it is being played.
+ */
+int game_store_find(struct game_store *store, uint32_t id) {
+    if (id == 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < store->header->slot_count; i++) {
+        if (store->ids[i] == id) {
+            if (store->owned[i]) {
+                return -1;
+            }
+            store->owned[i] = 1;
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Reads the game saved in a slot.
+ *
+ * @param store The store.
+ * @param slot The slot.
+ * @param state Receives the game.
+ * @return int 0 on success, -1 if the slot holds no game.
+ */
+int game_store_load(struct game_store *store, int slot, struct game_state *state) {
+    struct game_record *current = slot_current(&store->slots[slot]);
+    if (current == NULL || current->game_id == 0) {
+        return -1;
+    }
+    state->id = current->game_id;
+    state->session = current->session;
+    for (int i = 0; i < SIZE * SIZE; i++) {
+        int cell = (current->board >> (2 * i)) & 3;
+        state->board[i / SIZE][i % SIZE] = cell == 1 ? 'X' : cell == 2 ? 'O' : ' ';
+    }
+    state->moves = current->moves <= SIZE * SIZE ? current->moves : SIZE * SIZE;
+    memcpy(state->history, current->history, sizeof(state->history));
+    memcpy(state->strategy, current->strategy, sizeof(state->strategy));
+    state->strategy[GAME_STRATEGY_MAX - 1] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Frees a finished game's slot.
+ */
+void game_store_release(struct game_store *store, int slot) {
+    slot_write(store, slot, NULL);
+    store->owned[slot] = 0;
+}
+
+/**
+ * @brief Leaves an unfinished game in its slot, for the player to resume later.
+ */
+void game_store_disown(struct game_store *store, int slot) {
+    store->owned[slot] = 0;
+}
+
+/**
+ * @brief Counts the games saved and not finished.
+ */
+int game_store_unfinished(struct game_store *store) {
+    int count = 0;
+    for (uint32_t i = 0; i < store->header->slot_count; i++) {
+        count += store->ids[i] != 0;
+    }
+    return count;
+}
@@ -0,0 +1,85 @@
+#ifndef GAME_STORE_H
+#define GAME_STORE_H
+
+#include <stddef.h>     // size_t
+#include <stdint.h>     // Fixed-size fields of the file format
+#include <stdatomic.h>  // Publishing a record
+#include "ttt.h"        // SIZE
+
+#define GAME_STORE_MAGIC "MYNCGAME"  // First bytes of a store file
+#define GAME_STORE_VERSION 1         // Layout of the records below
+#define GAME_STORE_SLOTS 1024        // Slots of a new store file
+#define GAME_STRATEGY_MAX 10         // Strategy string and terminator ("minimax" fits)
+
+/**
+ * @brief One saved position of a game, as laid out in the file.
+ *
+ * Written in full, then published by storing its checksum last, so a
+ * record a crash interrupted fails its checksum and is ignored.
+ */
+struct game_record {
+    uint32_t sequence;                  // Saves of the slot so far; the valid copy with the higher one is current
+    uint32_t game_id;                   // The game's id, 0 if the slot is free
+    uint32_t session;                   // Session that last played it
+    uint32_t board;                     // 2 bits per cell, row by row: 0 empty, 1 X, 2 O
+    uint64_t saved_ns;                  // Wall-clock time of the save, to reuse the oldest abandoned slot
+    uint8_t moves;                      // Entries in history
+    uint8_t history[SIZE * SIZE];       // Slots (1-9) in the order they were played
+    char strategy[GAME_STRATEGY_MAX];   // The AI's strategy
+    uint8_t reserved[16];               // Pads the record to 64 bytes
+    _Atomic uint32_t checksum;          // FNV-1a of the bytes above; stored last
+};
+
+/**
+ * @brief A slot: two records, written alternately, so the last complete save survives an interrupted one.
+ */
+struct game_slot {
+    struct game_record copies[2];
+};
+
+/**
+ * @brief Start of a store file.
+ */
+struct game_store_header {
+    char magic[8];        // GAME_STORE_MAGIC
+    uint32_t version;     // GAME_STORE_VERSION
+    uint32_t slot_count;  // Slots that follow the header
+    uint32_t next_id;     // Id of the next game, so ids of finished games are not handed out again
+    uint8_t reserved[44]; // Pads the header to 64 bytes
+};
+
+/**
+ * @brief A game as the store hands it out.
+ */
+struct game_state {
+    uint32_t id;                        // The game's id, given to the player to resume it
+    uint32_t session;                   // Session that last played it
+    char board[SIZE][SIZE];             // The board
+    int moves;                          // Entries in history
+    unsigned char history[SIZE * SIZE]; // Slots in the order they were played
+    char strategy[GAME_STRATEGY_MAX];   // The AI's strategy
+};
+
+/**
+ * @brief An open store: the mapped file and which slots live sessions are playing.
+ */
+struct game_store {
+    struct game_store_header *header;  // Start of the mapping
+    struct game_slot *slots;           // The slots, after the header
+    unsigned char *owned;              // Per slot: a live game is using it
+    uint32_t *ids;                     // Per slot: id of the game saved in it, 0 if free (mirrors the file)
+    size_t map_size;                   // Bytes mapped
+    int durable;                       // msync() every save
+    int fd;                            // The store file
+};
+
+int game_store_open(struct game_store *store, const char *path, int durable);
+int game_store_claim(struct game_store *store, uint32_t session, uint32_t *id);
+void game_store_save(struct game_store *store, int slot, const struct game_state *state);
+int game_store_find(struct game_store *store, uint32_t id);
+int game_store_load(struct game_store *store, int slot, struct game_state *state);
+void game_store_release(struct game_store *store, int slot);
+void game_store_disown(struct game_store *store, int slot);
+int game_store_unfinished(struct game_store *store);
+
+#endif
@@ -0,0 +1,133 @@
+#include <string.h>  // Memory functions
+#include "latency_hist.h"
+
+/**
+ * @brief Maps a value to its bucket index.
+ *
+ * Values below 2 * HIST_SUB_COUNT get one bucket each; above that every
+ * power of two is split into HIST_SUB_COUNT equal-width buckets.
+ *
+ * @param value The value in nanoseconds.
+ * @return int The bucket index.
+ */
+static int hist_bucket(unsigned long long value) {
+    if (value < HIST_SUB_COUNT) {
+        return (int)value;
+    }
+    int magnitude = 63 - __builtin_clzll(value);  // Index of the highest set bit
+    if (magnitude >= HIST_MAX_BITS) {
+        return HIST_BUCKETS - 1;  // Clamp to the last bucket
+    }
+    int shift = magnitude - HIST_SUB_BITS;
+    int sub = (int)(value >> shift) - HIST_SUB_COUNT;
+    return (shift + 1) * HIST_SUB_COUNT + sub;
+}
+
+/**
+ * @brief Returns the smallest value that falls into a bucket.
+ *
+ * @param index The bucket index.
+ * @return unsigned long long The bucket's lower bound in nanoseconds.
+ */
+static unsigned long long hist_bucket_value(int index) {
+    int group = index / HIST_SUB_COUNT;
+    int sub = index % HIST_SUB_COUNT;
+    if (group == 0) {
+        return (unsigned long long)sub;
+    }
+    return (unsigned long long)(HIST_SUB_COUNT + sub) << (group - 1);
+}
+
+/**
+ * @brief Initializes an empty histogram.
+ *
+ * @param hist The histogram.
+ * @param name The label used when printing.
+ */
+void hist_init(struct latency_hist *hist, const char *name) {
+    memset(hist, 0, sizeof(*hist));
+    hist->name = name;
+}
+
+/**
+ * @brief Records one latency sample.
+ *
+ * Uses relaxed atomic adds only, so it is lock-free and safe to call from
+ * several threads or from a signal handler while another thread prints.
+ *
+ * @param hist The histogram.
+ * @param ns The latency in nanoseconds.
+ */
+void hist_record(struct latency_hist *hist, unsigned long long ns) {
+    __atomic_fetch_add(&hist->buckets[hist_bucket(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->sum, ns, __ATOMIC_RELAXED);
+    unsigned long long max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&hist->max, &max, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        // max was reloaded by the failed exchange; retry while ns is still larger
+    }
+}
+
+/**
+ * @brief Copies a histogram that may still be recording into a stable snapshot.
+ *
+ * @param hist The live histogram.
+ * @param snapshot The copy to fill.
+ */
+void hist_snapshot(const struct latency_hist *hist, struct latency_hist *snapshot) {
+    snapshot->name = hist->name;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        snapshot->buckets[i] = __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+    }
+    snapshot->count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+    snapshot->sum = __atomic_load_n(&hist->sum, __ATOMIC_RELAXED);
+    snapshot->max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Estimates a percentile from the bucket counts.
+ *
+ * @param hist The histogram.
+ * @param percent The percentile (0-100).
+ * @return unsigned long long The lower bound of the bucket holding the percentile.
+ */
+unsigned long long hist_percentile(const struct latency_hist *hist, double percent) {
+    if (hist->count == 0) {
+        return 0;
+    }
+    unsigned long long target = (unsigned long long)(percent / 100.0 * hist->count + 0.5);
+    if (target == 0) {
+        target = 1;
+    }
+    unsigned long long seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target) {
+            return hist_bucket_value(i);
+        }
+    }
+    return hist->max;
+}
+
+/**
+ * @brief Prints a percentile summary followed by the non-empty buckets.
+ *
+ * @param hist The histogram.
+ * @param out The stream to print to.
+ */
+void hist_print(const struct latency_hist *hist, FILE *out) {
+    fprintf(out, "%s: count=%llu", hist->name, hist->count);
+    if (hist->count == 0) {
+        fprintf(out, "\n");
+        return;
+    }
+    fprintf(out, " mean=%.1fus p50=%.1fus p90=%.1fus p99=%.1fus p999=%.1fus max=%.1fus\n",
+            hist->sum / 1000.0 / hist->count, hist_percentile(hist, 50) / 1000.0,
+            hist_percentile(hist, 90) / 1000.0, hist_percentile(hist, 99) / 1000.0,
+            hist_percentile(hist, 99.9) / 1000.0, hist->max / 1000.0);
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        if (hist->buckets[i] != 0) {
+            fprintf(out, "  >= %12.1fus %llu\n", hist_bucket_value(i) / 1000.0, hist->buckets[i]);
+        }
+    }
+}
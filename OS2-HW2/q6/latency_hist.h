@@ -0,0 +1,31 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdio.h>  // FILE
+
+#define HIST_SUB_BITS 4                      // 16 linear sub-buckets per power of two (~6% precision)
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 48                     // Values up to 2^48 ns (about 3 days)
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+
+/**
+ * @brief A fixed-size log-linear (HDR-style) histogram of nanosecond latencies.
+ *
+ * All storage is inline, so recording never allocates, and recording uses
+ * only atomic adds, so it never takes a lock.
+ */
+struct latency_hist {
+    const char *name;                          // Label used when printing
+    unsigned long long count;                  // Number of recorded values
+    unsigned long long sum;                    // Sum of recorded values
+    unsigned long long max;                    // Largest recorded value
+    unsigned long long buckets[HIST_BUCKETS];  // Counts per bucket
+};
+
+void hist_init(struct latency_hist *hist, const char *name);
+void hist_record(struct latency_hist *hist, unsigned long long ns);
+void hist_snapshot(const struct latency_hist *hist, struct latency_hist *snapshot);
+unsigned long long hist_percentile(const struct latency_hist *hist, double percent);
+void hist_print(const struct latency_hist *hist, FILE *out);
+
+#endif
@@ -0,0 +1,493 @@
+#include <stdio.h>         // Standard I/O library
+#include <stdlib.h>        // Standard library for general functions
+#include <stddef.h>        // offsetof()
+#include <unistd.h>        // Unix standard functions
+#include <string.h>        // String manipulation functions
+#include <errno.h>         // Error number definitions
+#include <fcntl.h>         // File control options
+#include <poll.h>          // Polling for events on file descriptors
+#include <time.h>          // Monotonic clock
+#include <getopt.h>        // Command line option parsing
+#include <sys/types.h>     // Data types for system calls
+#include <sys/socket.h>    // Sockets API
+#include <sys/un.h>        // Unix domain sockets
+#include <sys/resource.h>  // File descriptor limits
+#include <netinet/in.h>    // Internet domain address structures
+#include <arpa/inet.h>     // Functions for IP address conversion
+#include <linux/tcp.h>     // TCP_INFO with tcpi_data_segs_in
+#include "latency_hist.h"  // Latency histograms
+
+#define SIZE 3  // Define the size of the Tic-Tac-Toe board
+#define PROMPT "Enter your move (1-9): "  // Prompt printed by makePlayerMove
+#define LINE_MAX_LEN 256  // Longest ttt output line we keep
+
+/**
+ * @brief Where a load generator session is in its game.
+ */
+enum session_state {
+    SESSION_FREE,        // Slot not in use
+    SESSION_CONNECTING,  // Non-blocking connect in progress (stream transports)
+    SESSION_PLAYING,     // Connected and playing
+};
+
+/**
+ * @brief One simulated player connected to the mync server.
+ */
+struct session {
+    enum session_state state;
+    int fd;                              // Connection to the server
+    char board[SIZE][SIZE];              // Board as last rendered by displayBoard
+    int rows_seen;                       // Board rows parsed so far
+    char line[LINE_MAX_LEN];             // Partial output line
+    size_t line_len;                     // Bytes in line
+    long long started_ns;                // When the connection was started
+    long long move_sent_ns;              // When the last move was sent (0 if none outstanding)
+    long long last_activity_ns;          // Last time bytes arrived, for the idle timeout
+    int connected;                       // Set once the first byte (datagram) or connect completion is seen
+    char local_path[sizeof(((struct sockaddr_un *)0)->sun_path)];  // Bound path for UDSCD sessions
+    unsigned int seed;                   // Per-session random state for move choice
+};
+
+/**
+ * @brief The transport and address of the server under load.
+ */
+struct target {
+    int family;                     // AF_INET or AF_UNIX
+    int type;                       // SOCK_STREAM or SOCK_DGRAM
+    struct sockaddr_storage addr;   // Server address
+    socklen_t addr_len;             // Server address length
+};
+
+/**
+ * @brief Totals and histograms for the whole run.
+ */
+struct loadgen_stats {
+    unsigned long long games_started;
+    unsigned long long games_finished;
+    unsigned long long ai_wins;
+    unsigned long long ai_losses;
+    unsigned long long draws;
+    unsigned long long connect_errors;
+    unsigned long long io_errors;
+    unsigned long long timeouts;
+    unsigned long long protocol_errors;
+    unsigned long long turns;             // Server bursts answered: prompts plus game results
+    unsigned long long reads;             // recv() calls that returned data
+    unsigned long long tcp_segments;      // Data segments received (TCP targets only)
+    struct latency_hist connect_latency;  // connect() to established / first datagram reply
+    struct latency_hist move_latency;     // Player move sent to next prompt or result line
+    struct latency_hist game_latency;     // Whole game
+};
+
+static struct loadgen_stats stats;
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds.
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Parses a mync-style client address: TCPChost,port UDPChost,port UDSCSpath UDSCDpath.
+ *
+ * @param spec The address string.
+ * @param target The target to fill.
+ */
+static void parse_target(char *spec, struct target *target) {
+    memset(target, 0, sizeof(*target));
+    if (strncmp(spec, "TCPC", 4) == 0 || strncmp(spec, "UDPC", 4) == 0) {
+        target->family = AF_INET;
+        target->type = spec[0] == 'T' ? SOCK_STREAM : SOCK_DGRAM;
+        char *ip = strtok(spec + 4, ",");  // Extract the IP address
+        char *port = strtok(NULL, ",");    // Extract the port number
+        if (ip == NULL || port == NULL) {
+            fprintf(stderr, "Invalid address, expected host,port\n");
+            exit(1);
+        }
+        if (strcmp(ip, "localhost") == 0) {
+            ip = "127.0.0.1";
+        }
+        struct sockaddr_in *in = (struct sockaddr_in *)&target->addr;
+        in->sin_family = AF_INET;
+        in->sin_port = htons(atoi(port));
+        if (inet_pton(AF_INET, ip, &in->sin_addr) <= 0) {
+            fprintf(stderr, "Invalid IP address: %s\n", ip);
+            exit(1);
+        }
+        target->addr_len = sizeof(*in);
+    } else if (strncmp(spec, "UDSCS", 5) == 0 || strncmp(spec, "UDSCD", 5) == 0) {
+        target->family = AF_UNIX;
+        target->type = spec[4] == 'S' ? SOCK_STREAM : SOCK_DGRAM;
+        struct sockaddr_un *un = (struct sockaddr_un *)&target->addr;
+        un->sun_family = AF_UNIX;
+        strncpy(un->sun_path, spec + 5, sizeof(un->sun_path) - 1);
+        target->addr_len = sizeof(*un);
+    } else {
+        fprintf(stderr, "Invalid target type: %s\n", spec);
+        exit(1);
+    }
+}
+
+/**
+ * @brief Releases a session's socket and marks the slot free.
+ */
+static void session_close(struct session *session) {
+    // Count the data segments the server sent on this connection (fails harmlessly on other transports)
+    struct tcp_info info;
+    socklen_t info_len = sizeof(info);
+    if (getsockopt(session->fd, IPPROTO_TCP, TCP_INFO, &info, &info_len) == 0 &&
+        info_len >= offsetof(struct tcp_info, tcpi_data_segs_in) + sizeof(info.tcpi_data_segs_in)) {
+        stats.tcp_segments += info.tcpi_data_segs_in;
+    }
+    close(session->fd);
+    if (session->local_path[0] != '\0') {
+        unlink(session->local_path);
+        session->local_path[0] = '\0';
+    }
+    session->state = SESSION_FREE;
+}
+
+/**
+ * @brief Opens a new connection and starts a game in the given slot.
+ *
+ * @param session The free slot.
+ * @param target The server.
+ * @param slot The slot index (used for unique datagram paths).
+ */
+static void session_start(struct session *session, const struct target *target, int slot) {
+    memset(session, 0, sizeof(*session));
+    for (int i = 0; i < SIZE; i++) {
+        for (int j = 0; j < SIZE; j++) {
+            session->board[i][j] = ' ';
+        }
+    }
+    session->seed = (unsigned int)(now_ns() ^ slot);
+    session->started_ns = session->last_activity_ns = now_ns();
+    stats.games_started++;
+
+    session->fd = socket(target->family, target->type | SOCK_NONBLOCK, 0);
+    if (session->fd == -1) {
+        stats.connect_errors++;
+        return;
+    }
+
+    // A datagram server replies to our address, so Unix datagram clients must bind one
+    if (target->family == AF_UNIX && target->type == SOCK_DGRAM) {
+        struct sockaddr_un local;
+        memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        snprintf(local.sun_path, sizeof(local.sun_path), "/tmp/loadgen_%d_%d.sock", getpid(), slot);
+        unlink(local.sun_path);
+        if (bind(session->fd, (struct sockaddr *)&local, sizeof(local)) == -1) {
+            stats.connect_errors++;
+            close(session->fd);
+            return;
+        }
+        strcpy(session->local_path, local.sun_path);
+    }
+
+    if (connect(session->fd, (struct sockaddr *)&target->addr, target->addr_len) == -1 && errno != EINPROGRESS) {
+        stats.connect_errors++;
+        session_close(session);
+        return;
+    }
+
+    if (target->type == SOCK_DGRAM) {
+        // mync's datagram servers learn the client from the first datagram and do not relay it
+        if (send(session->fd, "hello\n", 6, 0) == -1) {
+            stats.connect_errors++;
+            session_close(session);
+            return;
+        }
+        session->state = SESSION_PLAYING;
+    } else {
+        session->state = SESSION_CONNECTING;
+    }
+}
+
+/**
+ * @brief Ends a game and records its duration.
+ */
+static void session_finish(struct session *session, unsigned long long *result_counter) {
+    (*result_counter)++;
+    stats.turns++;
+    stats.games_finished++;
+    hist_record(&stats.game_latency, now_ns() - session->started_ns);
+    session_close(session);
+}
+
+/**
+ * @brief Picks a random empty cell and sends it as the player's move.
+ */
+static void session_move(struct session *session) {
+    int empty[SIZE * SIZE];
+    int count = 0;
+    for (int i = 0; i < SIZE * SIZE; i++) {
+        if (session->board[i / SIZE][i % SIZE] == ' ') {
+            empty[count++] = i;
+        }
+    }
+    if (count == 0) {
+        stats.protocol_errors++;  // Prompted on a full board
+        session_close(session);
+        return;
+    }
+    int cell = empty[rand_r(&session->seed) % count];
+    session->board[cell / SIZE][cell % SIZE] = 'O';
+
+    char move[8];
+    int len = snprintf(move, sizeof(move), "%d\n", cell + 1);
+    if (send(session->fd, move, len, MSG_NOSIGNAL) != len) {
+        stats.io_errors++;
+        session_close(session);
+        return;
+    }
+    session->move_sent_ns = now_ns();
+}
+
+/**
+ * @brief Records the latency of an outstanding move once the server has answered it.
+ */
+static void session_move_answered(struct session *session) {
+    if (session->move_sent_ns != 0) {
+        hist_record(&stats.move_latency, now_ns() - session->move_sent_ns);
+        session->move_sent_ns = 0;
+    }
+}
+
+/**
+ * @brief Interprets one complete line of ttt output.
+ *
+ * @return int 1 if the game ended, 0 otherwise.
+ */
+static int session_line(struct session *session, const char *line) {
+    if (strncmp(line, "| ", 2) == 0 && strlen(line) >= 4 * SIZE) {
+        // A board row rendered by displayBoard: "| c | c | c |"
+        int row = session->rows_seen % SIZE;
+        for (int col = 0; col < SIZE; col++) {
+            session->board[row][col] = line[2 + 4 * col];
+        }
+        session->rows_seen++;
+    } else if (strcmp(line, "AI win") == 0) {
+        session_move_answered(session);
+        session_finish(session, &stats.ai_wins);
+        return 1;
+    } else if (strcmp(line, "AI lost") == 0) {
+        session_move_answered(session);
+        session_finish(session, &stats.ai_losses);
+        return 1;
+    } else if (strcmp(line, "DRAW") == 0) {
+        session_move_answered(session);
+        session_finish(session, &stats.draws);
+        return 1;
+    } else if (strncmp(line, "Invalid move", 12) == 0 || strncmp(line, "That spot", 9) == 0) {
+        stats.protocol_errors++;  // Our board copy disagreed with the server
+    }
+    return 0;
+}
+
+/**
+ * @brief Consumes output from the server and plays when prompted.
+ */
+static void session_input(struct session *session, const char *data, size_t len) {
+    session->last_activity_ns = now_ns();
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == '\n') {
+            session->line[session->line_len] = '\0';
+            session->line_len = 0;
+            if (session_line(session, session->line)) {
+                return;
+            }
+            continue;
+        }
+        if (session->line_len < LINE_MAX_LEN - 1) {
+            session->line[session->line_len++] = data[i];
+        }
+    }
+
+    // The prompt is not newline-terminated, so check the partial line
+    session->line[session->line_len] = '\0';
+    if (session->line_len >= strlen(PROMPT) &&
+        strcmp(session->line + session->line_len - strlen(PROMPT), PROMPT) == 0) {
+        session->line_len = 0;
+        stats.turns++;
+        session_move_answered(session);
+        session_move(session);
+    }
+}
+
+/**
+ * @brief Handles poll events for one session.
+ */
+static void session_event(struct session *session, short revents) {
+    if (session->state == SESSION_CONNECTING) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        getsockopt(session->fd, SOL_SOCKET, SO_ERROR, &error, &len);
+        if (error != 0) {
+            stats.connect_errors++;
+            session_close(session);
+            return;
+        }
+        session->state = SESSION_PLAYING;
+        session->connected = 1;
+        hist_record(&stats.connect_latency, now_ns() - session->started_ns);
+        return;
+    }
+
+    if (revents & (POLLIN | POLLERR | POLLHUP)) {
+        char buffer[4096];
+        ssize_t n = recv(session->fd, buffer, sizeof(buffer), 0);
+        if (n == -1 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+        if (n <= 0) {
+            if (session->connected) {
+                stats.io_errors++;  // Server went away mid-game
+            } else {
+                stats.connect_errors++;  // Refused before the game started
+            }
+            session_close(session);
+            return;
+        }
+        stats.reads++;
+        if (!session->connected) {
+            session->connected = 1;  // Datagram transports: first reply from the server
+            hist_record(&stats.connect_latency, now_ns() - session->started_ns);
+        }
+        session_input(session, buffer, n);
+    }
+}
+
+/**
+ * @brief Raises the open file limit so thousands of sessions fit in one process.
+ */
+static void raise_fd_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int concurrency = 1;      // Sessions kept open at once
+    long games = -1;          // Total games to play (-1: one per session)
+    int timeout_ms = 5000;    // Idle timeout per session
+    int verbose = 0;          // Print the full histogram buckets
+    int option;
+
+    while ((option = getopt(argc, argv, "c:g:t:v")) != -1) {
+        switch (option) {
+            case 'c':
+                concurrency = atoi(optarg);
+                break;
+            case 'g':
+                games = atol(optarg);
+                break;
+            case 't':
+                timeout_ms = atoi(optarg);
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-c sessions] [-g games] [-t timeout_ms] [-v] TCPChost,port|UDPChost,port|UDSCSpath|UDSCDpath\n", argv[0]);
+                exit(1);
+        }
+    }
+    if (optind >= argc || concurrency < 1) {
+        fprintf(stderr, "Usage: %s [-c sessions] [-g games] [-t timeout_ms] [-v] TCPChost,port|UDPChost,port|UDSCSpath|UDSCDpath\n", argv[0]);
+        exit(1);
+    }
+    if (games < 0) {
+        games = concurrency;
+    }
+
+    struct target target;
+    parse_target(argv[optind], &target);
+    raise_fd_limit();
+
+    hist_init(&stats.connect_latency, "connect");
+    hist_init(&stats.move_latency, "move");
+    hist_init(&stats.game_latency, "game");
+
+    struct session *sessions = calloc(concurrency, sizeof(struct session));
+    struct pollfd *pfds = calloc(concurrency, sizeof(struct pollfd));
+    int *owners = calloc(concurrency, sizeof(int));
+    if (sessions == NULL || pfds == NULL || owners == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+
+    long long start = now_ns();
+    while (1) {
+        // Keep every slot busy until all games have been started
+        int active = 0;
+        for (int i = 0; i < concurrency; i++) {
+            if (sessions[i].state == SESSION_FREE && (long)stats.games_started < games) {
+                session_start(&sessions[i], &target, i);
+            }
+            if (sessions[i].state != SESSION_FREE) {
+                pfds[active].fd = sessions[i].fd;
+                pfds[active].events = sessions[i].state == SESSION_CONNECTING ? POLLOUT : POLLIN;
+                pfds[active].revents = 0;
+                owners[active++] = i;
+            }
+        }
+        if (active == 0) {
+            break;  // Every game has finished or failed
+        }
+
+        int ready = poll(pfds, active, 100);
+        if (ready == -1 && errno != EINTR) {
+            perror("poll");
+            exit(1);
+        }
+        for (int i = 0; i < active && ready > 0; i++) {
+            if (pfds[i].revents != 0) {
+                session_event(&sessions[owners[i]], pfds[i].revents);
+            }
+        }
+
+        // Expire sessions that have been silent for too long
+        long long now = now_ns();
+        for (int i = 0; i < concurrency; i++) {
+            if (sessions[i].state != SESSION_FREE &&
+                now - sessions[i].last_activity_ns > (long long)timeout_ms * 1000000LL) {
+                stats.timeouts++;
+                session_close(&sessions[i]);
+            }
+        }
+    }
+    double seconds = (now_ns() - start) / 1e9;
+
+    printf("sessions=%d games=%llu finished=%llu seconds=%.3f games_per_sec=%.1f\n", concurrency,
+           stats.games_started, stats.games_finished, seconds, stats.games_finished / seconds);
+    printf("results: ai_win=%llu ai_lost=%llu draw=%llu\n", stats.ai_wins, stats.ai_losses, stats.draws);
+    printf("errors: connect=%llu io=%llu timeout=%llu protocol=%llu\n", stats.connect_errors,
+           stats.io_errors, stats.timeouts, stats.protocol_errors);
+    double turns = stats.turns > 0 ? stats.turns : 1;
+    printf("packets: turns=%llu reads_per_turn=%.2f tcp_segments_per_turn=%.2f\n", stats.turns,
+           stats.reads / turns, stats.tcp_segments / turns);
+    if (verbose) {
+        hist_print(&stats.connect_latency, stdout);
+        hist_print(&stats.move_latency, stdout);
+        hist_print(&stats.game_latency, stdout);
+    } else {
+        const struct latency_hist *hists[] = {&stats.connect_latency, &stats.move_latency, &stats.game_latency};
+        for (int i = 0; i < 3; i++) {
+            printf("%s latency: count=%llu p50=%.1fus p99=%.1fus p999=%.1fus max=%.1fus\n", hists[i]->name,
+                   hists[i]->count, hist_percentile(hists[i], 50) / 1000.0, hist_percentile(hists[i], 99) / 1000.0,
+                   hist_percentile(hists[i], 99.9) / 1000.0, hists[i]->max / 1000.0);
+        }
+    }
+
+    free(sessions);
+    free(pfds);
+    free(owners);
+    return stats.games_finished == stats.games_started ? 0 : 1;
+}
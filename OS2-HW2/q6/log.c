@@ -0,0 +1,292 @@
+#include <stdio.h>          // vsnprintf(), error messages
+#include <stdlib.h>         // exit(), atexit()
+#include <stdarg.h>         // Variadic log calls
+#include <stdint.h>         // uint64_t eventfd counters
+#include <string.h>         // String manipulation functions
+#include <strings.h>        // strncasecmp()
+#include <unistd.h>         // write(), close()
+#include <errno.h>          // Error number definitions
+#include <fcntl.h>          // open()
+#include <poll.h>           // Sleeping on the eventfd
+#include <signal.h>         // Keeping signals off the writer thread
+#include <pthread.h>        // Writer thread
+#include <time.h>           // Timestamps
+#include <sys/eventfd.h>    // Wakeups
+#include "log.h"
+
+/**
+ * @brief The logger: a bounded multi-producer ring drained by one writer thread.
+ *
+ * Producers claim a slot with a compare-and-swap on tail and publish it
+ * through the slot's sequence, so any thread may log without a lock. A full
+ * ring drops the record and counts it rather than waiting for the writer.
+ */
+static struct {
+    struct log_record ring[LOG_RING_SIZE];   // The records
+    _Alignas(64) _Atomic unsigned long tail;  // Next position producers claim
+    _Alignas(64) unsigned long head;          // Next position the writer consumes
+    _Atomic int writer_sleeping;              // The writer is (about to be) waiting on wake_fd
+    _Atomic int stopping;                     // log_shutdown() was called
+    _Atomic unsigned long long dropped;       // Records lost to a full ring
+    enum log_level level;                     // Least severe level kept
+    int fd;                                   // Where records are written
+    int wake_fd;                              // eventfd producers signal when the writer sleeps
+    int started;                              // The writer thread is running
+    pthread_t writer;                         // The writer thread
+} logger = {.level = LOG_LEVEL_INFO, .fd = STDERR_FILENO, .wake_fd = -1};
+
+static const char *level_names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+/**
+ * @brief Signals the writer's eventfd.
+ */
+static void log_wake(void) {
+    uint64_t one = 1;
+    ssize_t written = write(logger.wake_fd, &one, sizeof(one));
+    (void)written;  // EAGAIN means the counter is already non-zero, so the writer wakes anyway
+}
+
+/**
+ * @brief Writes all of a buffer, retrying short writes. Errors are ignored; there is nowhere to report them.
+ */
+static void log_write_fd(const char *buffer, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(logger.fd, buffer, length);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        buffer += n;
+        length -= n;
+    }
+}
+
+/**
+ * @brief Formats a record as one line: UTC timestamp, level, message.
+ *
+ * @return int The line's length.
+ */
+static int log_format_line(const struct log_record *record, char *line, size_t size) {
+    time_t seconds = record->timestamp_ns / 1000000000LL;
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    int length = strftime(line, size, "%Y-%m-%dT%H:%M:%S", &tm);
+    length += snprintf(line + length, size - length, ".%06lldZ %-5s %.*s\n",
+                       record->timestamp_ns % 1000000000LL / 1000, level_names[record->level],
+                       record->length, record->message);
+    return length < (int)size ? length : (int)size - 1;
+}
+
+/**
+ * @brief Moves every published record into lines and writes them, a batch per write().
+ *
+ * @return int The number of records written.
+ */
+static int log_drain(void) {
+    char batch[LOG_BATCH_MAX * (LOG_MESSAGE_MAX + 48)];
+    size_t used = 0;
+    int count = 0;
+    int batched = 0;
+    while (1) {
+        struct log_record *record = &logger.ring[logger.head & (LOG_RING_SIZE - 1)];
+        if (atomic_load_explicit(&record->sequence, memory_order_acquire) != logger.head + 1) {
+            break;  // Not yet published
+        }
+        used += log_format_line(record, batch + used, sizeof(batch) - used);
+        atomic_store_explicit(&record->sequence, logger.head + LOG_RING_SIZE, memory_order_release);
+        logger.head++;
+        count++;
+        if (++batched == LOG_BATCH_MAX) {
+            log_write_fd(batch, used);
+            used = 0;
+            batched = 0;
+        }
+    }
+    if (used > 0) {
+        log_write_fd(batch, used);
+    }
+    return count;
+}
+
+/**
+ * @brief Writer thread: drains the ring, sleeping on the eventfd while it is empty.
+ */
+static void *log_writer_main(void *arg) {
+    while (1) {
+        if (log_drain() > 0) {
+            continue;
+        }
+        if (atomic_load(&logger.stopping)) {
+            break;
+        }
+        // Announce sleeping before the final check, so a producer either sees it or we see its record
+        atomic_store(&logger.writer_sleeping, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        struct log_record *record = &logger.ring[logger.head & (LOG_RING_SIZE - 1)];
+        if (atomic_load(&record->sequence) == logger.head + 1 || atomic_load(&logger.stopping)) {
+            atomic_store(&logger.writer_sleeping, 0);
+            continue;
+        }
+        struct pollfd pfd = {logger.wake_fd, POLLIN, 0};
+        if (poll(&pfd, 1, -1) == 1) {
+            uint64_t count;
+            if (read(logger.wake_fd, &count, sizeof(count)) == -1) {
+                continue;  // Another wakeup consumed it; nothing to do
+            }
+        }
+    }
+    log_drain();
+    return NULL;
+}
+
+/**
+ * @brief Sets the log's destination and level. Records are written synchronously until log_start().
+ *
+ * @param spec "[level:]path", where path "-" is stderr; NULL logs INFO and above to stderr.
+ */
+void log_init(const char *spec) {
+    if (spec != NULL) {
+        const char *colon = strchr(spec, ':');
+        if (colon != NULL) {
+            int found = 0;
+            for (int i = LOG_LEVEL_DEBUG; i <= LOG_LEVEL_ERROR; i++) {
+                if (strncasecmp(spec, level_names[i], colon - spec) == 0 &&
+                    strlen(level_names[i]) == (size_t)(colon - spec)) {
+                    logger.level = i;
+                    found = 1;
+                }
+            }
+            if (!found) {
+                fprintf(stderr, "Invalid log level: %.*s (use debug, info, warn or error)\n",
+                        (int)(colon - spec), spec);
+                exit(EXIT_FAILURE);
+            }
+            spec = colon + 1;
+        }
+        if (strcmp(spec, "-") != 0) {
+            logger.fd = open(spec, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (logger.fd == -1) {
+                perror("Error opening log file");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Starts the writer thread; from then on records go through the ring.
+ *
+ * Called once setup is done, so startup lines and the fatal errors that
+ * setup reports directly on stderr keep their order.
+ */
+void log_start(void) {
+    if (logger.started) {
+        return;
+    }
+    for (unsigned long i = 0; i < LOG_RING_SIZE; i++) {
+        atomic_init(&logger.ring[i].sequence, i);
+    }
+    logger.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (logger.wake_fd == -1) {
+        perror("Error creating log eventfd");
+        exit(EXIT_FAILURE);
+    }
+
+    // The writer takes no signals, so signalfd and EINTR-driven handlers keep working on the main thread
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    int error = pthread_create(&logger.writer, NULL, log_writer_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (error != 0) {
+        fprintf(stderr, "Error starting the log writer: %s\n", strerror(error));
+        exit(EXIT_FAILURE);
+    }
+    logger.started = 1;
+    atexit(log_shutdown);
+}
+
+/**
+ * @brief Logs a record. Never blocks: formats into a ring slot, or drops the record if the ring is full.
+ *
+ * Before log_start() and after log_shutdown() the line is written directly.
+ *
+ * @param level The record's severity.
+ * @param format printf() format of the message.
+ */
+void log_write(enum log_level level, const char *format, ...) {
+    if (level < logger.level) {
+        return;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    va_list args;
+    va_start(args, format);
+
+    if (!logger.started) {
+        struct log_record record;
+        record.level = level;
+        record.timestamp_ns = (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+        record.length = vsnprintf(record.message, sizeof(record.message), format, args);
+        record.length = record.length < LOG_MESSAGE_MAX ? record.length : LOG_MESSAGE_MAX - 1;
+        va_end(args);
+        char line[LOG_MESSAGE_MAX + 48];
+        log_write_fd(line, log_format_line(&record, line, sizeof(line)));
+        return;
+    }
+
+    // Claim the slot at tail: free for us when its sequence equals our position
+    unsigned long position = atomic_load_explicit(&logger.tail, memory_order_relaxed);
+    struct log_record *record;
+    while (1) {
+        record = &logger.ring[position & (LOG_RING_SIZE - 1)];
+        long turn = (long)(atomic_load_explicit(&record->sequence, memory_order_acquire) - position);
+        if (turn == 0) {
+            if (atomic_compare_exchange_weak_explicit(&logger.tail, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (turn < 0) {
+            atomic_fetch_add_explicit(&logger.dropped, 1, memory_order_relaxed);  // Ring full
+            va_end(args);
+            return;
+        } else {
+            position = atomic_load_explicit(&logger.tail, memory_order_relaxed);
+        }
+    }
+    record->level = level;
+    record->timestamp_ns = (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    int length = vsnprintf(record->message, sizeof(record->message), format, args);
+    record->length = length < LOG_MESSAGE_MAX ? length : LOG_MESSAGE_MAX - 1;
+    va_end(args);
+    atomic_store_explicit(&record->sequence, position + 1, memory_order_release);
+
+    // Wake the writer only if it sleeps, so a busy logger costs no system call per record
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&logger.writer_sleeping, memory_order_relaxed) &&
+        atomic_exchange(&logger.writer_sleeping, 0)) {
+        log_wake();
+    }
+}
+
+/**
+ * @brief Writes every record still in the ring and stops the writer thread. Registered with atexit().
+ */
+void log_shutdown(void) {
+    if (!logger.started) {
+        return;
+    }
+    atomic_store(&logger.stopping, 1);
+    log_wake();
+    pthread_join(logger.writer, NULL);
+    logger.started = 0;
+}
+
+/**
+ * @brief Returns how many records were dropped because the ring was full.
+ */
+unsigned long long log_dropped(void) {
+    return atomic_load_explicit(&logger.dropped, memory_order_relaxed);
+}
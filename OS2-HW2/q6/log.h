@@ -0,0 +1,46 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdatomic.h>  // Slot sequence numbers shared between producers and the writer thread
+
+#define LOG_RING_SIZE 1024   // Records the ring holds, a power of two
+#define LOG_MESSAGE_MAX 232  // Longest message kept; longer ones are truncated
+#define LOG_BATCH_MAX 64     // Records formatted into one write()
+
+/**
+ * @brief Severity of a log record; records below the configured level are discarded unformatted.
+ */
+enum log_level {
+    LOG_LEVEL_DEBUG,  // Per-event detail
+    LOG_LEVEL_INFO,   // Connections, sessions and their ends
+    LOG_LEVEL_WARN,   // Sessions cut short: timeouts, relay errors
+    LOG_LEVEL_ERROR,  // Failures mync keeps running through
+};
+
+/**
+ * @brief One slot of the ring.
+ *
+ * sequence tells whose turn the slot is: equal to the enqueue position
+ * when free for that producer, one more once the record is published, and
+ * advanced by a whole ring when the writer thread has consumed it.
+ */
+struct log_record {
+    _Atomic unsigned long sequence;  // Turn of the slot, see above
+    enum log_level level;            // Severity
+    long long timestamp_ns;          // Wall-clock time the record was made
+    int length;                      // Bytes in message
+    char message[LOG_MESSAGE_MAX];   // Formatted message, without a newline
+};
+
+void log_init(const char *spec);
+void log_start(void);
+void log_write(enum log_level level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void log_shutdown(void);
+unsigned long long log_dropped(void);
+
+#define log_debug(...) log_write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define log_info(...) log_write(LOG_LEVEL_INFO, __VA_ARGS__)
+#define log_warn(...) log_write(LOG_LEVEL_WARN, __VA_ARGS__)
+#define log_error(...) log_write(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,152 @@
+#include <stdio.h>       // Standard I/O library
+#include <stdlib.h>      // Standard library for general functions
+#include <unistd.h>      // Unix standard functions
+#include <string.h>      // String manipulation functions
+#include <errno.h>       // Error number definitions
+#include <signal.h>      // Signal handling
+#include <poll.h>        // Idle timeout
+#include <time.h>        // Monotonic clock
+#include <getopt.h>      // Command line option parsing
+#include <sys/socket.h>  // Sockets API
+#include <netinet/in.h>  // Internet domain address structures
+#include <arpa/inet.h>   // Functions for IP address conversion
+
+#define SUB_MAX_DATAGRAM 65536  // Largest datagram accepted
+
+static volatile sig_atomic_t stopping = 0;  // Set by SIGINT/SIGTERM
+
+/**
+ * @brief Stops the receive loop so the summary is printed.
+ */
+static void handle_stop(int signum) {
+    stopping = 1;
+}
+
+/**
+ * @brief Returns the monotonic clock in seconds.
+ */
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Joins a multicast group and prints (or just counts) what mync publishes to it with -o UDPM.
+ *
+ * Any number of subscribers can run at once, on this host or elsewhere on
+ * the network; each joins the group and binds the shared port.
+ */
+int main(int argc, char *argv[]) {
+    const char *interface = NULL;  // Address of the interface to join on, NULL for the default
+    int quiet = 0;                 // Count datagrams without printing them
+    unsigned long limit = 0;       // Exit after this many datagrams, 0 for no limit
+    int idle_ms = -1;              // Exit after this long without a datagram, -1 to wait forever
+    int option;
+
+    while ((option = getopt(argc, argv, "i:qn:t:")) != -1) {
+        switch (option) {
+            case 'i':
+                interface = optarg;
+                break;
+            case 'q':
+                quiet = 1;
+                break;
+            case 'n':
+                limit = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                idle_ms = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-i interface_addr] [-q] [-n count] [-t idle_ms] group port\n", argv[0]);
+                exit(1);
+        }
+    }
+    if (argc - optind != 2) {
+        fprintf(stderr, "Usage: %s [-i interface_addr] [-q] [-n count] [-t idle_ms] group port\n", argv[0]);
+        exit(1);
+    }
+
+    struct ip_mreq membership;
+    memset(&membership, 0, sizeof(membership));
+    if (inet_pton(AF_INET, argv[optind], &membership.imr_multiaddr) <= 0 ||
+        !IN_MULTICAST(ntohl(membership.imr_multiaddr.s_addr))) {
+        fprintf(stderr, "mcast_sub: invalid multicast group %s\n", argv[optind]);
+        exit(1);
+    }
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (interface != NULL && inet_pton(AF_INET, interface, &membership.imr_interface) <= 0) {
+        fprintf(stderr, "mcast_sub: invalid interface address %s\n", interface);
+        exit(1);
+    }
+
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd == -1) {
+        perror("mcast_sub: socket");
+        exit(1);
+    }
+    // Several subscribers on one host share the port
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &(int){1}, sizeof(int));
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &(int){1 << 20}, sizeof(int));
+
+    // Bind the group address so datagrams for other groups on the same port are not delivered here
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(atoi(argv[optind + 1]));
+    addr.sin_addr = membership.imr_multiaddr;
+    if (bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        perror("mcast_sub: bind");
+        exit(1);
+    }
+    if (setsockopt(sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) == -1) {
+        perror("mcast_sub: join group");
+        exit(1);
+    }
+
+    struct sigaction stop_action;
+    memset(&stop_action, 0, sizeof(stop_action));
+    stop_action.sa_handler = handle_stop;
+    sigaction(SIGINT, &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+
+    char *buffer = malloc(SUB_MAX_DATAGRAM);
+    unsigned long datagrams = 0;
+    unsigned long long bytes = 0;
+    double first = 0, last = 0;
+    while (!stopping && (limit == 0 || datagrams < limit)) {
+        struct pollfd pfd = {sockfd, POLLIN, 0};
+        int ready = poll(&pfd, 1, idle_ms);
+        if (ready == 0) {
+            break;  // Idle for idle_ms
+        }
+        if (ready == -1) {
+            continue;  // EINTR; stopping is checked above
+        }
+        ssize_t n = recv(sockfd, buffer, SUB_MAX_DATAGRAM, 0);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("mcast_sub: recv");
+            exit(1);
+        }
+        last = now_s();
+        if (datagrams++ == 0) {
+            first = last;
+        }
+        bytes += n;
+        if (!quiet) {
+            fwrite(buffer, 1, n, stdout);
+            fflush(stdout);
+        }
+    }
+
+    double seconds = last - first;
+    fprintf(stderr, "mcast_sub: %lu datagrams, %llu bytes in %.3f s (%.0f datagrams/s, %.2f MB/s)\n", datagrams,
+            bytes, seconds, seconds > 0 ? datagrams / seconds : 0, seconds > 0 ? bytes / seconds / 1048576 : 0);
+    free(buffer);
+    close(sockfd);
+    return 0;
+}
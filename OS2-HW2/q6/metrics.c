@@ -0,0 +1,301 @@
+#define _GNU_SOURCE  // accept4()
+#include <stdio.h>       // Formatted output
+#include <stdlib.h>      // Memory allocation
+#include <stddef.h>      // offsetof()
+#include <string.h>      // String manipulation functions
+#include <unistd.h>      // Unix standard functions
+#include <errno.h>       // Error number definitions
+#include <sys/socket.h>  // Sockets API
+#include <sys/un.h>      // Unix domain sockets
+#include <netinet/in.h>  // Internet domain address structures
+#include "metrics.h"
+#include "log.h"
+
+#define METRICS_REQUEST_MAX 2048    // Request bytes kept before answering anyway
+#define METRICS_RESPONSE_MAX 16384  // Room for the whole exposition, including per-worker families
+
+struct mync_metrics metrics;
+
+/**
+ * @brief One scrape in progress: the request read so far and the response being written.
+ */
+struct metrics_client {
+    char request[METRICS_REQUEST_MAX];  // Request bytes read so far
+    size_t request_len;                 // Bytes in request
+    char response[METRICS_RESPONSE_MAX + 256];  // HTTP header plus exposition
+    size_t response_len;                // Bytes in response
+    size_t sent;                        // Response bytes already written
+};
+
+/**
+ * @brief Returns the label value used for a transport.
+ *
+ * @param transport The transport.
+ * @return const char* The Prometheus label value.
+ */
+const char *transport_name(enum transport transport) {
+    static const char *names[TRANSPORT_COUNT] = {"stdio", "tcp", "udp", "uds_stream", "uds_dgram", "shm"};
+    return names[transport];
+}
+
+/**
+ * @brief Appends one metric with its HELP and TYPE lines.
+ */
+static int format_metric(char *buffer, int size, int used, const char *name, const char *type,
+                         const char *help, unsigned long long value) {
+    if (used >= size) {
+        return used;
+    }
+    return used + snprintf(buffer + used, size - used, "# HELP %s %s\n# TYPE %s %s\n%s %llu\n",
+                           name, help, name, type, name, value);
+}
+
+/**
+ * @brief Appends a per-transport counter family.
+ */
+static int format_transport_metric(char *buffer, int size, int used, const char *name, const char *help,
+                                   const unsigned long long *values) {
+    if (used < size) {
+        used += snprintf(buffer + used, size - used, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+    }
+    for (int i = 0; i < TRANSPORT_COUNT && used < size; i++) {
+        used += snprintf(buffer + used, size - used, "%s{transport=\"%s\"} %llu\n", name,
+                         transport_name(i), values[i]);
+    }
+    return used;
+}
+
+/**
+ * @brief Appends a per-worker counter family read from each worker's stats.
+ *
+ * @param offset Offset of the counter in struct work_worker_stats.
+ * @param scale Divisor turning the counter into the exported unit (1 for plain counts).
+ */
+static int format_worker_metric(char *buffer, int size, int used, const char *name, const char *help,
+                                struct work_pool *pool, size_t offset, double scale) {
+    if (used < size) {
+        used += snprintf(buffer + used, size - used, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+    }
+    for (int i = 0; i < pool->worker_count && used < size; i++) {
+        // Each counter is written only by its worker; a relaxed read may lag it slightly
+        _Atomic unsigned long long *counter = (void *)((char *)&pool->workers[i].stats + offset);
+        unsigned long long value = atomic_load_explicit(counter, memory_order_relaxed);
+        if (scale == 1) {
+            used += snprintf(buffer + used, size - used, "%s{worker=\"%d\"} %llu\n", name, i, value);
+        } else {
+            used += snprintf(buffer + used, size - used, "%s{worker=\"%d\"} %.6f\n", name, i, value / scale);
+        }
+    }
+    return used;
+}
+
+/**
+ * @brief Renders every metric in Prometheus text exposition format.
+ *
+ * @param buffer The output buffer.
+ * @param size The buffer size.
+ * @return int The number of bytes written (truncated to size - 1).
+ */
+int metrics_format(char *buffer, int size) {
+    int used = 0;
+    used = format_metric(buffer, size, used, "mync_sessions_active", "gauge",
+                         "Sessions currently relaying or playing.", metrics.sessions_active);
+    used = format_metric(buffer, size, used, "mync_connections_accepted_total", "counter",
+                         "Peers accepted by server transports.", metrics.connections_accepted);
+    used = format_metric(buffer, size, used, "mync_connections_refused_total", "counter",
+                         "Peers that could not be accepted or served.", metrics.connections_refused);
+    used = format_transport_metric(buffer, size, used, "mync_bytes_in_total", "Bytes read per transport.",
+                                   metrics.bytes_in);
+    used = format_transport_metric(buffer, size, used, "mync_bytes_out_total", "Bytes written per transport.",
+                                   metrics.bytes_out);
+    used = format_metric(buffer, size, used, "mync_child_spawns_total", "counter",
+                         "Commands started with -e.", metrics.child_spawns);
+    used = format_metric(buffer, size, used, "mync_child_exits_total", "counter",
+                         "Commands that exited and were reaped.", metrics.child_exits);
+    used = format_metric(buffer, size, used, "mync_child_failures_total", "counter",
+                         "Commands that exited non-zero or were killed by a signal.", metrics.child_failures);
+    used = format_metric(buffer, size, used, "mync_timeouts_total", "counter",
+                         "Timeouts that ended a session.", metrics.timeouts_fired);
+    used = format_metric(buffer, size, used, "mync_write_queue_bytes", "gauge",
+                         "Bytes buffered awaiting a write.", metrics.write_queue_bytes);
+    used = format_metric(buffer, size, used, "mync_watchers_active", "gauge",
+                         "Spectators connected with -W.", metrics.watchers_active);
+    used = format_metric(buffer, size, used, "mync_watchers_dropped_total", "counter",
+                         "Spectators disconnected for lagging.", metrics.watchers_dropped);
+    used = format_metric(buffer, size, used, "mync_watcher_bytes_out_total", "counter",
+                         "Bytes written to spectators.", metrics.watcher_bytes_out);
+    used = format_metric(buffer, size, used, "mync_watcher_bytes_skipped_total", "counter",
+                         "Bytes spectators skipped for lagging.", metrics.watcher_bytes_skipped);
+    used = format_metric(buffer, size, used, "mync_watcher_zerocopy_sends_total", "counter",
+                         "Spectator writes sent with MSG_ZEROCOPY.", metrics.watcher_zerocopy_sends);
+    used = format_metric(buffer, size, used, "mync_log_records_dropped_total", "counter",
+                         "Log records dropped because the log ring was full.", log_dropped());
+    struct work_pool *pool = metrics.work_pool;
+    if (pool != NULL) {
+        used = format_worker_metric(buffer, size, used, "mync_worker_tasks_total", "Tasks run per worker.",
+                                    pool, offsetof(struct work_worker_stats, tasks), 1);
+        used = format_worker_metric(buffer, size, used, "mync_worker_steals_total",
+                                    "Tasks taken from other workers' deques.",
+                                    pool, offsetof(struct work_worker_stats, steals), 1);
+        used = format_worker_metric(buffer, size, used, "mync_worker_steal_attempts_total",
+                                    "Deques a worker tried to steal from.",
+                                    pool, offsetof(struct work_worker_stats, steal_attempts), 1);
+        used = format_worker_metric(buffer, size, used, "mync_worker_busy_seconds_total",
+                                    "Seconds each worker spent running tasks.",
+                                    pool, offsetof(struct work_worker_stats, busy_ns), 1e9);
+    }
+    return used < size ? used : size - 1;
+}
+
+/**
+ * @brief Creates the stats listener from "TCPS<port>" (loopback only) or "UDSSS<path>".
+ *
+ * The socket is non-blocking so the event loop never waits on a scraper, and
+ * close-on-exec so commands started with -e do not inherit it.
+ *
+ * @param spec The listener specification.
+ * @return int The listening socket.
+ */
+int metrics_listen(const char *spec) {
+    int sockfd;
+    if (strncmp(spec, "TCPS", 4) == 0) {
+        sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (sockfd == -1) {
+            perror("Error creating metrics socket");
+            exit(1);
+        }
+        setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &(int){1}, sizeof(int));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(atoi(spec + 4));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);  // Stats are for local scrapers only
+        if (bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+            perror("Error binding metrics socket");
+            exit(1);
+        }
+    } else if (strncmp(spec, "UDSSS", 5) == 0) {
+        sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (sockfd == -1) {
+            perror("Error creating metrics socket");
+            exit(1);
+        }
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, spec + 5, sizeof(addr.sun_path) - 1);
+        unlink(addr.sun_path);
+        if (bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+            perror("Error binding metrics socket");
+            exit(1);
+        }
+    } else {
+        fprintf(stderr, "Invalid metrics listener: %s\n", spec);
+        exit(1);
+    }
+
+    if (listen(sockfd, 16) == -1) {
+        perror("Error listening on metrics socket");
+        exit(1);
+    }
+    return sockfd;
+}
+
+/**
+ * @brief Closes a scrape connection and frees its state.
+ */
+static void metrics_client_close(struct event_loop *loop, int fd, struct metrics_client *client) {
+    event_loop_remove(loop, fd);
+    close(fd);
+    free(client);
+}
+
+/**
+ * @brief Builds the HTTP response once the request is complete.
+ */
+static void metrics_client_respond(struct metrics_client *client) {
+    char body[METRICS_RESPONSE_MAX];
+    int body_len = metrics_format(body, sizeof(body));
+    int header_len = snprintf(client->response, sizeof(client->response),
+                              "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                              "Content-Length: %d\r\nConnection: close\r\n\r\n", body_len);
+    memcpy(client->response + header_len, body, body_len);
+    client->response_len = header_len + body_len;
+    client->sent = 0;
+}
+
+/**
+ * @brief Reads the scrape request and writes the response without ever blocking.
+ */
+static void metrics_client_event(struct event_loop *loop, int fd, short revents, void *data) {
+    struct metrics_client *client = data;
+
+    if (client->response_len == 0) {
+        ssize_t n = recv(fd, client->request + client->request_len,
+                         sizeof(client->request) - 1 - client->request_len, 0);
+        if (n == -1 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+        if (n <= 0 && client->request_len == 0) {
+            metrics_client_close(loop, fd, client);  // Scraper left without asking
+            return;
+        }
+        if (n > 0) {
+            client->request_len += n;
+        }
+        client->request[client->request_len] = '\0';
+
+        // Answer at the end of the HTTP header, on a bare newline (nc/socat) or when the buffer is full
+        int complete = n <= 0 || strstr(client->request, "\r\n\r\n") != NULL ||
+                       (strncmp(client->request, "GET ", 4) != 0 && strchr(client->request, '\n') != NULL) ||
+                       client->request_len == sizeof(client->request) - 1;
+        if (!complete) {
+            return;
+        }
+        metrics_client_respond(client);
+        event_loop_modify(loop, fd, POLLOUT);
+        return;
+    }
+
+    ssize_t n = send(fd, client->response + client->sent, client->response_len - client->sent,
+                     MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n == -1 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    }
+    if (n == -1) {
+        metrics_client_close(loop, fd, client);
+        return;
+    }
+    client->sent += n;
+    if (client->sent == client->response_len) {
+        metrics_client_close(loop, fd, client);
+    }
+}
+
+/**
+ * @brief Accepts scrape connections on the stats listener.
+ */
+static void metrics_accept_event(struct event_loop *loop, int fd, short revents, void *data) {
+    int client_fd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client_fd == -1) {
+        return;  // EAGAIN or a connection that went away before accept
+    }
+    struct metrics_client *client = calloc(1, sizeof(*client));
+    if (client == NULL || event_loop_add(loop, client_fd, POLLIN, metrics_client_event, client) == -1) {
+        free(client);
+        close(client_fd);
+    }
+}
+
+/**
+ * @brief Serves the stats listener from the given event loop.
+ *
+ * @param loop The event loop that also runs the data plane.
+ * @param listen_fd A socket returned by metrics_listen().
+ */
+void metrics_serve(struct event_loop *loop, int listen_fd) {
+    if (event_loop_add(loop, listen_fd, POLLIN, metrics_accept_event, NULL) == -1) {
+        perror("Error registering metrics socket");
+        exit(1);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "event_loop.h"
+#include "work_pool.h"
+
+/**
+ * @brief Transport families that bytes are counted under.
+ */
+enum transport {
+    TRANSPORT_STDIO,       // Standard input/output
+    TRANSPORT_TCP,         // TCPS/TCPC
+    TRANSPORT_UDP,         // UDPS/UDPC
+    TRANSPORT_UDS_STREAM,  // UDSSS/UDSCS
+    TRANSPORT_UDS_DGRAM,   // UDSSD/UDSCD
+    TRANSPORT_SHM,         // SHMS/SHMC
+    TRANSPORT_COUNT
+};
+
+/**
+ * @brief Process-wide counters and gauges exported in Prometheus text format.
+ */
+struct mync_metrics {
+    unsigned long long sessions_active;                  // Gauge: sessions currently relaying or playing
+    unsigned long long connections_accepted;             // Peers accepted by server transports
+    unsigned long long connections_refused;              // Peers that could not be accepted or served
+    unsigned long long bytes_in[TRANSPORT_COUNT];        // Bytes read, per transport
+    unsigned long long bytes_out[TRANSPORT_COUNT];       // Bytes written, per transport
+    unsigned long long child_spawns;                     // Commands started with -e
+    unsigned long long child_exits;                      // Commands reaped
+    unsigned long long child_failures;                   // Commands that exited non-zero or were killed
+    unsigned long long timeouts_fired;                   // Timeouts that ended a session
+    unsigned long long write_queue_bytes;                // Gauge: bytes buffered awaiting a write
+    unsigned long long watchers_active;                  // Gauge: spectators connected with -W
+    unsigned long long watchers_dropped;                 // Spectators disconnected for lagging
+    unsigned long long watcher_bytes_out;                // Bytes written to spectators
+    unsigned long long watcher_bytes_skipped;            // Bytes spectators skipped for lagging
+    unsigned long long watcher_zerocopy_sends;           // Spectator writes sent with MSG_ZEROCOPY
+    struct work_pool *work_pool;                         // Worker pool reported per worker (-w), or NULL
+};
+
+extern struct mync_metrics metrics;
+
+const char *transport_name(enum transport transport);
+int metrics_format(char *buffer, int size);
+int metrics_listen(const char *spec);
+void metrics_serve(struct event_loop *loop, int listen_fd);
+
+#endif
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE  // Linux extensions such as pipe2()
 #include <stdio.h>  // Standard I/O library
 #include <stdlib.h>  // Standard library for general functions
 #include <unistd.h>  // Unix standard functions
@@ -5,6 +6,7 @@
 #include <sys/socket.h>  // Sockets API
 #include <sys/un.h>  // Unix domain sockets
 #include <netinet/in.h>  // Internet domain address structures
+#include <netinet/tcp.h>  // TCP_CORK
 #include <arpa/inet.h>  // Functions for IP address conversion
 #include <sys/wait.h>  // Waiting for process termination
 #include <string.h>  // String manipulation functions
@@ -15,74 +17,776 @@
 #include <netdb.h>  // Network database operations
 #include <poll.h>  // Polling for events on file descriptors
 #include <ctype.h>  // Character type functions
+#include <time.h>  // Monotonic clock for latency measurements
+#include <spawn.h>  // posix_spawnp()
+#include <pthread.h>  // Search completion list shared with the workers
+#include <sys/eventfd.h>  // Search completion wakeups
+#include "buffer_pool.h"  // Pooled ring buffers for the relay
+#include "latency_hist.h"  // Lock-free latency histograms
+#include "event_loop.h"  // poll()-based event dispatch
+#include "metrics.h"  // Counters and the Prometheus stats listener
+#include "timer_wheel.h"  // Per-session deadlines
+#include "child_watch.h"  // Asynchronous child reaping
+#include "broadcast.h"  // Spectator fan-out
+#include "shm_ring.h"  // Shared-memory channels (SHMS/SHMC)
+#include "coroutine.h"  // In-process game sessions (-g)
+#include "ttt.h"  // Tic-Tac-Toe rules, linked from ttt.c
+#include "ttt_search.h"  // Minimax AI (-g minimax)
+#include "work_pool.h"  // Work-stealing pool for AI searches (-w)
+#include "log.h"  // Asynchronous status log (-l)
+#include "trace.h"  // Per-session event timelines (-X)
+#include "probes.h"  // USDT probes for perf/bpftrace
+#include "game_store.h"  // Crash-safe store of in-process games (-G)
+#include "game_log.h"  // Binary log of every in-process game's moves (-R)
+
+#define TIMER_TICK_MS 1  // Timer wheel resolution, fine enough for -C flush windows
+#define TTT_PROMPT "Enter your move (1-9): "  // Printed by ttt's makePlayerMove, ends every turn
+#define COALESCE_DEFAULT_WINDOW_MS 100  // Flush window used with -C prompt when no window is given
+#define FRAME_BATCH 32  // Complete messages sent per sendmmsg() call
+#define WATCH_DEFAULT_LAG_KB 1024  // Spectator lag limit when -L is not given
+#define SERVER_MAX_LISTENERS 16  // -i/-b listeners one accept loop can serve
+#define SERVER_DEFAULT_SESSIONS 64  // Session limit with several listeners and no -c
+#define SHM_MAX_CHANNELS 2  // SHMS/SHMC endpoints one mync can have (an input and an output)
+#define GAME_INPUT_MAX 64  // Player input buffered per in-process game
+#define GAME_OUTPUT_MAX 512  // Game output gathered per in-process game before it is written
+#define GAME_MOVE_RESUME -1  // game_read_move() result: the player asked to resume a saved game (-G)
+
+// Latency histograms, always recorded and printed to stderr on SIGUSR1 (and at exit with -H)
+struct latency_hist relay_latency;  // Bytes read from a descriptor until the forwarded write completes
+struct latency_hist first_byte_latency;  // Peer accepted until its first byte is read
+struct latency_hist spawn_latency;  // posix_spawnp() in executeCommand until the command has exec'd
+struct latency_hist child_runtime;  // Lifetime of each command started with -e
+volatile sig_atomic_t dump_requested = 0;  // Set by SIGUSR1
+volatile sig_atomic_t stop_requested = 0;  // Set by SIGINT/SIGTERM, so mync exits through exit()
+struct event_loop loop;  // Serves setup, relaying, the stats listener and the timer wheel
+struct timer_wheel wheel;  // Session deadlines
 
-#define SIZE 3  // Define the size of the Tic-Tac-Toe board
+/**
+ * @brief Deadlines applied to every session, in milliseconds (0 disables one).
+ */
+struct session_deadlines {
+    long long connect_ms;  // From session start until every peer is connected
+    long long idle_ms;  // Longest gap without relayed data
+    long long game_ms;  // From the peers connecting until the session must end
+};
 
 /**
- * @brief Executes a given command with its arguments.
+ * @brief Where a session is in its lifetime.
+ */
+enum session_state {
+    SESSION_CONNECTING,  // Waiting for peers
+    SESSION_ACTIVE,  // Relaying or running the command
+};
+
+/**
+ * @brief One relay direction: data read from one descriptor is written to another.
+ */
+struct relay_direction {
+    int from;  // Descriptor to read from
+    int to;  // Descriptor to write to
+    enum transport from_transport;  // Transport counted for bytes read
+    enum transport to_transport;  // Transport counted for bytes written
+    const char *from_name;  // Name used in read error messages
+    const char *to_name;  // Name used in write error messages
+    struct ring_buffer *ring;  // Pooled ring buffer for this direction
+    int *open_directions;  // Shared count of directions that have not reached EOF
+    struct session *session;  // Session the relay belongs to
+    int splice;  // Move data with splice() instead of copying through the ring
+    int coalesce;  // Hold output until the prompt or the end of the flush window (-C)
+    int corked;  // TCP_CORK is set on to (coalescing on the splice path)
+    size_t prompt_matched;  // Prompt characters matched at the end of the data relayed so far
+    struct timer flush_timer;  // Flushes a held burst when the window ends
+    int framing;  // Message framing for datagram outputs (-F), FRAMING_NONE if off
+    size_t frame_ends[FRAME_BATCH];  // Ring positions where complete messages end
+    int frame_count;  // Complete messages waiting in the ring
+    int broadcast;  // Also publish what is written to the -W spectators
+    struct shm_channel *from_shm;  // Channel behind from (its wake_fd), or NULL for a plain descriptor
+    struct shm_channel *to_shm;  // Channel behind to, or NULL
+    int read_handle;  // Registration reading from, or -1 once it is not read
+    int write_handle;  // Registration waiting for to to take more, or -1; reading pauses meanwhile
+    int eof;  // from has ended; the direction finishes once to has taken what is queued
+    int flush_requested;  // A flush waits for to to take the messages queued ahead of it
+    size_t frame_scanned;  // Ring position up to which message boundaries have been looked for
+};
+
+/**
+ * @brief Where -F splits a datagram output into messages.
+ */
+enum framing {
+    FRAMING_NONE,  // Datagrams follow read() boundaries
+    FRAMING_LINE,  // One datagram per line, and one for the prompt
+    FRAMING_TURN,  // One datagram per turn: everything up to and including the prompt
+};
+
+/**
+ * @brief Write coalescing for stream outputs, set with -C.
+ */
+struct coalesce_config {
+    long long window_ms;  // Longest a burst is held before it is flushed, 0 if unset
+    const char *prompt;  // Flush as soon as this text has been relayed, or NULL
+};
+
+/**
+ * @brief How a command started with -e is connected to its peers.
+ */
+enum child_io {
+    CHILD_IO_DIRECT,  // The peer's descriptors become the command's stdin/stdout
+    CHILD_IO_SPLICE,  // Pipes relayed by mync, moving data with splice() where possible
+    CHILD_IO_COPY,  // Pipes relayed by mync, copying through ring buffers
+};
+
+/**
+ * @brief What a session cost in system calls and sends, counted with -B and logged when it ends.
+ */
+struct session_budget {
+    unsigned long syscalls;  // Reads, writes, splices, sendmmsg()s and corks made for the session
+    unsigned long bytes_sent;  // Bytes written to the peer
+    unsigned long packets_sent;  // Writes (stream) or datagrams sent to the peer
+    unsigned long child_writes;  // Reads of the command's output that returned data
+    unsigned long turns;  // Lines (moves) received from the peer
+};
+
+/**
+ * @brief A session: its peers, its command and its deadlines.
+ */
+struct session {
+    int id;  // Session number, used in log lines
+    enum session_state state;  // Where the session is in its lifetime
+    struct child_process process;  // Command started with -e; pid is -1 until it runs
+    struct timer connect_timer;  // Connect deadline
+    struct timer idle_timer;  // Idle deadline, re-armed lazily from last_activity_ms
+    struct timer game_timer;  // Total-game deadline
+    long long idle_ms;  // Idle limit, 0 if disabled
+    unsigned long long last_activity_ms;  // Wheel time of the last relayed data
+    int peer_in;  // Descriptor the command's input comes from (-P), or -1
+    int peer_out;  // Descriptor the command's output goes to (-P), or -1
+    enum transport peer_transports[2];  // Transports of peer_in and peer_out
+    int owns_peers;  // Close the peer descriptors when the session ends
+    int child_input;  // mync's end of the command's stdin pipe, or -1
+    int child_output;  // mync's end of the command's stdout pipe, or -1
+    struct relay_direction relay[2];  // Peer to command, and command to peer
+    int open_directions;  // Relay directions that have not reached EOF
+    int child_exited;  // The command has been reaped
+    int output_done;  // Nothing more will be relayed from the command
+    struct sockaddr_in datagram_peer;  // Client address of a session started by a UDPS listener
+    struct session *next_datagram;  // Next session in datagram_sessions, if listed
+    struct coroutine *game;  // In-process game played instead of a command (-g), or NULL
+    struct game_search *search;  // AI search running on the pool for the game, or NULL
+    long long game_started_ns;  // When the in-process game started
+    long long accept_ns;  // When the peer was accepted, 0 until then and once its first byte is seen
+    long long first_byte_ns;  // When the peer's first byte arrived, 0 until then (traced with -X)
+    struct session_budget budget;  // System calls and sends so far (-B)
+    int game_slot;  // Slot of the in-process game in the -G store, or -1
+};
+
+/**
+ * @brief An AI move searched on the worker pool while the game's coroutine is suspended.
  * 
- * @param args The command and its arguments as a single string.
+ * The worker fills in slot and queues the search on search_done; the loop
+ * then resumes the coroutine, which frees it. If the session ends first,
+ * session is cleared and the loop frees the search when it completes.
  */
-void executeCommand(char *args) {
-    // Tokenize the input arguments string
-    char *token = strtok(args, " ");
-    if (token == NULL) {
-        fprintf(stderr, "No arguments provided\n");
-        exit(1);
+struct game_search {
+    struct work_task task;  // Task running the search
+    struct session *session;  // Session waiting for the move, or NULL once it has ended
+    int session_id;  // The session's number, for the trace; read by the worker
+    struct coroutine *coroutine;  // The game's coroutine, suspended until the move is known
+    char board[SIZE][SIZE];  // Copy of the board to search
+    char aiMark;  // The AI's mark
+    char playerMark;  // The player's mark
+    int slot;  // The chosen move (1-9), set by the worker
+    struct game_search *next;  // Link in search_done
+};
+
+/**
+ * @brief Buffered I/O of an in-process game, living on its coroutine's stack.
+ * 
+ * Output is gathered and written in one go when the game is about to wait
+ * for the player, so each turn costs one write however ttt-like the code is.
+ */
+struct game_io {
+    struct session *session;  // The session playing
+    struct coroutine *coroutine;  // The coroutine the game runs on
+    char input[GAME_INPUT_MAX];  // Player bytes not parsed yet
+    size_t input_start;  // First unparsed byte in input
+    size_t input_end;  // End of the buffered bytes
+    char output[GAME_OUTPUT_MAX];  // Output not written yet
+    size_t output_length;  // Bytes in output
+    int failed;  // The peer went away; stop playing
+    uint32_t resume_id;  // Game the player asked to resume, with GAME_MOVE_RESUME
+};
+
+/**
+ * @brief One -i or -b listener of the accept loop.
+ */
+struct session_listener {
+    int fd;  // Listening stream socket, or the bound UDP socket new clients first write to
+    int bidirectional;  // The peer is the command's stdout too (-b), not just its stdin (-i)
+    enum transport transport;  // Transport of accepted peers
+    int port;  // Bound port (UDPS), so per-client sockets can share it
+};
+
+/**
+ * @brief The accept loop used with -c or several listeners: one command per peer, many at once.
+ */
+struct session_server {
+    struct session_listener listeners[SERVER_MAX_LISTENERS];  // Every -i/-b listener
+    int listener_count;  // Listeners in use
+    char **command;  // Command started for each peer, from parse_command()
+    int max_sessions;  // Concurrent sessions before accepting pauses
+    int active;  // Sessions currently running
+    int started;  // Sessions started, used as session ids
+};
+
+struct session_deadlines deadlines = {0, 0, 0};
+struct session current_session;  // The session served without -c
+enum child_io child_io = CHILD_IO_DIRECT;  // Set with -P
+struct buffer_pool relay_pool;  // Ring buffers for every relay
+size_t relay_buffer_size = RING_MIN_SIZE;  // Ring buffer (and splice chunk) size, set with -s
+int stdio_flags[3] = {-1, -1, -1};  // Flags of the standard streams before they were made non-blocking, or -1
+struct coalesce_config coalescing = {0, NULL};  // Set with -C
+enum framing framing = FRAMING_NONE;  // Set with -F
+struct broadcast spectators;  // Watchers connected with -W
+int watching = 0;  // A -W listener is open
+struct session *broadcasting = NULL;  // Session whose output the spectators see
+struct session_server server;  // Set up by serve_sessions()
+struct session *datagram_sessions = NULL;  // Running sessions of UDPS clients, to spot their stray datagrams
+struct shm_channel shm_channels[SHM_MAX_CHANNELS];  // Set up by -i/-b SHMS and -o SHMC
+int shm_channel_count = 0;  // Entries of shm_channels in use
+const char *game_strategy = NULL;  // AI strategy of in-process games (-g), NULL to run -e commands
+struct coroutine_pool coroutines;  // Stacks of in-process games
+struct work_pool workers;  // Threads searching AI moves (-w)
+int worker_count = 0;  // Threads in workers, 0 to search on the event loop thread
+pthread_mutex_t search_lock = PTHREAD_MUTEX_INITIALIZER;  // Protects search_done
+struct game_search *search_done = NULL;  // Searches finished by workers, awaiting the loop
+int search_wake_fd = -1;  // eventfd the workers signal after queueing on search_done
+int budget_enabled = 0;  // Log each session's system call and packet counts when it ends (-B)
+struct game_store saved_games;  // In-process games saved for resuming (-G)
+int saving_games = 0;  // saved_games is open
+struct game_log_writer game_log;  // Every in-process game's moves, appended a block at a time (-R)
+int logging_games = 0;  // game_log is open
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds.
+ * 
+ * @return long long The current time.
+ */
+long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Marks the moment a session's peer was accepted, for the accept-to-first-byte histogram.
+ * 
+ * @param session The session.
+ */
+void record_accept(struct session *session) {
+    session->accept_ns = monotonic_ns();
+    metrics.connections_accepted++;
+}
+
+/**
+ * @brief Records the accept-to-first-byte latency the first time data arrives from a session's peer.
+ * 
+ * @param session The session.
+ */
+void record_first_byte(struct session *session) {
+    if (session->accept_ns != 0) {
+        hist_record(&first_byte_latency, monotonic_ns() - session->accept_ns);
+        session->accept_ns = 0;
     }
+}
 
-    // Initialize an array to hold the command and its arguments
-    char **arguments = NULL;
-    int n = 0;
+/**
+ * @brief Traces the first byte a session's peer sends.
+ * 
+ * @param session The session.
+ */
+void trace_first_byte(struct session *session) {
+    if (trace_enabled && session->first_byte_ns == 0) {
+        session->first_byte_ns = monotonic_ns();
+        trace_instant("first_byte", session->id, session->first_byte_ns, NULL, 0);
+    }
+}
 
-    // Parse the tokenized arguments and store them in the array
-    while (token != NULL) {
-        arguments = realloc(arguments, (n + 1) * sizeof(char *));
-        if (arguments == NULL) {
-            exit(1);
+/**
+ * @brief Prints every latency histogram to stderr.
+ */
+void dump_histograms(void) {
+    struct latency_hist *live[] = {&relay_latency, &first_byte_latency, &spawn_latency, &child_runtime};
+    static struct latency_hist snapshot;  // Static: too large for the stack of a signal-interrupted loop
+    for (int i = 0; i < 4; i++) {
+        hist_snapshot(live[i], &snapshot);
+        hist_print(&snapshot, stderr);
+    }
+    dump_requested = 0;
+}
+
+/**
+ * @brief Writes the game log's last block at exit (-R).
+ */
+void flush_game_log(void) {
+    if (game_log_flush(&game_log) == -1) {
+        log_error("Error writing the game log: %s", strerror(errno));
+    }
+    log_info("Game log: %llu games, %llu bytes written", game_log.games_logged, game_log.bytes_logged);
+}
+
+/**
+ * @brief Signal handler for SIGUSR1: asks the main loop to print the histograms.
+ * 
+ * @param signal The signal number.
+ */
+void handle_dump_signal(int signal) {
+    dump_requested = 1;
+}
+
+/**
+ * @brief Signal handler for SIGINT and SIGTERM: asks the main loop to exit normally.
+ * 
+ * @param signal The signal number.
+ */
+void handle_stop_signal(int signal) {
+    stop_requested = 1;
+}
+
+/**
+ * @brief Parses the -e command once into an argv array.
+ * 
+ * The pointers and the strings share one allocation that is never modified,
+ * so every session spawns from the same array without re-tokenizing.
+ * 
+ * @param command The command and its arguments as a single string.
+ * @return char** The NULL-terminated argument array.
+ */
+char **parse_command(const char *command) {
+    // Count the arguments first so the array is allocated once
+    int n = 0;
+    for (const char *c = command; *c != '\0'; c++) {
+        if (*c != ' ' && (c == command || c[-1] == ' ')) {
+            n++;
         }
-        arguments[n++] = token;
-        token = strtok(NULL, " ");
+    }
+    if (n == 0) {
+        fprintf(stderr, "No arguments provided\n");
+        exit(1);
     }
 
-    // Add a NULL terminator to the arguments array
-    arguments = realloc(arguments, (n + 1) * sizeof(char *));
+    // The pointer array is followed by a copy of the command that is split in place
+    size_t length = strlen(command) + 1;
+    char **arguments = malloc((n + 1) * sizeof(char *) + length);
     if (arguments == NULL) {
         exit(1);
     }
+    char *copy = memcpy((char *)(arguments + n + 1), command, length);
+    n = 0;
+    for (char *token = strtok(copy, " "); token != NULL; token = strtok(NULL, " ")) {
+        arguments[n++] = token;
+    }
     arguments[n] = NULL;
+    return arguments;
+}
 
-    // Fork a new process to execute the command
-    int pid = fork();
-    if (pid < 0) {
-        exit(1);
+/**
+ * @brief Executes a given command with its arguments.
+ * 
+ * The command is started with posix_spawnp(), which glibc implements with
+ * CLONE_VM|CLONE_VFORK, so the cost does not grow with mync's memory like
+ * fork() does. The session's descriptors become the command's standard
+ * input and output through spawn file actions. The caller reaps it from the
+ * event loop (see child_watch) so other descriptors and sessions keep being served.
+ * 
+ * @param arguments The argv array from parse_command().
+ * @param input_fd Becomes the command's standard input.
+ * @param output_fd Becomes the command's standard output.
+ * @param session_id The session the command runs for, for the trace.
+ * @return pid_t The child's process id, or -1 if the command could not be started.
+ */
+pid_t executeCommand(char *const arguments[], int input_fd, int output_fd, int session_id) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, input_fd, STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, output_fd, STDOUT_FILENO);
+    if (input_fd > STDERR_FILENO) {
+        posix_spawn_file_actions_addclose(&actions, input_fd);
+    }
+    if (output_fd > STDERR_FILENO && output_fd != input_fd) {
+        posix_spawn_file_actions_addclose(&actions, output_fd);
     }
 
-    // Child process
-    if (pid == 0) {
-        // Execute the command
-        execvp(arguments[0], arguments);
-        // If execvp fails, print an error message and exit
-        perror("Error executing command");
-        exit(1);
-    } else { // Parent process
-        // Wait for the child process to finish
-        wait(NULL);
-        // Free memory allocated for the arguments array
-        free(arguments);
-        // Flush stdout to ensure all output is printed before returning
-        fflush(stdout);
+    // Undo the SIGCHLD blocking of the signalfd fallback and the SIGPIPE ignoring of -P; both survive exec
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attributes, &signals);
+    sigaddset(&signals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attributes, &signals);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    // posix_spawnp() returns once the child has exec'd, or with the exec error
+    pid_t pid;
+    PROBE1(mync, spawn_start, session_id);
+    long long spawn_start = monotonic_ns();
+    int error = posix_spawnp(&pid, arguments[0], &actions, &attributes, arguments, environ);
+    long long spawn_end = monotonic_ns();
+    PROBE3(mync, spawn_done, session_id, error == 0 ? pid : -1, spawn_end - spawn_start);
+    hist_record(&spawn_latency, spawn_end - spawn_start);
+    trace_span("spawn", session_id, spawn_start, spawn_end, NULL, 0);
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) {
+        fprintf(stderr, "Error executing command: %s\n", strerror(error));
+        return -1;
     }
+    metrics.child_spawns++;
+    trace_instant("exec", session_id, spawn_end, "pid", pid);
+    return pid;
 }
 
+void session_finish(struct session *session);
+void relay_stop(struct relay_direction *direction);
+
 /**
- * @brief Signal handler for the timeout.
+ * @brief Ends a session whose deadline has passed.
  * 
- * @param signal The signal number.
+ * A session still waiting for peers ends the process, as the old alarm() did.
+ * A running command is sent SIGTERM and reaped by the event loop; an
+ * in-process game is abandoned; a relay stops.
+ * 
+ * @param session The session.
+ * @param deadline The deadline that expired, for the log line.
  */
-void handle_timeout(int signal) {
-    // Terminate the process
-    exit(0);
+void session_expire(struct session *session, const char *deadline) {
+    metrics.timeouts_fired++;
+    log_warn("Session %d: %s timeout", session->id, deadline);
+    trace_note("timeout", session->id, monotonic_ns(), deadline);
+    if (session->state == SESSION_CONNECTING) {
+        exit(0);
+    }
+    timer_cancel(&wheel, &session->idle_timer);
+    timer_cancel(&wheel, &session->game_timer);
+    if (session->process.pid > 0) {
+        kill(session->process.pid, SIGTERM);  // Reaped by the event loop, which then ends the session
+    } else if (session->game != NULL) {
+        session_finish(session);  // Abandons the game where it waits
+    } else {
+        metrics.sessions_active--;
+        event_loop_stop(&loop);
+    }
+}
+
+/**
+ * @brief Timer callback for the connect deadline.
+ */
+void handle_connect_timeout(struct timer *timer, void *data) {
+    session_expire(data, "connect");
+}
+
+/**
+ * @brief Timer callback for the total-game deadline.
+ */
+void handle_game_timeout(struct timer *timer, void *data) {
+    session_expire(data, "game");
+}
+
+/**
+ * @brief Timer callback for the idle deadline.
+ * 
+ * Relayed data only records a timestamp, so the timer is pushed back here
+ * instead of being re-armed on every read.
+ */
+void handle_idle_timeout(struct timer *timer, void *data) {
+    struct session *session = data;
+    unsigned long long idle_for = timer_wheel_now_ms(&wheel) - session->last_activity_ms;
+    if (idle_for < (unsigned long long)session->idle_ms) {
+        timer_add(&wheel, timer, session->idle_ms - idle_for);
+        return;
+    }
+    session_expire(session, "idle");
+}
+
+/**
+ * @brief Starts a session: arms the connect deadline.
+ * 
+ * @param session The session.
+ * @param id The session number.
+ */
+void session_start(struct session *session, int id) {
+    session->id = id;
+    session->state = SESSION_CONNECTING;
+    session->process.pid = -1;
+    session->peer_in = session->peer_out = -1;
+    session->child_input = session->child_output = -1;
+    session->owns_peers = 0;
+    session->open_directions = 0;
+    session->child_exited = session->output_done = 0;
+    session->relay[0].ring = session->relay[1].ring = NULL;
+    session->relay[0].flush_timer.pending = session->relay[1].flush_timer.pending = 0;
+    session->relay[0].read_handle = session->relay[1].read_handle = -1;
+    session->relay[0].write_handle = session->relay[1].write_handle = -1;
+    session->game = NULL;
+    session->search = NULL;
+    session->accept_ns = session->first_byte_ns = 0;
+    memset(&session->budget, 0, sizeof(session->budget));
+    session->game_slot = -1;
+    session->idle_ms = deadlines.idle_ms;
+    timer_init(&session->connect_timer, handle_connect_timeout, session);
+    timer_init(&session->idle_timer, handle_idle_timeout, session);
+    timer_init(&session->game_timer, handle_game_timeout, session);
+    if (deadlines.connect_ms > 0) {
+        timer_add(&wheel, &session->connect_timer, deadlines.connect_ms);
+    }
+}
+
+/**
+ * @brief Marks a session's peers as connected: swaps the connect deadline for the game and idle ones.
+ * 
+ * @param session The session.
+ */
+void session_activate(struct session *session) {
+    session->state = SESSION_ACTIVE;
+    session->last_activity_ms = timer_wheel_now_ms(&wheel);
+    timer_cancel(&wheel, &session->connect_timer);
+    if (deadlines.game_ms > 0) {
+        timer_add(&wheel, &session->game_timer, deadlines.game_ms);
+    }
+    if (session->idle_ms > 0) {
+        timer_add(&wheel, &session->idle_timer, session->idle_ms);
+    }
+    metrics.sessions_active++;
+}
+
+/**
+ * @brief Logs what a session cost (-B): system calls, what was sent to the peer, and per turn.
+ * 
+ * Each read of the command's output holds one or more of its write()s, so
+ * the command's count is a lower bound, exact when mync keeps up with it.
+ * 
+ * @param session The session.
+ */
+void log_budget(struct session *session) {
+    struct session_budget *budget = &session->budget;
+    unsigned long turns = budget->turns > 0 ? budget->turns : 1;
+    log_info("Session %d: budget: %lu turns, %lu syscalls, %lu bytes in %lu packets, %lu command writes, "
+             "%.2f syscalls/turn, %.2f packets/turn",
+             session->id, budget->turns, budget->syscalls, budget->bytes_sent, budget->packets_sent,
+             budget->child_writes, (double)budget->syscalls / turns, (double)budget->packets_sent / turns);
+}
+
+/**
+ * @brief Counts data a direction sent on (-B): packets and bytes only when it went to the peer.
+ * 
+ * @param direction The direction.
+ * @param syscalls System calls the sending took.
+ * @param packets Writes or datagrams it made.
+ * @param bytes Bytes sent.
+ */
+void budget_sent(struct relay_direction *direction, unsigned long syscalls, unsigned long packets, size_t bytes) {
+    struct session_budget *budget = &direction->session->budget;
+    budget->syscalls += syscalls;
+    if (direction->to != direction->session->child_input) {
+        budget->packets_sent += packets;
+        budget->bytes_sent += bytes;
+    }
+}
+
+/**
+ * @brief Ends a session once its command is gone.
+ * 
+ * Without -c that stops the event loop; with -c the session is freed and
+ * accepting resumes if it had paused at the limit.
+ * 
+ * @param session The session.
+ */
+void session_finish(struct session *session) {
+    trace_instant("session_end", session->id, monotonic_ns(), NULL, 0);
+    if (budget_enabled) {
+        log_budget(session);
+    }
+    timer_cancel(&wheel, &session->idle_timer);
+    timer_cancel(&wheel, &session->game_timer);
+    metrics.sessions_active--;
+    if (broadcasting == session) {
+        broadcasting = NULL;  // The next session started takes over the spectators
+    }
+
+    if (session->search != NULL) {
+        session->search->session = NULL;  // Freed by handle_search_done when the worker finishes
+        session->search = NULL;
+    }
+    if (session->game != NULL) {
+        coroutine_release(session->game);
+        session->game = NULL;
+    }
+    if (session->game_slot != -1) {
+        game_store_disown(&saved_games, session->game_slot);  // Unfinished: the player may resume it
+        session->game_slot = -1;
+    }
+
+    // Tear down the -P relay: its rings, the command's pipes and, with -c, the peer
+    for (int i = 0; i < 2; i++) {
+        relay_stop(&session->relay[i]);
+        timer_cancel(&wheel, &session->relay[i].flush_timer);
+        if (session->relay[i].ring != NULL) {
+            metrics.write_queue_bytes -= ring_buffer_used(session->relay[i].ring);  // Dropped with the session
+            buffer_pool_release(&relay_pool, session->relay[i].ring);
+            session->relay[i].ring = NULL;
+        }
+    }
+    int *descriptors[] = {&session->child_input, &session->child_output};
+    for (int i = 0; i < 2; i++) {
+        if (*descriptors[i] != -1) {
+            close(*descriptors[i]);
+            *descriptors[i] = -1;
+        }
+    }
+    if (session->owns_peers) {
+        close(session->peer_in);
+        if (session->peer_out != session->peer_in) {
+            close(session->peer_out);
+        }
+    }
+    if (session == &current_session) {
+        event_loop_stop(&loop);
+        return;
+    }
+    for (struct session **link = &datagram_sessions; *link != NULL; link = &(*link)->next_datagram) {
+        if (*link == session) {
+            *link = session->next_datagram;
+            break;
+        }
+    }
+    free(session);
+    if (server.active-- == server.max_sessions) {
+        // Below the limit again
+        for (int i = 0; i < server.listener_count; i++) {
+            event_loop_modify(&loop, server.listeners[i].fd, POLLIN);
+        }
+    }
+}
+
+/**
+ * @brief Records a reaped command: exit status, runtime and resource usage.
+ * 
+ * @param child The reaped command.
+ * @param data The session.
+ */
+void handle_session_exit(struct child_process *child, void *data) {
+    struct session *session = data;
+    metrics.child_exits++;
+    if (!WIFEXITED(child->status) || WEXITSTATUS(child->status) != 0) {
+        metrics.child_failures++;
+    }
+    hist_record(&child_runtime, child->runtime_ns);
+    long long now = monotonic_ns();
+    trace_span("command", session->id, now - child->runtime_ns, now, "pid", child->pid);
+    trace_instant("child_exit", session->id, now, "status", child->status);
+    PROBE3(mync, child_exit, session->id, child->pid, child->status);
+    log_info("Session %d: command %d %s %d after %.3f s (user %.3f s, system %.3f s, max RSS %ld KB)",
+             session->id, child->pid, WIFSIGNALED(child->status) ? "killed by signal" : "exited with status",
+             WIFSIGNALED(child->status) ? WTERMSIG(child->status) : WEXITSTATUS(child->status),
+             child->runtime_ns / 1e9,
+             child->usage.ru_utime.tv_sec + child->usage.ru_utime.tv_usec / 1e6,
+             child->usage.ru_stime.tv_sec + child->usage.ru_stime.tv_usec / 1e6, child->usage.ru_maxrss);
+
+    // With -P, the command's last output may still be in its pipe; the relay finishes the session at EOF
+    session->child_exited = 1;
+    if (session->child_output != -1 && !session->output_done) {
+        return;
+    }
+    session_finish(session);
+}
+
+/**
+ * @brief Abandons a -P session whose peer failed: drops its relay and terminates the command.
+ * 
+ * @param session The session.
+ */
+void session_abort(struct session *session) {
+    relay_stop(&session->relay[0]);
+    relay_stop(&session->relay[1]);
+    session->output_done = 1;
+    if (session->child_exited) {
+        session_finish(session);
+    } else {
+        kill(session->process.pid, SIGTERM);  // Reaped by the event loop, which then ends the session
+    }
+}
+
+/**
+ * @brief Runs one round of the event loop and prints the histograms if SIGUSR1 arrived.
+ */
+void run_loop_once(void) {
+    int poll_result = event_loop_run_once(&loop, -1);
+    // SIGUSR1 either interrupted poll or arrived while handling events: print the histograms
+    if (dump_requested) {
+        dump_histograms();
+    }
+    if (stop_requested) {
+        exit(0);  // atexit() flushes the log and writes the trace; the profile (gcov, -fprofile-generate) is written too
+    }
+    if (poll_result == -1 && errno != EINTR) {
+        fprintf(stderr, "Error polling: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Callback that flags a descriptor awaited by await_readable().
+ */
+void mark_readable(struct event_loop *loop, int fd, short revents, void *data) {
+    *(int *)data = 1;
+}
+
+/**
+ * @brief Runs the event loop until a descriptor is readable.
+ * 
+ * Used before the blocking accept()/recvfrom() calls of the setup functions,
+ * so deadlines and the stats listener keep being served while waiting for peers.
+ * 
+ * @param fd The descriptor to wait for.
+ */
+void await_readable(int fd) {
+    int ready = 0;
+    if (event_loop_add(&loop, fd, POLLIN, mark_readable, &ready) == -1) {
+        perror("Error registering descriptor");
+        exit(EXIT_FAILURE);
+    }
+    while (!ready) {
+        run_loop_once();
+    }
+    event_loop_remove(&loop, fd);
+}
+
+/**
+ * @brief Parses a -T deadline list such as "connect=5,idle=30,game=600" (seconds).
+ * 
+ * @param text The deadline list; modified by the parser.
+ */
+void parse_deadlines(char *text) {
+    char *item;
+    while ((item = strsep(&text, ",")) != NULL) {
+        char *value = strchr(item, '=');
+        if (value == NULL) {
+            fprintf(stderr, "Invalid deadline: %s\n", item);
+            exit(EXIT_FAILURE);
+        }
+        *value++ = '\0';
+        long long ms = (long long)(strtod(value, NULL) * 1000);
+        if (strcmp(item, "connect") == 0) {
+            deadlines.connect_ms = ms;
+        } else if (strcmp(item, "idle") == 0) {
+            deadlines.idle_ms = ms;
+        } else if (strcmp(item, "game") == 0) {
+            deadlines.game_ms = ms;
+        } else {
+            fprintf(stderr, "Unknown deadline: %s\n", item);
+            exit(EXIT_FAILURE);
+        }
+    }
 }
 
 /**
@@ -101,20 +805,22 @@ void close_descriptors(int *descriptors) {
 }
 
 /**
- * @brief Sets up a TCP server.
+ * @brief Creates a listening TCP socket.
+ * 
+ * The socket is close-on-exec so commands started with -e do not inherit it.
  * 
- * @param descriptors An array to store the file descriptors.
  * @param port The port number to bind to.
- * @param b_flag Optional flag for bidirectional communication.
+ * @param backlog The listen() backlog.
+ * @return int The listening socket.
  */
-void setup_TCPServer(int *descriptors, int port, char *b_flag) {
+int listen_TCPServer(int port, int backlog) {
     // Create a TCP socket
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if (sockfd < 0) {
         perror("Error creating TCP socket");
         exit(EXIT_FAILURE);
     }
-    printf("TCP socket has been created!\n");
+    log_info("TCP socket has been created!");
 
     // Allow the socket to be reused
     int optval = 1;
@@ -136,12 +842,25 @@ void setup_TCPServer(int *descriptors, int port, char *b_flag) {
     }
 
     // Listen for connections
-    if (listen(sockfd, 1) < 0) {
+    if (listen(sockfd, backlog) < 0) {
         perror("Error listening for connections");
         exit(EXIT_FAILURE);
     }
+    return sockfd;
+}
+
+/**
+ * @brief Sets up a TCP server.
+ * 
+ * @param descriptors An array to store the file descriptors.
+ * @param port The port number to bind to.
+ * @param b_flag Optional flag for bidirectional communication.
+ */
+void setup_TCPServer(int *descriptors, int port, char *b_flag) {
+    int sockfd = listen_TCPServer(port, 1);
 
     // Accept a client connection
+    await_readable(sockfd);
     struct sockaddr_in client_addr;
     socklen_t client_len = sizeof(client_addr);
     int client_fd = accept(sockfd, (struct sockaddr *)&client_addr, &client_len);
@@ -149,6 +868,8 @@ void setup_TCPServer(int *descriptors, int port, char *b_flag) {
         perror("Error accepting client connection");
         exit(EXIT_FAILURE);
     }
+    PROBE1(mync, accept, client_fd);
+    record_accept(&current_session);
 
     // Set the client file descriptor in the descriptors array
     descriptors[0] = client_fd;
@@ -174,9 +895,8 @@ void setup_TCPClient(int *descriptors, char *ip, int port) {
         exit(1);
     }
 
-    // Print message indicating TCP client setup
-    printf("Setting up TCP client to connect to %s:%d\n", ip, port);
-    fflush(stdout);
+    // Log the TCP client setup
+    log_info("Setting up TCP client to connect to %s:%d", ip, port);
 
     // Set up server address structure
     struct sockaddr_in server_addr;
@@ -213,33 +933,31 @@ void setup_TCPClient(int *descriptors, char *ip, int port) {
     // Store the client socket descriptor in the descriptors array
     descriptors[1] = sock;
 
-    // Print successful connection message
-    printf("Successfully connected to %s:%d\n", ip, port);
-    fflush(stdout);
+    // Log the successful connection
+    log_info("Successfully connected to %s:%d", ip, port);
 }
 
 /**
- * @brief Sets up a UDP server.
+ * @brief Creates a UDP socket bound to the given port on every address.
+ * 
+ * Address reuse is enabled so per-client sockets of the accept loop can bind the same port.
  * 
- * @param descriptors An array to store the file descriptors.
  * @param port The port number to bind to.
- * @param timeout The timeout value in seconds.
+ * @return int The bound socket.
  */
-void setup_UDPServer(int *descriptors, int port, int timeout) {
+int listen_UDPServer(int port) {
     // Create a UDP socket
-    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    int sockfd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
     if (sockfd == -1) {
         perror("UDP socket creation error");
-        close_descriptors(descriptors);
         exit(1);
     }
-    printf("UDP Socket created\n");
+    log_info("UDP Socket created");
 
     // Enable address reuse for the socket
     int enable = 1;
     if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) < 0) {
         perror("UDP setsockopt error");
-        close_descriptors(descriptors);
         exit(1);
     }
 
@@ -252,20 +970,36 @@ void setup_UDPServer(int *descriptors, int port, int timeout) {
     // Bind socket to server address
     if (bind(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
         perror("UDP bind error");
-        close_descriptors(descriptors);
         exit(1);
     }
+    return sockfd;
+}
+
+/**
+ * @brief Sets up a UDP server.
+ * 
+ * @param descriptors An array to store the file descriptors.
+ * @param port The port number to bind to.
+ */
+void setup_UDPServer(int *descriptors, int port) {
+    int sockfd = listen_UDPServer(port);
+    struct sockaddr_in server_addr;
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
 
     // Receive data from client
     char buffer[1024];
     struct sockaddr_in client_addr;
     socklen_t client_addr_len = sizeof(client_addr);
+    await_readable(sockfd);
     int numbytes = recvfrom(sockfd, buffer, sizeof(buffer), 0, (struct sockaddr *)&client_addr, &client_addr_len);
     if (numbytes == -1) {
         perror("UDP receive data error");
         close_descriptors(descriptors);
         exit(1);
     }
+    record_accept(&current_session);
 
     // Connect to client
     if (connect(sockfd, (struct sockaddr *)&client_addr, sizeof(client_addr)) == -1) {
@@ -282,9 +1016,6 @@ void setup_UDPServer(int *descriptors, int port, int timeout) {
 
     // Store the server socket descriptor in the descriptors array
     descriptors[0] = sockfd;
-    
-    // Set timeout using alarm signal
-    alarm(timeout);
 }
 
 /**
@@ -301,8 +1032,7 @@ void setup_UDPClient(int *descriptors, char *ip, int port) {
         perror("UDP socket creation error");
         exit(1);
     }
-    printf("UDP client\n");
-    fflush(stdout);
+    log_info("UDP client");
 
     // Set up server address
     struct sockaddr_in server_addr;
@@ -326,14 +1056,77 @@ void setup_UDPClient(int *descriptors, char *ip, int port) {
 }
 
 /**
- * @brief Sets up a Unix domain socket datagram server.
+ * @brief Sets up a UDP multicast publisher.
+ * 
+ * The socket is connected to the group, so the relay writes to it exactly
+ * as it writes to a UDP client; every subscriber that joined the group
+ * receives each datagram.
  * 
  * @param descriptors An array to store the file descriptors.
- * @param path The path to bind the socket to.
+ * @param group The multicast group address.
+ * @param port The port number subscribers bind.
+ * @param ttl Hops the datagrams may cross (0 keeps them on this host, 1 on the local network).
+ * @param loopback Whether subscribers on this host receive the datagrams.
+ * @param interface Address of the interface to send from, or NULL for the routing default.
  */
-void setup_UDSSDServer(int *descriptors, const char *path) {
-    // Create a Unix domain datagram socket
-    int sockfd = socket(AF_UNIX, SOCK_DGRAM, 0);
+void setup_UDPMulticast(int *descriptors, char *group, int port, int ttl, int loopback, char *interface) {
+    // Create a UDP socket
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd == -1) {
+        perror("UDP socket creation error");
+        exit(1);
+    }
+    log_info("UDP multicast");
+
+    // Set up group address
+    struct sockaddr_in group_addr;
+    memset(&group_addr, 0, sizeof(group_addr));
+    group_addr.sin_family = AF_INET;
+    group_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, group, &group_addr.sin_addr) <= 0 || !IN_MULTICAST(ntohl(group_addr.sin_addr.s_addr))) {
+        fprintf(stderr, "Invalid multicast group: %s\n", group);
+        exit(1);
+    }
+
+    // Scope, loopback and outgoing interface
+    unsigned char hops = ttl;
+    unsigned char loop_flag = loopback != 0;
+    if (setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops)) == -1 ||
+        setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop_flag, sizeof(loop_flag)) == -1) {
+        perror("UDP multicast setsockopt error");
+        exit(1);
+    }
+    if (interface != NULL) {
+        struct in_addr interface_addr;
+        if (inet_pton(AF_INET, interface, &interface_addr) <= 0) {
+            fprintf(stderr, "Invalid multicast interface: %s\n", interface);
+            exit(1);
+        }
+        if (setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_IF, &interface_addr, sizeof(interface_addr)) == -1) {
+            perror("UDP multicast interface error");
+            exit(1);
+        }
+    }
+
+    // Connect to the group so writes need no address
+    if (connect(sockfd, (struct sockaddr *)&group_addr, sizeof(group_addr)) == -1) {
+        perror("UDP connect to group error");
+        exit(1);
+    }
+
+    // Store the publisher socket descriptor in the descriptors array
+    descriptors[1] = sockfd;
+}
+
+/**
+ * @brief Sets up a Unix domain socket datagram server.
+ * 
+ * @param descriptors An array to store the file descriptors.
+ * @param path The path to bind the socket to.
+ */
+void setup_UDSSDServer(int *descriptors, const char *path) {
+    // Create a Unix domain datagram socket
+    int sockfd = socket(AF_UNIX, SOCK_DGRAM, 0);
     if (sockfd == -1) {
         perror("Error creating Unix domain socket (datagram)");
         exit(1);
@@ -355,10 +1148,43 @@ void setup_UDSSDServer(int *descriptors, const char *path) {
         exit(1);
     }
 
-    printf("Unix domain datagram server started on %s\n", path);
+    log_info("Unix domain datagram server started on %s", path);
     descriptors[0] = sockfd;
 }
 
+/**
+ * @brief Connects a Unix domain datagram server socket to its first sender.
+ * 
+ * Waits for one datagram and connects the socket to the sender's bound path,
+ * so the server can reply on the same socket (used by the -b option).
+ * 
+ * @param sockfd The bound datagram server socket.
+ */
+void connect_UDSSDPeer(int sockfd) {
+    // Receive the first datagram to learn the client's address
+    char buffer[1024];
+    struct sockaddr_un client_addr;
+    socklen_t client_addr_len = sizeof(client_addr);
+    await_readable(sockfd);
+    if (recvfrom(sockfd, buffer, sizeof(buffer), 0, (struct sockaddr *)&client_addr, &client_addr_len) == -1) {
+        perror("Error receiving from Unix domain socket (datagram)");
+        exit(1);
+    }
+    record_accept(&current_session);
+
+    // Replies can only reach a client that bound its socket to a path
+    if (client_addr_len <= sizeof(sa_family_t)) {
+        fprintf(stderr, "Unix domain datagram client is not bound to a path\n");
+        exit(1);
+    }
+
+    // Connect to the client
+    if (connect(sockfd, (struct sockaddr *)&client_addr, client_addr_len) == -1) {
+        perror("Error connecting to Unix domain datagram client");
+        exit(1);
+    }
+}
+
 /**
  * @brief Sets up a Unix domain socket datagram client.
  * 
@@ -379,7 +1205,7 @@ void setup_UDSCDClient(int *descriptors, const char *path) {
     server_addr.sun_family = AF_UNIX;
     strncpy(server_addr.sun_path, path, sizeof(server_addr.sun_path) - 1);
 
-    printf("Connecting to Unix domain datagram server at %s\n", path);
+    log_info("Connecting to Unix domain datagram server at %s", path);
 
     // Connect to the server
     if (connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
@@ -388,149 +1214,1786 @@ void setup_UDSCDClient(int *descriptors, const char *path) {
         exit(1);
     }
 
-    printf("Connected to Unix domain datagram server at %s\n", path);
+    log_info("Connected to Unix domain datagram server at %s", path);
+    descriptors[1] = sockfd;
+}
+
+/**
+ * @brief Creates a listening Unix domain stream socket.
+ * 
+ * The socket is close-on-exec so commands started with -e do not inherit it.
+ * 
+ * @param path The path to bind the socket to.
+ * @param backlog The listen() backlog.
+ * @return int The listening socket.
+ */
+int listen_UDSSSServer(const char *path, int backlog) {
+    // Create a Unix domain stream socket
+    int sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sockfd == -1) {
+        perror("Error creating Unix domain socket (stream)");
+        exit(1);
+    }
+
+    // Set up server address
+    struct sockaddr_un server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sun_family = AF_UNIX;
+    strncpy(server_addr.sun_path, path, sizeof(server_addr.sun_path) - 1);
+
+    // Remove the socket file if it already exists
+    unlink(path);
+
+    // Bind socket to server address
+    if (bind(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
+        perror("Error binding Unix domain socket (stream)");
+        close(sockfd);
+        exit(1);
+    }
+
+    // Listen for connections
+    if (listen(sockfd, backlog) == -1) {
+        perror("Error listening on Unix domain socket (stream)");
+        close(sockfd);
+        exit(1);
+    }
+
+    log_info("Unix domain stream server started on %s", path);
+    return sockfd;
+}
+
+/**
+ * @brief Sets up a Unix domain socket stream server.
+ * 
+ * @param descriptors An array to store the file descriptors.
+ * @param path The path to bind the socket to.
+ */
+void setup_UDSSSServer(int *descriptors, const char *path) {
+    int sockfd = listen_UDSSSServer(path, 1);
+
+    // Accept a client connection
+    await_readable(sockfd);
+    int client_fd = accept(sockfd, NULL, NULL);
+    if (client_fd == -1) {
+        perror("Error accepting connection on Unix domain socket (stream)");
+        close(sockfd);
+        exit(1);
+    }
+    PROBE1(mync, accept, client_fd);
+    record_accept(&current_session);
+
+    // Store the client socket descriptor in the descriptors array
+    descriptors[0] = client_fd;
+}
+
+/**
+ * @brief Sets up a Unix domain socket stream client.
+ * 
+ * @param descriptors An array to store the file descriptors.
+ * @param path The path to connect the socket to.
+ */
+void setup_UDSCSClient(int *descriptors, const char *path) {
+    // Create a Unix domain stream socket
+    int sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sockfd == -1) {
+        perror("Error creating Unix domain socket (stream)");
+        exit(1);
+    }
+
+    // Set up server address
+    struct sockaddr_un server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sun_family = AF_UNIX;
+    strncpy(server_addr.sun_path, path, sizeof(server_addr.sun_path) - 1);
+
+    log_info("Connecting to Unix domain stream server at %s", path);
+
+    // Connect to the server
+    if (connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
+        perror("Error connecting to Unix domain socket (stream)");
+        close(sockfd);
+        exit(1);
+    }
+
+    log_info("Connected to Unix domain stream server at %s", path);
     descriptors[1] = sockfd;
 }
 
 /**
- * @brief Sets up a Unix domain socket stream server.
+ * @brief Looks up the shared-memory channel a descriptor stands for.
+ * 
+ * @param fd A descriptor from the descriptors array.
+ * @return struct shm_channel* The channel whose wake_fd is fd, or NULL.
+ */
+struct shm_channel *shm_channel_of(int fd) {
+    for (int i = 0; i < shm_channel_count; i++) {
+        if (shm_channels[i].wake_fd == fd) {
+            return &shm_channels[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Event callback: a channel's control connection hung up, so its peer is gone.
+ * 
+ * The channel's wake_fd is signalled, so the relay reading it drains what is
+ * left in the ring and then sees EOF.
+ */
+void handle_shm_hangup(struct event_loop *loop, int fd, short revents, void *data) {
+    shm_peer_hangup(data);
+    event_loop_remove(loop, fd);
+}
+
+/**
+ * @brief Registers a new shared-memory channel; its wake_fd stands for it in the descriptors array.
+ * 
+ * @return struct shm_channel* The channel to set up.
+ */
+struct shm_channel *shm_channel_new(void) {
+    if (shm_channel_count == SHM_MAX_CHANNELS) {
+        fprintf(stderr, "At most %d shared-memory channels are supported\n", SHM_MAX_CHANNELS);
+        exit(1);
+    }
+    return &shm_channels[shm_channel_count++];
+}
+
+/**
+ * @brief Watches a set-up channel's control connection for the peer going away.
+ */
+void shm_channel_watch(struct shm_channel *channel) {
+    if (event_loop_add(&loop, channel->control_fd, POLLIN, handle_shm_hangup, channel) == -1) {
+        perror("Error registering shared-memory channel");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Sets up a shared-memory server: waits for a client on a Unix socket and hands it the rings.
+ * 
+ * The rings live in a sealed memfd passed to the client over the socket,
+ * so once set up, data moves without system calls while both sides are
+ * busy; eventfds wake a side that went to sleep.
+ * 
+ * @param descriptors An array to store the file descriptors.
+ * @param path The path to bind the socket to.
+ */
+void setup_SHMServer(int *descriptors, const char *path) {
+    struct shm_channel *channel = shm_channel_new();
+    int listen_fd = shm_listen(path);
+    if (listen_fd == -1) {
+        perror("Error listening for shared-memory clients");
+        exit(1);
+    }
+    log_info("Shared-memory server started on %s", path);
+    await_readable(listen_fd);
+    if (shm_accept(listen_fd, channel, SHM_RING_SIZE) == -1) {
+        perror("Error setting up shared-memory channel");
+        exit(1);
+    }
+    close(listen_fd);  // One client per channel
+    unlink(path);
+    record_accept(&current_session);
+    shm_channel_watch(channel);
+    descriptors[0] = channel->wake_fd;
+}
+
+/**
+ * @brief Sets up a shared-memory client: connects to a server's socket and maps the rings it passes.
+ * 
+ * @param descriptors An array to store the file descriptors.
+ * @param path The server's socket path.
+ */
+void setup_SHMClient(int *descriptors, const char *path) {
+    struct shm_channel *channel = shm_channel_new();
+    log_info("Connecting to shared-memory server at %s", path);
+    if (shm_connect(path, channel) == -1) {
+        perror("Error connecting to shared-memory server");
+        exit(1);
+    }
+    log_info("Connected to shared-memory server at %s", path);
+    shm_channel_watch(channel);
+    descriptors[1] = channel->wake_fd;
+}
+
+/**
+ * @brief Puts back the standard streams' flags, which mync shares with the shell that started it.
+ */
+void restore_stdio_flags(void) {
+    for (int fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++) {
+        if (stdio_flags[fd] != -1) {
+            fcntl(fd, F_SETFL, stdio_flags[fd]);
+        }
+    }
+}
+
+/**
+ * @brief Makes a peer descriptor non-blocking, so a peer that stops reading cannot stall the event loop.
+ * 
+ * @param fd The descriptor; a standard stream's flags are put back at exit.
+ */
+void set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || (flags & O_NONBLOCK)) {
+        return;
+    }
+    if (fd <= STDERR_FILENO && stdio_flags[fd] == -1) {
+        stdio_flags[fd] = flags;
+    }
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+void relay_event(struct event_loop *loop, int fd, short revents, void *data);
+void relay_writable(struct event_loop *loop, int fd, short revents, void *data);
+int relay_send_complete(struct relay_direction *direction);
+
+/**
+ * @brief Starts relaying a direction: makes its descriptors non-blocking and reads from it.
+ * 
+ * @param direction The direction.
+ */
+void relay_start(struct relay_direction *direction) {
+    set_nonblocking(direction->from);
+    set_nonblocking(direction->to);
+    direction->write_handle = -1;
+    direction->eof = direction->flush_requested = 0;
+    direction->read_handle = event_loop_add(&loop, direction->from, POLLIN, relay_event, direction);
+}
+
+/**
+ * @brief Stops relaying a direction: drops its registrations with the event loop.
+ * 
+ * @param direction The direction.
+ */
+void relay_stop(struct relay_direction *direction) {
+    if (direction->read_handle != -1) {
+        event_loop_remove_handle(&loop, direction->read_handle);
+        direction->read_handle = -1;
+    }
+    if (direction->write_handle != -1) {
+        event_loop_remove_handle(&loop, direction->write_handle);
+        direction->write_handle = -1;
+    }
+}
+
+/**
+ * @brief Starts or stops polling a direction's input; a shared-memory peer only signals while it is polled.
+ * 
+ * @param direction The direction; it must be registered.
+ * @param watching Whether to poll it.
+ */
+void relay_watch_input(struct relay_direction *direction, int watching) {
+    event_loop_modify_handle(&loop, direction->read_handle, watching ? POLLIN : 0);
+    if (direction->from_shm != NULL) {
+        shm_read_event_watch(direction->from_shm, watching);
+    }
+}
+
+/**
+ * @brief Waits for a direction's output to take more: reading pauses until what is queued has been written.
+ * 
+ * A shared-memory channel has no POLLOUT; the peer signals its wake_fd
+ * when it frees space, once asked to with the writer_sleeping flag.
+ * 
+ * @param direction The direction.
+ */
+void relay_wait_writable(struct relay_direction *direction) {
+    if (direction->write_handle != -1) {
+        return;  // Already waiting
+    }
+    short events = direction->to_shm != NULL ? POLLIN : POLLOUT;
+    direction->write_handle = event_loop_add(&loop, direction->to, events, relay_writable, direction);
+    if (direction->to_shm != NULL) {
+        shm_write_event_arm(direction->to_shm);
+    }
+    if (direction->read_handle != -1) {
+        relay_watch_input(direction, 0);
+    }
+}
+
+/**
+ * @brief Handles a relay error: a -P session is abandoned, any other relay ends mync.
+ * 
+ * @param direction The failing direction.
+ * @param what Description of the failed operation, for the log line.
+ * @param name The descriptor involved, for the log line.
+ */
+void relay_fail(struct relay_direction *direction, const char *what, const char *name) {
+    struct session *session = direction->session;
+    if (session->process.pid > 0) {
+        log_warn("Session %d: error %s %s: %s", session->id, what, name, strerror(errno));
+        session_abort(session);
+        return;
+    }
+    fprintf(stderr, "Error %s %s: %s\n", what, name, strerror(errno));
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Points iov at the ring bytes [start, end), which may wrap around.
+ * 
+ * @return int The number of iovecs used (1 or 2).
+ */
+int ring_span(struct ring_buffer *ring, size_t start, size_t end, struct iovec *iov) {
+    size_t offset = start & (ring->capacity - 1);
+    size_t length = end - start;
+    size_t first = ring->capacity - offset < length ? ring->capacity - offset : length;
+    iov[0].iov_base = ring->data + offset;
+    iov[0].iov_len = first;
+    if (first == length) {
+        return 1;
+    }
+    iov[1].iov_base = ring->data;
+    iov[1].iov_len = length - first;
+    return 2;
+}
+
+/**
+ * @brief Sends every complete message of a framing direction, one datagram each, with sendmmsg().
+ * 
+ * Messages the socket cannot take yet stay queued until it is writable.
+ * 
+ * @param direction The direction.
+ * @return int 0 on success, -1 if sending failed (the direction has already been failed).
+ */
+int relay_send_frames(struct relay_direction *direction) {
+    struct ring_buffer *ring = direction->ring;
+    struct mmsghdr messages[FRAME_BATCH];
+    struct iovec iovecs[FRAME_BATCH][2];
+    size_t start = ring->head;
+    for (int i = 0; i < direction->frame_count; i++) {
+        memset(&messages[i], 0, sizeof(messages[i]));
+        messages[i].msg_hdr.msg_iov = iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = ring_span(ring, start, direction->frame_ends[i], iovecs[i]);
+        start = direction->frame_ends[i];
+    }
+
+    // sendmmsg() may stop early; resend the rest
+    int sent = 0;
+    while (sent < direction->frame_count) {
+        direction->session->budget.syscalls++;
+        int result = sendmmsg(direction->to, messages + sent, direction->frame_count - sent, 0);
+        if (result == -1 && errno == EINTR) {
+            continue;
+        }
+        if (result == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;  // The socket is full; the rest go once it is writable
+        }
+        if (result == -1) {
+            metrics.write_queue_bytes -= ring_buffer_used(ring);
+            ring->head = ring->tail = 0;  // Drop what could not be written
+            direction->frame_count = 0;
+            direction->frame_scanned = 0;
+            relay_fail(direction, "writing to", direction->to_name);
+            return -1;
+        }
+        sent += result;
+    }
+    if (sent > 0) {
+        size_t bytes = direction->frame_ends[sent - 1] - ring->head;
+        budget_sent(direction, 0, sent, bytes);
+        if (direction->broadcast) {
+            struct iovec span[2];
+            broadcast_publish(&spectators, span, ring_span(ring, ring->head, ring->head + bytes, span));
+        }
+        ring->head += bytes;
+        direction->frame_count -= sent;
+        memmove(direction->frame_ends, direction->frame_ends + sent, direction->frame_count * sizeof(size_t));
+        metrics.write_queue_bytes -= bytes;
+        metrics.bytes_out[direction->to_transport] += bytes;
+    }
+    if (direction->frame_count > 0) {
+        relay_wait_writable(direction);
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes out everything a coalescing direction is holding, and uncorks a corked socket.
+ * 
+ * What the descriptor cannot take stays in the ring, and the direction waits
+ * for it to be writable before reading again, so write_queue_bytes is what
+ * the peers have yet to take.
+ * 
+ * @param direction The direction.
+ * @return int 0 on success, -1 if the write failed (the direction has already been failed).
+ */
+int relay_flush(struct relay_direction *direction) {
+    timer_cancel(&wheel, &direction->flush_timer);
+    if (direction->corked) {
+        setsockopt(direction->to, IPPROTO_TCP, TCP_CORK, &(int){0}, sizeof(int));  // Pushes the partial segment
+        direction->corked = 0;
+        direction->session->budget.syscalls++;
+    }
+    if (direction->framing != FRAMING_NONE && direction->ring != NULL) {
+        // Complete messages go first, one datagram each
+        if (relay_send_complete(direction) == -1) {
+            return -1;
+        }
+        if (direction->frame_count > 0) {
+            direction->flush_requested = 1;  // The rest goes after them
+            return 0;
+        }
+    }
+    if (direction->ring == NULL || ring_buffer_used(direction->ring) == 0) {
+        return 0;
+    }
+    // What is left is an incomplete message (or unframed data); a datagram socket sends it as one datagram
+    struct ring_buffer *ring = direction->ring;
+    size_t queued = ring_buffer_used(ring);
+    size_t start = ring->head;  // Draining leaves the bytes in place, so spectators get them after the peer
+    size_t written = queued;
+    int result = 0;
+    if (direction->to_shm != NULL) {
+        struct iovec span[2];
+        int pieces = ring_span(ring, ring->head, ring->tail, span);
+        for (int i = 0; i < pieces; i++) {
+            ssize_t n = shm_write(direction->to_shm, span[i].iov_base, span[i].iov_len);
+            if (n == -1) {
+                result = errno == EAGAIN ? 0 : -1;  // A full channel keeps the rest in the ring
+                break;
+            }
+            ring->head += n;
+            if ((size_t)n < span[i].iov_len) {
+                break;
+            }
+        }
+        written = queued - ring_buffer_used(ring);
+        if (ring_buffer_used(ring) == 0) {
+            ring->head = ring->tail = 0;
+        }
+        if (result != -1 && written > 0) {
+            budget_sent(direction, 0, 1, written);  // Shared memory: a send, but no system call
+        }
+    } else {
+        result = ring_buffer_drain(ring, direction->to);
+        written = queued - ring_buffer_used(ring);
+        if (result != -1) {
+            budget_sent(direction, result + (written < queued), result, written);  // A full descriptor costs a call too
+        }
+    }
+    if (result == -1) {
+        metrics.write_queue_bytes -= queued;
+        ring->head = ring->tail = 0;  // Drop what could not be written
+        direction->frame_scanned = 0;
+        relay_fail(direction, "writing to", direction->to_name);
+        return -1;
+    }
+    metrics.write_queue_bytes -= written;
+    metrics.bytes_out[direction->to_transport] += written;
+    PROBE3(mync, relay_write, direction->session->id, direction->to, written);
+    if (direction->broadcast && written > 0) {
+        struct iovec span[2];
+        broadcast_publish(&spectators, span, ring_span(ring, start, start + written, span));
+    }
+    if (ring_buffer_used(ring) > 0) {
+        relay_wait_writable(direction);
+    } else {
+        direction->frame_scanned = ring->tail;  // Drained: the ring restarted at offset 0
+    }
+    return 0;
+}
+
+/**
+ * @brief Timer callback: the flush window of a held burst has ended.
+ */
+void handle_flush_timeout(struct timer *timer, void *data) {
+    struct relay_direction *direction = data;
+    if (direction->write_handle != -1) {
+        return;  // Nothing can go before the output takes what is queued; the window restarts then
+    }
+    relay_flush(direction);
+}
+
+/**
+ * @brief Enables -C coalescing on a direction that writes to a stream socket,
+ * and -F framing on one that writes to a datagram socket.
+ * 
+ * TCP directions on the splice path are corked instead of held, since their
+ * data never reaches user space; Unix stream sockets cannot be corked, so
+ * they fall back to the copy path and are held in the ring. A -C prompt must
+ * be seen to end the window early, so with one every direction copies.
+ * 
+ * @param direction The direction.
+ */
+void relay_coalesce_init(struct relay_direction *direction) {
+    timer_init(&direction->flush_timer, handle_flush_timeout, direction);
+    direction->corked = 0;
+    direction->prompt_matched = 0;
+    direction->coalesce = (coalescing.window_ms > 0 || coalescing.prompt != NULL) &&
+                          (direction->to_transport == TRANSPORT_TCP ||
+                           direction->to_transport == TRANSPORT_UDS_STREAM);
+    if (direction->coalesce && (direction->to_transport == TRANSPORT_UDS_STREAM || coalescing.prompt != NULL)) {
+        direction->splice = 0;
+    }
+    direction->frame_count = 0;
+    direction->frame_scanned = 0;
+    direction->framing = (direction->to_transport == TRANSPORT_UDP ||
+                          direction->to_transport == TRANSPORT_UDS_DGRAM) ? framing : FRAMING_NONE;
+}
+
+/**
+ * @brief Points a direction at the shared-memory channels behind its descriptors, if any.
+ * 
+ * A channel's data is in its rings, not behind the descriptor, so such
+ * directions always copy through their ring buffer.
+ * 
+ * @param direction The direction.
+ */
+void relay_shm_init(struct relay_direction *direction) {
+    direction->from_shm = shm_channel_of(direction->from);
+    direction->to_shm = shm_channel_of(direction->to);
+    if (direction->from_shm != NULL || direction->to_shm != NULL) {
+        direction->splice = 0;
+    }
+}
+
+/**
+ * @brief Reads what a shared-memory channel holds into a direction's ring buffer.
+ * 
+ * Fills the ring's free space, wrapping around like readv(); if more is
+ * waiting, the channel signals its wake_fd so the event loop comes back for it.
+ * 
+ * @param direction The direction; from_shm must be set.
+ * @return ssize_t Bytes read, 0 at EOF, or -1 on error (EAGAIN if woken with nothing to read).
+ */
+ssize_t relay_read_shm(struct relay_direction *direction) {
+    struct ring_buffer *ring = direction->ring;
+    size_t space = ring_buffer_space(ring);
+    if (space == 0) {
+        return 0;
+    }
+    struct iovec span[2];
+    int pieces = ring_span(ring, ring->tail, ring->tail + space, span);
+    ssize_t n = shm_read_event(direction->from_shm, span, pieces);
+    if (n > 0) {
+        ring->tail += n;
+    }
+    return n;
+}
+
+/**
+ * @brief Feeds one relayed byte to a direction's prompt matcher.
+ * 
+ * The match state carries over between reads, so a prompt split across
+ * two reads is still found.
+ * 
+ * @param direction The direction.
+ * @param prompt The prompt text.
+ * @param c The byte.
+ * @return int 1 if the byte completes the prompt.
+ */
+int relay_match_prompt(struct relay_direction *direction, const char *prompt, char c) {
+    if (c == prompt[direction->prompt_matched]) {
+        direction->prompt_matched++;
+    } else {
+        direction->prompt_matched = c == prompt[0];
+    }
+    if (prompt[direction->prompt_matched] == '\0') {
+        direction->prompt_matched = 0;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Looks for the -C prompt in the bytes just read into a direction's ring.
+ * 
+ * @param direction The direction.
+ * @param bytes How many bytes at the end of the ring are new.
+ * @return int 1 if the new bytes complete the prompt.
+ */
+int relay_saw_prompt(struct relay_direction *direction, size_t bytes) {
+    if (coalescing.prompt == NULL) {
+        return 0;
+    }
+    struct ring_buffer *ring = direction->ring;
+    int found = 0;
+    for (size_t position = ring->tail - bytes; position != ring->tail; position++) {
+        found |= relay_match_prompt(direction, coalescing.prompt, ring->data[position & (ring->capacity - 1)]);
+    }
+    return found;
+}
+
+/**
+ * @brief Finds the message boundaries in the bytes of a framing direction's ring not looked at yet.
+ * 
+ * Messages end after the prompt (the -C prompt, or ttt's) and, with -F line,
+ * after every newline. Batches are sent as soon as FRAME_BATCH are complete;
+ * while one waits for the socket, the bytes after it are looked at later.
+ * 
+ * @param direction The direction.
+ * @return int 0 on success, -1 if sending failed.
+ */
+int relay_frame(struct relay_direction *direction) {
+    struct ring_buffer *ring = direction->ring;
+    const char *prompt = coalescing.prompt != NULL ? coalescing.prompt : TTT_PROMPT;
+    size_t position;
+    for (position = direction->frame_scanned; position != ring->tail; position++) {
+        if (direction->frame_count == FRAME_BATCH) {
+            break;  // The last batch is waiting for the socket
+        }
+        char c = ring->data[position & (ring->capacity - 1)];
+        int boundary = relay_match_prompt(direction, prompt, c);
+        if (direction->framing == FRAMING_LINE && c == '\n') {
+            boundary = 1;
+        }
+        if (!boundary) {
+            continue;
+        }
+        direction->frame_ends[direction->frame_count++] = position + 1;
+        if (direction->frame_count == FRAME_BATCH && relay_send_frames(direction) == -1) {
+            return -1;
+        }
+    }
+    direction->frame_scanned = position;
+    return 0;
+}
+
+/**
+ * @brief Sends every complete message in a framing direction's ring, finding boundaries as it goes.
+ * 
+ * @param direction The direction.
+ * @return int 0 on success (frame_count stays above 0 if the socket is full), -1 if sending failed.
+ */
+int relay_send_complete(struct relay_direction *direction) {
+    do {
+        if (relay_frame(direction) == -1) {
+            return -1;
+        }
+        if (direction->frame_count > 0 && relay_send_frames(direction) == -1) {
+            return -1;
+        }
+    } while (direction->frame_count == 0 && direction->frame_scanned != direction->ring->tail);
+    return 0;
+}
+
+/**
+ * @brief Holds what a direction has buffered until its flush window ends, unless it is already held.
+ * 
+ * @param direction The direction.
+ */
+void relay_hold(struct relay_direction *direction) {
+    if (!direction->flush_timer.pending) {
+        timer_add(&wheel, &direction->flush_timer, coalescing.window_ms > 0 ? coalescing.window_ms
+                                                                         : COALESCE_DEFAULT_WINDOW_MS);
+    }
+}
+
+/**
+ * @brief Sends a framing direction's complete messages and holds the rest until it completes,
+ * the ring fills or the window ends.
+ * 
+ * @param direction The direction.
+ * @return int 1 if nothing needs flushing now, 0 if the ring is full and must be flushed, -1 if sending failed.
+ */
+int relay_send_messages(struct relay_direction *direction) {
+    if (relay_send_complete(direction) == -1) {
+        return -1;
+    }
+    if (direction->write_handle != -1) {
+        return 1;  // The rest goes once the socket has taken these
+    }
+    struct ring_buffer *ring = direction->ring;
+    if (ring_buffer_used(ring) == 0) {
+        ring->head = ring->tail = direction->frame_scanned = 0;  // Restart at offset 0 so the next message is contiguous
+        timer_cancel(&wheel, &direction->flush_timer);
+        return 1;
+    }
+    if (ring_buffer_space(ring) > 0) {
+        relay_hold(direction);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Handles the end of a relay direction's input.
+ * 
+ * A plain relay stops once every direction is done. In a -P session, EOF
+ * from the peer is passed on by closing the command's stdin, and EOF from the
+ * command ends the session once the command has also been reaped. Output
+ * still queued is written first.
+ */
+void relay_eof(struct event_loop *loop, struct relay_direction *direction) {
+    struct session *session = direction->session;
+    if (relay_flush(direction) == -1) {
+        return;  // The session was abandoned
+    }
+    if (direction->read_handle != -1) {
+        relay_watch_input(direction, 0);
+        event_loop_remove_handle(loop, direction->read_handle);
+        direction->read_handle = -1;
+    }
+    if (direction->write_handle != -1) {
+        direction->eof = 1;  // Finished by relay_writable once the rest is written
+        return;
+    }
+    if (direction->to_shm != NULL) {
+        shm_shutdown(direction->to_shm);  // The peer reads what is left, then sees EOF
+    }
+    if (session->child_output == -1) {
+        if (--*direction->open_directions == 0) {
+            timer_cancel(&wheel, &session->idle_timer);
+            timer_cancel(&wheel, &session->game_timer);
+            metrics.sessions_active--;
+            event_loop_stop(loop);
+        }
+        return;
+    }
+    if (direction->to == session->child_input) {
+        close(session->child_input);  // The command sees EOF on its stdin
+        session->child_input = -1;
+        return;
+    }
+    session->output_done = 1;
+    if (session->child_exited) {
+        session_finish(session);
+    }
+}
+
+/**
+ * @brief Counts data a direction read (-B): a write of the command, or the peer's moves.
+ * 
+ * The peer's moves are the lines it sent; spliced data never reaches user
+ * space, so there each read counts as one.
+ * 
+ * @param direction The direction.
+ * @param bytes Bytes just read; on the copy path they end the ring.
+ */
+void budget_received(struct relay_direction *direction, size_t bytes) {
+    struct session_budget *budget = &direction->session->budget;
+    if (direction->from == direction->session->child_output) {
+        budget->child_writes++;
+        return;
+    }
+    if (direction->splice) {
+        budget->turns++;
+        return;
+    }
+    struct ring_buffer *ring = direction->ring;
+    for (size_t position = ring->tail - bytes; position != ring->tail; position++) {
+        budget->turns += ring->data[position & (ring->capacity - 1)] == '\n';
+    }
+}
+
+/**
+ * @brief Handles a readable descriptor of a relay direction.
+ * 
+ * Each direction relays through its own ring buffer from the pool, so one
+ * readv() can take up to a full ring of data and one writev() sends it on.
+ * Directions between a pipe and a stream socket (-P splice) move the data
+ * with splice() instead, so it never passes through user space.
+ * 
+ * @param loop The event loop.
+ * @param fd The readable descriptor.
+ * @param revents The poll events.
+ * @param data The relay direction.
+ */
+void relay_event(struct event_loop *loop, int fd, short revents, void *data) {
+    struct relay_direction *direction = data;
+    struct session *session = direction->session;
+    long long start = monotonic_ns();
+    ssize_t bytes = 0;
+    if (direction->write_handle != -1) {
+        return;  // Paused this round, after poll() saw it readable
+    }
+    if (direction->splice && direction->coalesce && !direction->corked) {
+        // Let the kernel hold this burst's segments until the window ends
+        setsockopt(direction->to, IPPROTO_TCP, TCP_CORK, &(int){1}, sizeof(int));
+        direction->corked = 1;
+        session->budget.syscalls++;
+    }
+    if (direction->splice) {
+        bytes = splice(direction->from, NULL, direction->to, NULL, relay_buffer_size,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        session->budget.syscalls++;
+        if (bytes == -1 && errno == EAGAIN) {
+            relay_wait_writable(direction);  // The output is full; read again once it has room
+            return;
+        }
+        if (bytes == -1 && errno == EINVAL) {
+            direction->splice = 0;  // Not spliceable after all; copy from now on
+        } else if (bytes == -1) {
+            relay_fail(direction, "relaying from", direction->from_name);
+            return;
+        }
+    }
+    if (!direction->splice) {
+        if (direction->ring == NULL) {
+            direction->ring = buffer_pool_acquire(&relay_pool, relay_buffer_size);
+            if (direction->ring == NULL) {
+                relay_fail(direction, "allocating a buffer for", direction->from_name);
+                return;
+            }
+        }
+        bytes = direction->from_shm != NULL ? relay_read_shm(direction)
+                                            : ring_buffer_read_from(direction->ring, direction->from);
+        session->budget.syscalls += direction->from_shm == NULL;
+        if (bytes == -1 && errno == EAGAIN) {
+            return;  // A wakeup for data already read
+        }
+        if (bytes == -1) {
+            relay_fail(direction, "reading from", direction->from_name);
+            return;
+        }
+    }
+    PROBE3(mync, relay_read, session->id, direction->from, bytes);
+    if (bytes == 0) {
+        relay_eof(loop, direction);
+        return;
+    }
+    if (direction->from != STDIN_FILENO && direction->from != session->child_output) {
+        record_first_byte(session);
+        trace_first_byte(session);
+    }
+    session->last_activity_ms = timer_wheel_now_ms(&wheel);
+    metrics.bytes_in[direction->from_transport] += bytes;
+    if (budget_enabled) {
+        budget_received(direction, bytes);
+    }
+    if (direction->splice) {
+        metrics.bytes_out[direction->to_transport] += bytes;
+        budget_sent(direction, 0, 1, bytes);  // The splice() itself was the send
+    } else {
+        metrics.write_queue_bytes += bytes;
+    }
+
+    // A framing direction sends complete messages and holds the rest until it completes,
+    // the ring fills or the window ends
+    if (direction->framing != FRAMING_NONE) {
+        int held = relay_send_messages(direction);
+        if (held == -1) {
+            return;
+        }
+        if (held) {
+            if (ring_buffer_used(direction->ring) == 0) {
+                long long end = monotonic_ns();
+                hist_record(&relay_latency, end - start);
+                trace_span("relay", session->id, start, end, "bytes", bytes);
+            }
+            return;
+        }
+    }
+
+    // A coalescing direction holds the burst until the prompt, a full ring or the end of the window
+    if (direction->coalesce) {
+        int prompt = !direction->splice && relay_saw_prompt(direction, bytes);
+        if (!prompt && (direction->splice || ring_buffer_space(direction->ring) > 0)) {
+            relay_hold(direction);
+            return;
+        }
+    }
+    if (relay_flush(direction) == 0) {
+        long long end = monotonic_ns();
+        hist_record(&relay_latency, end - start);
+        trace_span("relay", session->id, start, end, "bytes", bytes);
+    }
+}
+
+/**
+ * @brief Event callback: a direction's output can take more, so what it queued goes on.
+ * 
+ * Once nothing is queued the direction reads again, or finishes if its input has ended.
+ * 
+ * @param loop The event loop.
+ * @param fd The writable descriptor.
+ * @param revents The poll events.
+ * @param data The relay direction.
+ */
+void relay_writable(struct event_loop *loop, int fd, short revents, void *data) {
+    struct relay_direction *direction = data;
+    event_loop_remove_handle(loop, direction->write_handle);
+    direction->write_handle = -1;
+    if (direction->to_shm != NULL) {
+        shm_write_event_done(direction->to_shm);
+    }
+    int result = 0;  // A spliced direction queues nothing; its next splice() goes ahead
+    if (direction->framing != FRAMING_NONE && !direction->flush_requested && !direction->eof) {
+        timer_cancel(&wheel, &direction->flush_timer);  // A held message gets a whole window now that it can go
+        result = relay_send_messages(direction);
+        if (result == 0) {
+            result = relay_flush(direction);  // The ring is full
+        }
+    } else if (!direction->splice) {
+        result = relay_flush(direction);
+    }
+    if (result == -1 || direction->write_handle != -1) {
+        return;  // Failed, or the output is full again
+    }
+    direction->flush_requested = 0;
+    if (direction->eof) {
+        relay_eof(loop, direction);
+    } else if (direction->read_handle != -1) {
+        relay_watch_input(direction, 1);  // Read again
+    }
+}
+
+/**
+ * @brief Connects a session's command to its peers through pipes relayed by the event loop (-P).
+ * 
+ * The command's stdin and stdout are pipes; mync relays peer_in to the
+ * first and the second to peer_out, so it counts (and can later batch and
+ * frame) every byte of the game without changing the command.
+ * 
+ * @param session The session; peer_in, peer_out and peer_transports must be set.
+ * @param arguments The argv array from parse_command().
+ * @return pid_t The command's process id, or -1 if it could not be started.
+ */
+pid_t start_piped_command(struct session *session, char *const arguments[]) {
+    int to_child[2];
+    int from_child[2];
+    if (pipe2(to_child, O_CLOEXEC) == -1) {
+        return -1;
+    }
+    if (pipe2(from_child, O_CLOEXEC) == -1) {
+        close(to_child[0]);
+        close(to_child[1]);
+        return -1;
+    }
+    pid_t pid = executeCommand(arguments, to_child[0], from_child[1], session->id);
+    close(to_child[0]);  // The command has its own copies
+    close(from_child[1]);
+    if (pid == -1) {
+        close(to_child[1]);
+        close(from_child[0]);
+        return -1;
+    }
+    session->child_input = to_child[1];
+    session->child_output = from_child[0];
+
+    // splice() needs a pipe on one side; datagram sockets keep their message boundaries by copying
+    int splice_in = child_io == CHILD_IO_SPLICE && (session->peer_transports[0] == TRANSPORT_TCP ||
+                                                     session->peer_transports[0] == TRANSPORT_UDS_STREAM);
+    int splice_out = child_io == CHILD_IO_SPLICE && (session->peer_transports[1] == TRANSPORT_TCP ||
+                                                      session->peer_transports[1] == TRANSPORT_UDS_STREAM);
+    session->relay[0] = (struct relay_direction){session->peer_in, session->child_input,
+        session->peer_transports[0], TRANSPORT_STDIO, "peer", "command input", NULL,
+        &session->open_directions, session, splice_in};
+    session->relay[1] = (struct relay_direction){session->child_output, session->peer_out, TRANSPORT_STDIO,
+        session->peer_transports[1], "command output", "peer", NULL, &session->open_directions, session,
+        splice_out};
+    relay_coalesce_init(&session->relay[0]);
+    relay_coalesce_init(&session->relay[1]);
+    relay_shm_init(&session->relay[0]);
+    relay_shm_init(&session->relay[1]);
+    if (watching && broadcasting == NULL) {
+        // Spectators see this game's output; it must pass through the ring to be published
+        broadcasting = session;
+        session->relay[1].broadcast = 1;
+        session->relay[1].splice = 0;
+    }
+    relay_start(&session->relay[0]);
+    relay_start(&session->relay[1]);
+    session->open_directions = 2;
+    return pid;
+}
+
+/**
+ * @brief Writes out what an in-process game has gathered.
+ * 
+ * @param io The game's I/O state.
+ */
+void game_flush(struct game_io *io) {
+    if (io->output_length == 0 || io->failed) {
+        return;
+    }
+    struct session *session = io->session;
+    long long start = trace_enabled ? monotonic_ns() : 0;
+    session->budget.syscalls++;
+    if (coroutine_write_all(io->coroutine, session->peer_out, io->output, io->output_length) == -1) {
+        io->failed = 1;  // The peer went away; the game ends at its next read
+    } else {
+        metrics.bytes_out[session->peer_transports[1]] += io->output_length;
+        session->budget.packets_sent++;
+        session->budget.bytes_sent += io->output_length;
+        if (trace_enabled) {
+            trace_span("game_write", session->id, start, monotonic_ns(), "bytes", io->output_length);
+        }
+    }
+    io->output_length = 0;
+}
+
+/**
+ * @brief Appends text to an in-process game's output, as ttt's printf() would print it.
+ * 
+ * @param io The game's I/O state.
+ * @param text The text.
+ */
+void game_print(struct game_io *io, const char *text) {
+    size_t length = strlen(text);
+    if (io->output_length + length > sizeof(io->output)) {
+        game_flush(io);
+    }
+    memcpy(io->output + io->output_length, text, length);
+    io->output_length += length;
+}
+
+/**
+ * @brief Prints the board the way ttt's displayBoard() does.
+ * 
+ * @param io The game's I/O state.
+ * @param board The board.
+ */
+void game_display_board(struct game_io *io, char board[SIZE][SIZE]) {
+    game_print(io, "-------------\n");
+    for (int i = 0; i < SIZE; i++) {
+        char row[] = "| ? | ? | ? |\n-------------\n";
+        for (int j = 0; j < SIZE; j++) {
+            row[2 + 4 * j] = board[i][j];
+        }
+        game_print(io, row);
+    }
+}
+
+/**
+ * @brief Worker task: searches an AI move and hands the result back to the event loop.
+ */
+void game_search_run(void *arg) {
+    struct game_search *search = arg;
+    long long start = trace_enabled ? monotonic_ns() : 0;
+    search->slot = ttt_best_move(search->board, search->aiMark, search->playerMark, &workers);
+    if (trace_enabled) {
+        trace_span("search", search->session_id, start, monotonic_ns(), "slot", search->slot);
+    }
+    pthread_mutex_lock(&search_lock);
+    search->next = search_done;
+    search_done = search;
+    pthread_mutex_unlock(&search_lock);
+    uint64_t one = 1;
+    if (write(search_wake_fd, &one, sizeof(one)) == -1) {
+        log_error("Error signalling a finished search: %s", strerror(errno));  // Needs 2^64 pending wakeups
+    }
+}
+
+/**
+ * @brief Event callback: workers finished searches; resume their games.
+ */
+void handle_search_done(struct event_loop *loop, int fd, short revents, void *data) {
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+        log_error("Error reading search completions: %s", strerror(errno));
+    }
+    pthread_mutex_lock(&search_lock);
+    struct game_search *search = search_done;
+    search_done = NULL;
+    pthread_mutex_unlock(&search_lock);
+    while (search != NULL) {
+        struct game_search *next = search->next;
+        if (search->session == NULL) {
+            free(search);  // Its session ended while the search ran
+        } else {
+            search->session->search = NULL;
+            coroutine_resume(search->coroutine);  // The game frees the search
+        }
+        search = next;
+    }
+}
+
+/**
+ * @brief Finds the minimax move, on the worker pool when there is one.
+ * 
+ * With -w the game's coroutine is suspended while a worker searches, so the
+ * event loop keeps serving other sessions and several games' searches run
+ * on separate cores.
+ * 
+ * @param io The game's I/O state.
+ * @param board The board.
+ * @param aiMark The AI's mark.
+ * @param playerMark The player's mark.
+ * @return int The slot to play (1-9).
+ */
+int game_search_move(struct game_io *io, char board[SIZE][SIZE], char aiMark, char playerMark) {
+    struct game_search *search = worker_count > 0 ? malloc(sizeof(*search)) : NULL;
+    if (search == NULL) {
+        long long start = trace_enabled ? monotonic_ns() : 0;
+        int slot = ttt_best_move(board, aiMark, playerMark, NULL);
+        if (trace_enabled) {
+            trace_span("search", io->session->id, start, monotonic_ns(), "slot", slot);
+        }
+        return slot;
+    }
+    search->session = io->session;
+    search->session_id = io->session->id;
+    search->coroutine = io->coroutine;
+    memcpy(search->board, board, sizeof(search->board));
+    search->aiMark = aiMark;
+    search->playerMark = playerMark;
+    search->task.run = game_search_run;
+    search->task.arg = search;
+    search->task.group = NULL;
+    io->session->search = search;
+    work_pool_submit(&workers, &search->task);
+    coroutine_yield(io->coroutine);  // Resumed by handle_search_done
+    int slot = search->slot;
+    free(search);
+    return slot;
+}
+
+/**
+ * @brief Makes the AI move the way ttt's makeAIMove() does, printing the chosen slot.
+ * 
+ * @param io The game's I/O state.
+ * @param board The board.
+ * @param strategy The game's strategy: -g's, or a resumed game's.
+ * @param aiMark The AI's mark.
+ * @return int The slot played (1-9).
+ */
+int game_ai_move(struct game_io *io, char board[SIZE][SIZE], const char *strategy, char aiMark) {
+    if (strcmp(strategy, TTT_MINIMAX) == 0) {
+        int row, col;
+        int slot = game_search_move(io, board, aiMark, aiMark == 'X' ? 'O' : 'X');
+        getBoardIndices(slot, &row, &col);
+        board[row][col] = aiMark;
+        char text[] = "?\n";
+        text[0] = '0' + slot;
+        game_print(io, text);
+        return slot;
+    }
+    for (int i = 0; i < 9; i++) {
+        int row, col;
+        getBoardIndices(strategy[i] - '0', &row, &col);
+        if (board[row][col] == ' ') {
+            board[row][col] = aiMark;
+            char slot[] = "?\n";
+            slot[0] = strategy[i];
+            game_print(io, slot);
+            return strategy[i] - '0';
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns the next unparsed input byte, suspending the game until the player sends one.
+ * 
+ * Pending output is written first, so the player sees the prompt before the game waits.
+ * 
+ * @param io The game's I/O state.
+ * @return int The byte, or -1 if the player has gone.
+ */
+int game_peek(struct game_io *io) {
+    while (io->input_start == io->input_end) {
+        game_flush(io);
+        if (io->failed) {
+            return -1;
+        }
+        struct session *session = io->session;
+        ssize_t n = coroutine_read(io->coroutine, session->peer_in, io->input, sizeof(io->input));
+        session->budget.syscalls++;
+        if (n <= 0) {
+            io->failed = 1;
+            return -1;
+        }
+        record_first_byte(session);
+        trace_first_byte(session);
+        if (trace_enabled) {
+            trace_instant("game_read", session->id, monotonic_ns(), "bytes", n);
+        }
+        session->last_activity_ms = timer_wheel_now_ms(&wheel);
+        metrics.bytes_in[session->peer_transports[0]] += n;
+        io->input_start = 0;
+        io->input_end = n;
+    }
+    return (unsigned char)io->input[io->input_start];
+}
+
+/**
+ * @brief Reads "resume <game>" (-G); any other word is an invalid move.
+ * 
+ * @param io The game's I/O state; resume_id receives the game's id.
+ * @param move Receives GAME_MOVE_RESUME, or 0 for another word.
+ * @return int 1 if the request was read, 0 if the player has gone.
+ */
+int game_read_resume(struct game_io *io, int *move) {
+    const char *word = "resume";
+    size_t matched = 0;
+    int c;
+    while ((c = game_peek(io)) != -1 && isalpha(c)) {
+        matched = matched < strlen(word) && c == word[matched] ? matched + 1 : strlen(word) + 1;
+        io->input_start++;
+    }
+    while (c != -1 && c != '\n' && isspace(c)) {
+        io->input_start++;
+        c = game_peek(io);
+    }
+    if (c == -1) {
+        return 0;
+    }
+    uint32_t id = 0;
+    while ((c = game_peek(io)) != -1 && isdigit(c)) {
+        id = id < 100000000 ? id * 10 + (c - '0') : UINT32_MAX;  // Saturate; no game has such an id
+        io->input_start++;
+    }
+    if (c == -1) {
+        return 0;
+    }
+    *move = matched == strlen(word) ? GAME_MOVE_RESUME : 0;
+    io->resume_id = id;
+    return 1;
+}
+
+/**
+ * @brief Reads the player's next number, as ttt's scanf("%d") does.
+ * 
+ * Anything that is not a number is skipped one byte at a time and reported
+ * as an invalid move, where ttt would reread its stale value forever. With
+ * -G, "resume <game>" asks for a saved game instead.
+ * 
+ * @param io The game's I/O state.
+ * @param move Receives the number (0 for unparsable input), or GAME_MOVE_RESUME.
+ * @return int 1 if a move was read, 0 if the player has gone.
+ */
+int game_read_move(struct game_io *io, int *move) {
+    int c;
+    while ((c = game_peek(io)) != -1 && isspace(c)) {
+        io->input_start++;
+    }
+    if (c == -1) {
+        return 0;
+    }
+    if (saving_games && c == 'r') {
+        return game_read_resume(io, move);
+    }
+    if (!isdigit(c)) {
+        io->input_start++;
+        *move = 0;
+        return 1;
+    }
+    int value = 0;
+    while ((c = game_peek(io)) != -1 && isdigit(c)) {
+        value = value < 100 ? value * 10 + (c - '0') : value;  // Saturate; any big number is invalid
+        io->input_start++;
+    }
+    *move = value;
+    return 1;
+}
+
+/**
+ * @brief Saves an in-process game where it waits for the player (-G).
+ * 
+ * Only those positions are saved, so a resumed game always continues with
+ * a prompt; a move the AI had not answered before a crash is asked again.
+ * 
+ * @param io The game's I/O state.
+ * @param game The game.
+ */
+void game_save(struct game_io *io, struct game_state *game) {
+    if (io->session->game_slot != -1) {
+        game_store_save(&saved_games, io->session->game_slot, game);
+    }
+}
+
+/**
+ * @brief Switches to the saved game the player asked for (-G), or says it cannot.
+ * 
+ * The game started for this session is dropped from the store, and the
+ * resumed one is shown as it was saved, waiting for the player's move.
+ * 
+ * @param io The game's I/O state; resume_id is the game asked for.
+ * @param game The game being played, replaced by the resumed one.
+ */
+void game_resume(struct game_io *io, struct game_state *game) {
+    struct session *session = io->session;
+    char text[64];
+    struct game_state resumed;
+    int slot = game_store_find(&saved_games, io->resume_id);
+    if (slot != -1 && (game_store_load(&saved_games, slot, &resumed) == -1 ||
+                       (!validateStrategy(resumed.strategy) && strcmp(resumed.strategy, TTT_MINIMAX) != 0))) {
+        game_store_release(&saved_games, slot);  // Unplayable: drop it
+        slot = -1;
+    }
+    if (slot == -1) {
+        snprintf(text, sizeof(text), "No game %u to resume.\n", io->resume_id);
+        game_print(io, text);
+        return;
+    }
+    if (session->game_slot != -1) {
+        game_store_release(&saved_games, session->game_slot);
+    }
+    session->game_slot = slot;
+    *game = resumed;
+    game->session = session->id;
+    game_save(io, game);
+    log_info("Session %d: resumed game %u of session %u", session->id, game->id, resumed.session);
+    snprintf(text, sizeof(text), "Resumed game %u\n", game->id);
+    game_print(io, text);
+    game_display_board(io, game->board);
+}
+
+/**
+ * @brief Prompts for and reads the player's move the way ttt's makePlayerMove() does.
+ * 
+ * @param io The game's I/O state.
+ * @param game The game; with -G the player may switch it to a saved one.
+ * @param playerMark The player's mark.
+ * @return int The slot played (1-9) once a valid move is on the board, 0 if the player has gone.
+ */
+int game_player_move(struct game_io *io, struct game_state *game, char playerMark) {
+    int move;
+    while (1) {
+        game_print(io, TTT_PROMPT);
+        if (!game_read_move(io, &move)) {
+            return 0;
+        }
+        io->session->budget.turns++;
+        if (move == GAME_MOVE_RESUME) {
+            game_resume(io, game);
+            continue;
+        }
+        if (move < 1 || move > 9) {
+            game_print(io, "Invalid move. Try again.\n");
+            continue;
+        }
+        int row, col;
+        getBoardIndices(move, &row, &col);
+        if (game->board[row][col] == ' ') {
+            game->board[row][col] = playerMark;
+            return move;
+        }
+        game_print(io, "That spot is already taken. Try again.\n");
+    }
+}
+
+/**
+ * @brief Plays one game of ttt with a session's peer, on the session's coroutine.
+ * 
+ * Reads like ttt's main loop; every wait for the player suspends the
+ * coroutine, so one thread plays all the sessions' games at once.
+ * 
+ * @param coroutine The game's coroutine.
+ * @param arg The session.
+ */
+void play_game(struct coroutine *coroutine, void *arg) {
+    struct game_io io;
+    io.session = arg;
+    io.coroutine = coroutine;
+    io.input_start = io.input_end = io.output_length = 0;
+    io.failed = 0;
+    struct session *session = io.session;
+    struct game_state game;
+    memset(&game, 0, sizeof(game));
+    snprintf(game.strategy, sizeof(game.strategy), "%s", game_strategy);
+    game.session = session->id;
+    char aiMark = 'X';
+    char playerMark = 'O';
+    initializeBoard(game.board);
+
+    // With -G the game is saved under an id the player can resume it with
+    if (saving_games) {
+        session->game_slot = game_store_claim(&saved_games, session->id, &game.id);
+        if (session->game_slot == -1) {
+            log_warn("Session %d: every slot of the game store is in use; not saving the game", session->id);
+        } else {
+            char text[32];
+            snprintf(text, sizeof(text), "Game %u\n", game.id);
+            game_print(&io, text);
+        }
+    }
+
+    enum game_result result = GAME_ABANDONED;
+    while (1) {
+        game.history[game.moves++] = game_ai_move(&io, game.board, game.strategy, aiMark);
+        game_display_board(&io, game.board);
+        if (isWinningMove(game.board, aiMark)) {
+            game_print(&io, "AI win\n");
+            result = GAME_AI_WIN;
+            break;
+        }
+        if (isBoardFull(game.board)) {
+            game_print(&io, "DRAW\n");
+            result = GAME_DRAW;
+            break;
+        }
+
+        game_save(&io, &game);
+        int move = game_player_move(&io, &game, playerMark);
+        if (move == 0) {
+            break;  // The player left mid-game; a saved game stays resumable
+        }
+        game.history[game.moves++] = move;
+        game_display_board(&io, game.board);
+        if (isWinningMove(game.board, playerMark)) {
+            game_print(&io, "AI lost\n");
+            result = GAME_AI_LOST;
+            break;
+        }
+        if (isBoardFull(game.board)) {
+            game_print(&io, "DRAW\n");
+            result = GAME_DRAW;
+            break;
+        }
+    }
+    if (result != GAME_ABANDONED && session->game_slot != -1) {
+        game_store_release(&saved_games, session->game_slot);
+        session->game_slot = -1;
+    }
+    // A saved game the player left may be resumed; it is logged once, when it finishes
+    if (logging_games && (result != GAME_ABANDONED || session->game_slot == -1)) {
+        game_log_add(&game_log, game.strategy, game.history, game.moves, result);
+    }
+    game_flush(&io);
+}
+
+/**
+ * @brief Coroutine done callback: the game is over, so the session ends.
+ * 
+ * @param coroutine The finished coroutine.
+ * @param arg The session.
+ */
+void handle_game_over(struct coroutine *coroutine, void *arg) {
+    struct session *session = arg;
+    long long runtime_ns = monotonic_ns() - session->game_started_ns;
+    hist_record(&child_runtime, runtime_ns);
+    trace_span("game", session->id, session->game_started_ns, session->game_started_ns + runtime_ns, NULL, 0);
+    PROBE2(mync, game_over, session->id, runtime_ns);
+    log_info("Session %d: game over after %.3f s", session->id, runtime_ns / 1e9);
+    session_finish(session);
+}
+
+/**
+ * @brief Starts an in-process game (-g) on a session's peers.
  * 
- * @param descriptors An array to store the file descriptors.
- * @param path The path to bind the socket to.
+ * The game's coroutine first runs from the event loop, once the peer can
+ * take output, so the caller never sees the session end under it.
+ * 
+ * @param session The session; peer_in, peer_out and peer_transports must be set.
+ * @return int 0 on success, -1 if no coroutine could be created.
  */
-void setup_UDSSSServer(int *descriptors, const char *path) {
-    // Create a Unix domain stream socket
-    int sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (sockfd == -1) {
-        perror("Error creating Unix domain socket (stream)");
-        exit(1);
+int start_game(struct session *session) {
+    set_nonblocking(session->peer_in);
+    set_nonblocking(session->peer_out);
+    session->game = coroutine_create(&coroutines, play_game, handle_game_over, session);
+    if (session->game == NULL) {
+        return -1;
     }
+    session->game_started_ns = monotonic_ns();
+    return coroutine_schedule(session->game, session->peer_out, POLLOUT);
+}
 
-    // Set up server address
-    struct sockaddr_un server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sun_family = AF_UNIX;
-    strncpy(server_addr.sun_path, path, sizeof(server_addr.sun_path) - 1);
-
-    // Remove the socket file if it already exists
-    unlink(path);
-
-    // Bind socket to server address
-    if (bind(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
-        perror("Error binding Unix domain socket (stream)");
-        close(sockfd);
-        exit(1);
+/**
+ * @brief Maps a -i/-o/-b argument to the transport its bytes are counted under.
+ * 
+ * @param type The argument, e.g. "TCPS4050" or "UDSCD/tmp/sock".
+ * @return enum transport The transport family.
+ */
+enum transport transport_of(const char *type) {
+    if (strncmp(type, "SHM", 3) == 0) {
+        return TRANSPORT_SHM;
     }
-
-    // Listen for connections
-    if (listen(sockfd, 1) == -1) {
-        perror("Error listening on Unix domain socket (stream)");
-        close(sockfd);
-        exit(1);
+    if (strncmp(type, "TCP", 3) == 0) {
+        return TRANSPORT_TCP;
     }
-
-    printf("Unix domain stream server started on %s\n", path);
-
-    // Accept a client connection
-    int client_fd = accept(sockfd, NULL, NULL);
-    if (client_fd == -1) {
-        perror("Error accepting connection on Unix domain socket (stream)");
-        close(sockfd);
-        exit(1);
+    if (strncmp(type, "UDP", 3) == 0) {
+        return TRANSPORT_UDP;
     }
-
-    // Store the client socket descriptor in the descriptors array
-    descriptors[0] = client_fd;
+    if (strncmp(type, "UDS", 3) == 0 && type[4] == 'D') {
+        return TRANSPORT_UDS_DGRAM;
+    }
+    if (strncmp(type, "UDS", 3) == 0) {
+        return TRANSPORT_UDS_STREAM;
+    }
+    return TRANSPORT_STDIO;
 }
 
 /**
- * @brief Sets up a Unix domain socket stream client.
+ * @brief Starts a session running the command for a peer that arrived on one of the accept loop's listeners.
  * 
- * @param descriptors An array to store the file descriptors.
- * @param path The path to connect the socket to.
+ * @param listener The listener the peer arrived on.
+ * @param client_fd The peer's connected socket; owned by the session from now on.
+ * @return struct session* The session, or NULL if it could not be started (client_fd is closed).
  */
-void setup_UDSCSClient(int *descriptors, const char *path) {
-    // Create a Unix domain stream socket
-    int sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (sockfd == -1) {
-        perror("Error creating Unix domain socket (stream)");
-        exit(1);
+struct session *start_session(struct session_listener *listener, int client_fd) {
+    struct session *session = calloc(1, sizeof(*session));
+    if (session == NULL) {
+        metrics.connections_accepted++;
+        metrics.connections_refused++;
+        close(client_fd);
+        return NULL;
     }
-
-    // Set up server address
-    struct sockaddr_un server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sun_family = AF_UNIX;
-    strncpy(server_addr.sun_path, path, sizeof(server_addr.sun_path) - 1);
-
-    printf("Connecting to Unix domain stream server at %s\n", path);
-
-    // Connect to the server
-    if (connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
-        perror("Error connecting to Unix domain socket (stream)");
-        close(sockfd);
-        exit(1);
+    session_start(session, ++server.started);
+    record_accept(session);
+    trace_instant("accept", session->id, session->accept_ns, NULL, 0);
+    if (child_io == CHILD_IO_DIRECT && game_strategy == NULL) {
+        session->idle_ms = 0;  // The command owns the socket, so mync never sees the traffic
     }
+    session_activate(session);
 
-    printf("Connected to Unix domain stream server at %s\n", path);
-    descriptors[1] = sockfd;
+    // Stop accepting on every listener at the limit; session_finish() resumes them
+    if (++server.active == server.max_sessions) {
+        for (int i = 0; i < server.listener_count; i++) {
+            event_loop_modify(&loop, server.listeners[i].fd, 0);
+        }
+    }
+    if (game_strategy != NULL) {
+        session->peer_in = client_fd;
+        session->peer_out = listener->bidirectional ? client_fd : STDOUT_FILENO;
+        session->peer_transports[0] = listener->transport;
+        session->peer_transports[1] = listener->bidirectional ? listener->transport : TRANSPORT_STDIO;
+        session->owns_peers = 1;
+        if (start_game(session) == -1) {
+            metrics.connections_refused++;
+            session_finish(session);
+            return NULL;
+        }
+        return session;
+    }
+    pid_t pid;
+    if (child_io == CHILD_IO_DIRECT) {
+        pid = executeCommand(server.command, client_fd, listener->bidirectional ? client_fd : STDOUT_FILENO,
+                             session->id);
+        close(client_fd);  // The command has its own copy
+    } else {
+        session->peer_in = client_fd;
+        session->peer_out = listener->bidirectional ? client_fd : STDOUT_FILENO;
+        session->peer_transports[0] = listener->transport;
+        session->peer_transports[1] = listener->bidirectional ? listener->transport : TRANSPORT_STDIO;
+        session->owns_peers = 1;
+        pid = start_piped_command(session, server.command);
+    }
+    if (pid == -1) {
+        metrics.connections_refused++;
+        session_finish(session);
+        return NULL;
+    }
+    child_watch(&loop, &session->process, pid, handle_session_exit, session);
+    return session;
 }
 
 /**
- * @brief Handles events for polling descriptors.
+ * @brief Accepts a peer on a stream listener and starts a session running the command for it.
  * 
- * @param fds The poll file descriptors.
- * @param descriptors The descriptors to read/write.
+ * @param loop The event loop.
+ * @param fd The listening socket.
+ * @param revents The poll events.
+ * @param data The session_listener.
  */
-void handle_poll_event(struct pollfd *fds, int *descriptors) {
-    if (fds[0].revents & POLLIN) {
-        char buffer[1024];
-        int bytes_read = read(fds[0].fd, buffer, sizeof(buffer));
-        if (bytes_read == -1) {
-            fprintf(stderr, "Error reading from input descriptor: %s\n", strerror(errno));
-            exit(EXIT_FAILURE);
+void accept_session(struct event_loop *loop, int fd, short revents, void *data) {
+    int client_fd = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+    if (client_fd == -1) {
+        if (errno != EAGAIN && errno != EINTR) {
+            metrics.connections_refused++;  // E.g. out of descriptors; the peer is dropped
         }
-        if (bytes_read == 0) {
+        return;
+    }
+    PROBE1(mync, accept, client_fd);
+    start_session(data, client_fd);
+}
+
+/**
+ * @brief Starts a session for a new client of a UDPS listener.
+ * 
+ * As with a single UDPS server, the client's first datagram only registers
+ * it and is answered with "ACK". The session gets its own socket bound to
+ * the listener's port and connected to the client, so the kernel delivers
+ * the client's later datagrams there instead of to the listener.
+ * 
+ * @param loop The event loop.
+ * @param fd The listener's bound UDP socket.
+ * @param revents The poll events.
+ * @param data The session_listener.
+ */
+void accept_datagram_session(struct event_loop *loop, int fd, short revents, void *data) {
+    struct session_listener *listener = data;
+    char buffer[1024];
+    struct sockaddr_in client_addr;
+    socklen_t client_addr_len = sizeof(client_addr);
+    if (recvfrom(fd, buffer, sizeof(buffer), MSG_DONTWAIT, (struct sockaddr *)&client_addr,
+                 &client_addr_len) == -1) {
+        return;
+    }
+    // Datagrams a client sent before its session socket was connected land here; drop them
+    for (struct session *session = datagram_sessions; session != NULL; session = session->next_datagram) {
+        if (session->datagram_peer.sin_addr.s_addr == client_addr.sin_addr.s_addr &&
+            session->datagram_peer.sin_port == client_addr.sin_port) {
             return;
         }
-        if (write(fds[1].fd, buffer, bytes_read) == -1) {
-            fprintf(stderr, "Error writing to output descriptor: %s\n", strerror(errno));
-            exit(EXIT_FAILURE);
+    }
+
+    int client_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in local_addr;
+    memset(&local_addr, 0, sizeof(local_addr));
+    local_addr.sin_family = AF_INET;
+    local_addr.sin_port = htons(listener->port);
+    local_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (client_fd == -1 ||
+        setsockopt(client_fd, SOL_SOCKET, SO_REUSEADDR, &(int){1}, sizeof(int)) == -1 ||
+        bind(client_fd, (struct sockaddr *)&local_addr, sizeof(local_addr)) == -1 ||
+        connect(client_fd, (struct sockaddr *)&client_addr, sizeof(client_addr)) == -1) {
+        metrics.connections_refused++;
+        if (client_fd != -1) {
+            close(client_fd);
         }
+        return;
     }
+    send(client_fd, "ACK", 3, 0);
+    struct session *session = start_session(listener, client_fd);
+    if (session != NULL) {
+        session->datagram_peer = client_addr;
+        session->next_datagram = datagram_sessions;
+        datagram_sessions = session;
+    }
+}
 
-    if (fds[1].revents & POLLIN) {
-        char buffer[1024];
-        int bytes_read = read(fds[1].fd, buffer, sizeof(buffer));
-        if (bytes_read == -1) {
-            fprintf(stderr, "Error reading from output descriptor: %s\n", strerror(errno));
+/**
+ * @brief Runs the accept loop: every peer of every listener gets its own command.
+ * 
+ * Used with -c or when several -i/-b listeners are given. Listeners are
+ * non-blocking and served by the one event loop, so a client arriving on
+ * one transport never waits for another. Never returns; mync serves
+ * sessions until it is killed.
+ * 
+ * @param command The argv array to start per peer.
+ * @param types The -i and -b arguments (TCPS<port>, UDPS<port> or UDSSS<path>).
+ * @param bidirectional For each type, whether the peer is also the command's stdout (-b).
+ * @param count Number of listeners.
+ * @param max_sessions Concurrent sessions before accepting pauses.
+ */
+void serve_sessions(char **command, char **types, const int *bidirectional, int count, int max_sessions) {
+    if ((command == NULL && game_strategy == NULL) || count == 0) {
+        fprintf(stderr, "-c and several listeners need -e or -g and -i or -b servers\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < count; i++) {
+        struct session_listener *listener = &server.listeners[i];
+        const char *type = types[i];
+        event_handler handler = accept_session;
+        if (strncmp(type, "TCPS", 4) == 0) {
+            listener->fd = listen_TCPServer(atoi(type + 4), SOMAXCONN);
+        } else if (strncmp(type, "UDSSS", 5) == 0) {
+            listener->fd = listen_UDSSSServer(type + 5, SOMAXCONN);
+        } else if (strncmp(type, "UDPS", 4) == 0) {
+            listener->port = atoi(type + 4);
+            listener->fd = listen_UDPServer(listener->port);
+            handler = accept_datagram_session;
+        } else {
+            fprintf(stderr, "The accept loop only supports TCPS, UDPS and UDSSS servers: %s\n", type);
             exit(EXIT_FAILURE);
         }
-        if (bytes_read == 0) {
-            return;
-        }
-        if (write(fds[3].fd, buffer, bytes_read) == -1) {
-            fprintf(stderr, "Error writing to stdout: %s\n", strerror(errno));
+        listener->transport = transport_of(type);
+        listener->bidirectional = bidirectional[i];
+        // Non-blocking, so a peer that disconnects before accept() cannot stall the loop
+        fcntl(listener->fd, F_SETFL, fcntl(listener->fd, F_GETFL) | O_NONBLOCK);
+        if (event_loop_add(&loop, listener->fd, POLLIN, handler, listener) == -1) {
+            perror("Error registering listener");
             exit(EXIT_FAILURE);
         }
+        server.listener_count++;
     }
+    server.command = command;
+    server.max_sessions = max_sessions;
+    log_start();
+    while (loop.running) {
+        run_loop_once();
+    }
+    exit(0);
+}
 
-    if (fds[2].revents & POLLIN) {
-        char buffer[1024];
-        int bytes_read = read(fds[2].fd, buffer, sizeof(buffer));
-        if (bytes_read == -1) {
-            fprintf(stderr, "Error reading from stdin: %s\n", strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        if (bytes_read == 0) {
-            return;
-        }
-        if (write(descriptors[1], buffer, bytes_read) == -1) {
-            fprintf(stderr, "Error writing to output descriptor: %s\n", strerror(errno));
+/**
+ * @brief Records a -i or -b argument as a listener for the accept loop.
+ * 
+ * @param types The listener arguments so far.
+ * @param bidirectional Whether each came from -b.
+ * @param count Number of listeners so far; incremented.
+ * @param type The argument.
+ * @param both 1 for -b, 0 for -i.
+ */
+void add_listener(char **types, int *bidirectional, int *count, char *type, int both) {
+    if (*count == SERVER_MAX_LISTENERS) {
+        fprintf(stderr, "At most %d -i/-b listeners are supported\n", SERVER_MAX_LISTENERS);
+        exit(EXIT_FAILURE);
+    }
+    types[*count] = type;
+    bidirectional[*count] = both;
+    (*count)++;
+}
+
+/**
+ * @brief Parses a -C coalescing list such as "window=5", "prompt" or "prompt=> ,window=20".
+ * 
+ * A bare "prompt" flushes on the ttt prompt.
+ * 
+ * @param text The coalescing list; modified by the parser.
+ */
+void parse_coalescing(char *text) {
+    char *item;
+    while ((item = strsep(&text, ",")) != NULL) {
+        if (strcmp(item, "prompt") == 0) {
+            coalescing.prompt = TTT_PROMPT;
+        } else if (strncmp(item, "prompt=", 7) == 0 && item[7] != '\0') {
+            coalescing.prompt = item + 7;
+        } else if (strncmp(item, "window=", 7) == 0 && atoll(item + 7) > 0) {
+            coalescing.window_ms = atoll(item + 7);
+        } else {
+            fprintf(stderr, "Invalid coalescing option: %s\n", item);
             exit(EXIT_FAILURE);
         }
     }
 }
+
+/**
+ * @brief Opens the -W spectator listener ("TCPS<port>" or "UDSSS<path>") and serves it from the event loop.
+ * 
+ * @param type The listener specification.
+ * @param lag_limit Bytes a spectator may fall behind.
+ * @param lag_policy What happens to a spectator past the limit.
+ */
+void setup_watchers(char *type, size_t lag_limit, enum broadcast_lag_policy lag_policy) {
+    int listen_fd;
+    if (strncmp(type, "TCPS", 4) == 0) {
+        listen_fd = listen_TCPServer(atoi(type + 4), SOMAXCONN);
+    } else if (strncmp(type, "UDSSS", 5) == 0) {
+        listen_fd = listen_UDSSSServer(type + 5, SOMAXCONN);
+    } else {
+        fprintf(stderr, "-W only supports TCPS and UDSSS listeners: %s\n", type);
+        exit(EXIT_FAILURE);
+    }
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    broadcast_init(&spectators, &loop, lag_limit, lag_policy);
+    broadcast_serve(&spectators, listen_fd);
+    watching = 1;
+}
+
+/**
+ * @brief Parses a -L spectator lag limit such as "drop=256" or "skip=64" (in kilobytes).
+ * 
+ * @param text The lag limit.
+ * @param lag_limit Set to the limit in bytes.
+ * @param lag_policy Set to the policy named.
+ */
+void parse_lag_limit(const char *text, size_t *lag_limit, enum broadcast_lag_policy *lag_policy) {
+    if (strncmp(text, "drop=", 5) == 0 && atoll(text + 5) > 0) {
+        *lag_policy = BROADCAST_DROP;
+    } else if (strncmp(text, "skip=", 5) == 0 && atoll(text + 5) > 0) {
+        *lag_policy = BROADCAST_SKIP;
+    } else {
+        fprintf(stderr, "Invalid lag limit: %s (use drop=KB or skip=KB)\n", text);
+        exit(EXIT_FAILURE);
+    }
+    *lag_limit = (size_t)atoll(text + 5) * 1024;
+}
+
+/**
+ * @brief Parses a buffer size argument such as "4096", "64K" or "1M".
+ * 
+ * @param text The size string.
+ * @return size_t The size in bytes, rounded to a ring buffer size class.
+ */
+size_t parse_buffer_size(const char *text) {
+    char *end;
+    unsigned long size = strtoul(text, &end, 10);
+    if (*end == 'k' || *end == 'K') {
+        size *= 1024;
+    } else if (*end == 'm' || *end == 'M') {
+        size *= 1024 * 1024;
+    }
+    if (size < RING_MIN_SIZE || size > RING_MAX_SIZE) {
+        fprintf(stderr, "Buffer size must be between 4K and 1M\n");
+        exit(EXIT_FAILURE);
+    }
+    return ring_size_round(size);
+}
+
 int main(int argc, char *argv[]) {
     // Check if the number of arguments is less than 2
     if (argc < 2) {
@@ -541,29 +3004,142 @@ int main(int argc, char *argv[]) {
     }
 
     int option;  // Variable to store the current option parsed by getopt
-    char *exec_command = NULL;  // Variable to store the command to execute
+    char **exec_command = NULL;  // The command to execute, parsed once into argv
     char *input_type = NULL;  // Variable to store the input type
     char *output_type = NULL;  // Variable to store the output type
-    char *timeout = NULL;  // Variable to store the timeout value
+    char *both_type = NULL;  // Variable to store the bidirectional type
+    int dump_at_exit = 0;  // Print the latency histograms when mync exits
+    const char *log_spec = NULL;  // Log destination and level (-l), NULL for INFO to stderr
+    const char *trace_path = NULL;  // Chrome trace written at exit (-X), NULL to not trace
+    const char *store_spec = NULL;  // Game store file (-G), "[sync:]path"
+    const char *game_log_spec = NULL;  // Game log file (-R), "[compress:]path"
+    char *metrics_type = NULL;  // Variable to store the stats listener
+    int max_sessions = 0;  // With -c, concurrent sessions served by the accept loop
+    char *watch_type = NULL;  // Spectator listener (TCPS<port> or UDSSS<path>)
+    size_t lag_limit = WATCH_DEFAULT_LAG_KB * 1024;  // Bytes a spectator may fall behind
+    enum broadcast_lag_policy lag_policy = BROADCAST_DROP;  // Applied past lag_limit
+    char *listen_types[SERVER_MAX_LISTENERS];  // Every -i and -b argument, for the accept loop
+    int listen_bidirectional[SERVER_MAX_LISTENERS];  // Whether each came from -b
+    int listen_count = 0;  // Number of -i and -b arguments
 
     // Parse command-line options using getopt
-    while ((option = getopt(argc, argv, "e:i:o:t:")) != -1) {
+    while ((option = getopt(argc, argv, "e:i:o:b:t:T:s:Hm:c:P:C:F:W:L:g:w:l:X:BG:R:")) != -1) {
         switch (option) {
             // If the option is 'e', store the argument in exec_command
             case 'e':
-                exec_command = optarg;
+                exec_command = parse_command(optarg);
                 break;
-            // If the option is 'i', store the argument in input_type
+            // If the option is 'i', store the argument in input_type (repeatable: every -i is a listener)
             case 'i':
                 input_type = optarg;
+                add_listener(listen_types, listen_bidirectional, &listen_count, optarg, 0);
                 break;
             // If the option is 'o', store the argument in output_type
             case 'o':
                 output_type = optarg;
                 break;
-            // If the option is 't', store the argument in timeout
+            // If the option is 'b', store the argument in both_type (repeatable, like -i)
+            case 'b':
+                both_type = optarg;
+                add_listener(listen_types, listen_bidirectional, &listen_count, optarg, 1);
+                break;
+            // If the option is 't', limit both the wait for peers and the game to that many seconds
             case 't':
-                timeout = optarg;
+                deadlines.connect_ms = deadlines.game_ms = atoll(optarg) * 1000;
+                break;
+            // If the option is 'T', parse the per-session deadlines (connect=N,idle=N,game=N)
+            case 'T':
+                parse_deadlines(optarg);
+                break;
+            // If the option is 's', store the relay buffer size
+            case 's':
+                relay_buffer_size = parse_buffer_size(optarg);
+                break;
+            // If the option is 'l', log to this file, optionally from a level ([level:]path, - for stderr)
+            case 'l':
+                log_spec = optarg;
+                break;
+            // If the option is 'X', write a Chrome trace of every session's events to this file at exit
+            case 'X':
+                trace_path = optarg;
+                break;
+            // If the option is 'G', save in-process games in this file so players can resume them
+            case 'G':
+                store_spec = optarg;
+                break;
+            // If the option is 'R', append every in-process game's moves to this binary log
+            case 'R':
+                game_log_spec = optarg;
+                break;
+            // If the option is 'B', log each session's system call and packet budget when it ends
+            case 'B':
+                budget_enabled = 1;
+                break;
+            // If the option is 'H', print the latency histograms at exit
+            case 'H':
+                dump_at_exit = 1;
+                break;
+            // If the option is 'm', store the stats listener (TCPS<port> or UDSSS<path>)
+            case 'm':
+                metrics_type = optarg;
+                break;
+            // If the option is 'P', connect the command through pipes relayed by mync (splice or copy)
+            case 'P':
+                if (strcmp(optarg, "splice") == 0) {
+                    child_io = CHILD_IO_SPLICE;
+                } else if (strcmp(optarg, "copy") == 0) {
+                    child_io = CHILD_IO_COPY;
+                } else {
+                    fprintf(stderr, "Invalid pipe mode: %s (use splice or copy)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            // If the option is 'C', coalesce stream output (window=MS, prompt or prompt=TEXT)
+            case 'C':
+                parse_coalescing(optarg);
+                break;
+            // If the option is 'F', frame datagram output into messages (line or turn)
+            case 'F':
+                if (strcmp(optarg, "line") == 0) {
+                    framing = FRAMING_LINE;
+                } else if (strcmp(optarg, "turn") == 0) {
+                    framing = FRAMING_TURN;
+                } else {
+                    fprintf(stderr, "Invalid framing: %s (use line or turn)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            // If the option is 'g', play ttt in-process with this strategy instead of running a command
+            case 'g':
+                if (!validateStrategy(optarg) && strcmp(optarg, TTT_MINIMAX) != 0) {
+                    fprintf(stderr, "Invalid strategy: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                game_strategy = optarg;
+                break;
+            // If the option is 'w', search minimax AI moves on this many worker threads
+            case 'w':
+                worker_count = atoi(optarg);
+                if (worker_count < 1 || worker_count > WORK_POOL_MAX_WORKERS) {
+                    fprintf(stderr, "Invalid worker count: %s (1-%d)\n", optarg, WORK_POOL_MAX_WORKERS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            // If the option is 'W', broadcast the command's output to spectators on this listener
+            case 'W':
+                watch_type = optarg;
+                break;
+            // If the option is 'L', set how far a spectator may lag (drop=KB or skip=KB)
+            case 'L':
+                parse_lag_limit(optarg, &lag_limit, &lag_policy);
+                break;
+            // If the option is 'c', keep accepting and run up to that many sessions at once
+            case 'c':
+                max_sessions = atoi(optarg);
+                if (max_sessions <= 0) {
+                    fprintf(stderr, "Invalid session limit: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
                 break;
             // If an unknown option is encountered, print the usage message and exit
             default:
@@ -572,21 +3148,146 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    // If a timeout is specified, set up a signal handler for the alarm signal
-    if (timeout != NULL) {
-        signal(SIGALRM, handle_timeout);
-        // Set the alarm to trigger after the specified number of seconds
-        alarm(atoi(timeout));
+    // Status lines go to the log (stderr by default), never to the stdout a peer may be reading
+    log_init(log_spec);
+
+    // Tracing records into preallocated buffers, written at exit
+    if (trace_path != NULL) {
+        trace_init(trace_path);
+    }
+
+    // SIGINT and SIGTERM exit through exit(), so the trace, the queued log records and the
+    // coverage or training profile of a stopped server are written
+    struct sigaction stop_action;
+    memset(&stop_action, 0, sizeof(stop_action));
+    stop_action.sa_handler = handle_stop_signal;
+    sigaction(SIGINT, &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+
+    // Set up the latency histograms; SIGUSR1 interrupts blocking calls so the dump happens promptly
+    hist_init(&relay_latency, "relay");
+    hist_init(&first_byte_latency, "accept_to_first_byte");
+    hist_init(&spawn_latency, "spawn_to_exec");
+    hist_init(&child_runtime, "child_runtime");
+    struct sigaction dump_action;
+    memset(&dump_action, 0, sizeof(dump_action));
+    dump_action.sa_handler = handle_dump_signal;
+    sigaction(SIGUSR1, &dump_action, NULL);
+    if (dump_at_exit) {
+        atexit(dump_histograms);
+    }
+
+    if (game_strategy != NULL && exec_command != NULL) {
+        fprintf(stderr, "-g plays the game in mync; it cannot be combined with -e\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (worker_count > 0 && (game_strategy == NULL || strcmp(game_strategy, TTT_MINIMAX) != 0)) {
+        fprintf(stderr, "-w searches AI moves; it needs -g %s\n", TTT_MINIMAX);
+        exit(EXIT_FAILURE);
+    }
+
+    // The store saves in-process games; a command's game state lives in the command
+    if (store_spec != NULL) {
+        if (game_strategy == NULL) {
+            fprintf(stderr, "-G saves in-process games; it needs -g\n");
+            exit(EXIT_FAILURE);
+        }
+        int durable = strncmp(store_spec, "sync:", 5) == 0;
+        const char *store_path = durable ? store_spec + 5 : store_spec;
+        if (game_store_open(&saved_games, store_path, durable) == -1) {
+            fprintf(stderr, "Error opening game store %s: %s\n", store_path,
+                    errno == EINVAL ? "not a game store file" : strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        saving_games = 1;
+        log_info("Game store %s: %d unfinished games to resume%s", store_path, game_store_unfinished(&saved_games),
+                 durable ? ", every save synced to disk" : "");
+    }
+
+    // The game log records in-process games, whose moves mync sees
+    if (game_log_spec != NULL) {
+        if (game_strategy == NULL) {
+            fprintf(stderr, "-R logs in-process games; it needs -g\n");
+            exit(EXIT_FAILURE);
+        }
+        int compress = strncmp(game_log_spec, "compress:", 9) == 0;
+        const char *game_log_path = compress ? game_log_spec + 9 : game_log_spec;
+        if (game_log_open(&game_log, game_log_path, compress) == -1) {
+            fprintf(stderr, "Error opening game log %s: %s\n", game_log_path,
+                    errno == EINVAL ? "not a game log, or a corrupt one" : strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        logging_games = 1;
+        atexit(flush_game_log);
+    }
+
+    // Spectators are fed from the relay, so the command's output must pass through mync
+    if (watch_type != NULL && exec_command == NULL) {
+        fprintf(stderr, "-W needs a command started with -e\n");
+        exit(EXIT_FAILURE);
+    }
+    if (watch_type != NULL && child_io == CHILD_IO_DIRECT) {
+        child_io = CHILD_IO_COPY;
+    }
+
+    // Likewise -B counts what mync relays; a command writing straight to its peer would show nothing
+    if (budget_enabled && exec_command != NULL && child_io == CHILD_IO_DIRECT) {
+        child_io = CHILD_IO_COPY;
+    }
+
+    // And -C coalesces, and -F frames, what mync relays to the command's peer
+    if ((coalescing.window_ms > 0 || coalescing.prompt != NULL || framing != FRAMING_NONE) &&
+        exec_command != NULL && child_io == CHILD_IO_DIRECT) {
+        child_io = CHILD_IO_COPY;
+    }
+
+    // A peer that disconnects must fail that relay's write, not kill mync with SIGPIPE
+    if (child_io != CHILD_IO_DIRECT || game_strategy != NULL) {
+        signal(SIGPIPE, SIG_IGN);
+    }
+    buffer_pool_init(&relay_pool, 0);
+    atexit(restore_stdio_flags);  // Relays and games make their peers, standard streams included, non-blocking
+
+    // Open the stats listener before the data-plane setup so it can be scraped while waiting for peers
+    event_loop_init(&loop);
+    timer_wheel_init(&wheel, &loop, TIMER_TICK_MS);
+    coroutine_pool_init(&coroutines, &loop);
+    if (worker_count > 0) {
+        search_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (search_wake_fd == -1 || work_pool_init(&workers, worker_count) == -1) {
+            perror("work pool");
+            exit(EXIT_FAILURE);
+        }
+        event_loop_add(&loop, search_wake_fd, POLLIN, handle_search_done, NULL);
+        metrics.work_pool = &workers;
+    }
+    if (metrics_type != NULL) {
+        metrics_serve(&loop, metrics_listen(metrics_type));
+    }
+    if (watch_type != NULL) {
+        setup_watchers(watch_type, lag_limit, lag_policy);
+    }
+
+    // With -c or several listeners, serve many sessions from one event loop instead of a single peer
+    if (listen_count > 1 && max_sessions == 0) {
+        max_sessions = SERVER_DEFAULT_SESSIONS;
     }
+    if (max_sessions > 0) {
+        serve_sessions(exec_command, listen_types, listen_bidirectional, listen_count, max_sessions);
+    }
+    session_start(&current_session, 1);  // Arms the connect deadline
 
     int descriptors[2];  // Array to store file descriptors
     descriptors[0] = STDIN_FILENO;  // Default input is standard input
     descriptors[1] = STDOUT_FILENO; // Default output is standard output
+    enum transport transports[2] = {TRANSPORT_STDIO, TRANSPORT_STDIO};  // Transport of each descriptor
 
     // If an input type is specified
     if (input_type != NULL) {
-        // Print the input type
-        printf(" i = : %s\n", input_type);
+        // Log the input type
+        log_info(" i = : %s", input_type);
+        transports[0] = transport_of(input_type);
         // Check if the input type is TCP server
         if (strncmp(input_type, "TCPS", 4) == 0) {
             input_type += 4;  // Skip the "TCPS" prefix
@@ -597,12 +3298,7 @@ int main(int argc, char *argv[]) {
         else if (strncmp(input_type, "UDPS", 4) == 0) {
             input_type += 4;  // Skip the "UDPS" prefix
             int port = atoi(input_type);  // Convert the port to an integer
-            // Set up a UDP server with the specified timeout
-            if (timeout != NULL) {
-                setup_UDPServer(descriptors, port, atoi(timeout));
-            } else {
-                setup_UDPServer(descriptors, port, 0);
-            }
+            setup_UDPServer(descriptors, port);  // Set up a UDP server
         } 
         // Check if the input type is Unix domain socket datagram server
         else if (strncmp(input_type, "UDSSD", 5) == 0) {
@@ -614,6 +3310,11 @@ int main(int argc, char *argv[]) {
             input_type += 5;  // Skip the "UDSSS" prefix
             setup_UDSSSServer(descriptors, input_type);  // Set up a Unix domain socket stream server
         } 
+        // Check if the input type is shared-memory server
+        else if (strncmp(input_type, "SHMS", 4) == 0) {
+            input_type += 4;  // Skip the "SHMS" prefix
+            setup_SHMServer(descriptors, input_type);  // Set up a shared-memory server
+        } 
         // If the input type is invalid, print an error message and exit
         else {
             fprintf(stderr, "Invalid input type: %s\n", input_type);
@@ -621,10 +3322,57 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // If a bidirectional type is specified, the server socket is both input and output
+    if (both_type != NULL) {
+        // Log the bidirectional type
+        log_info(" b = : %s", both_type);
+        transports[0] = transports[1] = transport_of(both_type);
+        // Check if the bidirectional type is TCP server
+        if (strncmp(both_type, "TCPS", 4) == 0) {
+            both_type += 4;  // Skip the "TCPS" prefix
+            int port = atoi(both_type);  // Convert the port to an integer
+            setup_TCPServer(descriptors, port, "b");  // Set up a TCP server for both directions
+        }
+        // Check if the bidirectional type is UDP server
+        else if (strncmp(both_type, "UDPS", 4) == 0) {
+            both_type += 4;  // Skip the "UDPS" prefix
+            int port = atoi(both_type);  // Convert the port to an integer
+            // Set up a UDP server; it is connected to the first client
+            setup_UDPServer(descriptors, port);
+            descriptors[1] = descriptors[0];  // Reply on the same socket
+        }
+        // Check if the bidirectional type is Unix domain socket stream server
+        else if (strncmp(both_type, "UDSSS", 5) == 0) {
+            both_type += 5;  // Skip the "UDSSS" prefix
+            setup_UDSSSServer(descriptors, both_type);  // Set up a Unix domain socket stream server
+            descriptors[1] = descriptors[0];  // Reply on the same socket
+        }
+        // Check if the bidirectional type is Unix domain socket datagram server
+        else if (strncmp(both_type, "UDSSD", 5) == 0) {
+            both_type += 5;  // Skip the "UDSSD" prefix
+            setup_UDSSDServer(descriptors, both_type);  // Set up a Unix domain socket datagram server
+            connect_UDSSDPeer(descriptors[0]);  // Connect to the first client so replies reach it
+            descriptors[1] = descriptors[0];  // Reply on the same socket
+        }
+        // Check if the bidirectional type is shared-memory server
+        else if (strncmp(both_type, "SHMS", 4) == 0) {
+            both_type += 4;  // Skip the "SHMS" prefix
+            setup_SHMServer(descriptors, both_type);  // Set up a shared-memory server
+            descriptors[1] = descriptors[0];  // Reply on the same channel
+        }
+        // If the bidirectional type is invalid, print an error message and exit
+        else {
+            fprintf(stderr, "Invalid bidirectional type: %s\n", both_type);
+            close_descriptors(descriptors);
+            exit(1);
+        }
+    }
+
     // If an output type is specified
     if (output_type != NULL) {
-        // Print the output type
-        printf(" o = : %s\n", output_type);
+        // Log the output type
+        log_info(" o = : %s", output_type);
+        transports[1] = transport_of(output_type);
         // Check if the output type is TCP client
         if (strncmp(output_type, "TCPC", 4) == 0) {
             output_type += 4;  // Skip the "TCPC" prefix
@@ -661,6 +3409,39 @@ int main(int argc, char *argv[]) {
             int port = atoi(port_number);  // Convert the port to an integer
             setup_UDPClient(descriptors, ip_server, port);  // Set up a UDP client
         } 
+        // Check if the output type is UDP multicast (UDPM<group>,<port>[,ttl=N][,loop=0|1][,if=ADDR])
+        else if (strncmp(output_type, "UDPM", 4) == 0) {
+            output_type += 4;  // Skip the "UDPM" prefix
+            char *group = strtok(output_type, ",");  // Extract the group address
+            char *port_number = strtok(NULL, ",");  // Extract the port number
+            if (group == NULL || port_number == NULL) {
+                fprintf(stderr, "Invalid multicast output (use UDPM<group>,<port>)\n");
+                close_descriptors(descriptors);
+                exit(1);
+            }
+            int ttl = 1;  // Local network only
+            int loopback = 1;  // Local dashboards and bots see the stream too
+            char *interface = NULL;  // Routing default
+            for (char *item = strtok(NULL, ","); item != NULL; item = strtok(NULL, ",")) {
+                if (strncmp(item, "ttl=", 4) == 0) {
+                    ttl = atoi(item + 4);
+                } else if (strncmp(item, "loop=", 5) == 0) {
+                    loopback = atoi(item + 5);
+                } else if (strncmp(item, "if=", 3) == 0) {
+                    interface = item + 3;
+                } else {
+                    fprintf(stderr, "Invalid multicast option: %s\n", item);
+                    close_descriptors(descriptors);
+                    exit(1);
+                }
+            }
+            if (ttl < 0 || ttl > 255) {
+                fprintf(stderr, "Invalid multicast TTL: %d\n", ttl);
+                close_descriptors(descriptors);
+                exit(1);
+            }
+            setup_UDPMulticast(descriptors, group, atoi(port_number), ttl, loopback, interface);
+        } 
         // Check if the output type is Unix domain socket datagram client
         else if (strncmp(output_type, "UDSCD", 5) == 0) {
             output_type += 5;  // Skip the "UDSCD" prefix
@@ -671,6 +3452,11 @@ int main(int argc, char *argv[]) {
             output_type += 5;  // Skip the "UDSCS" prefix
             setup_UDSCSClient(descriptors, output_type);  // Set up a Unix domain socket stream client
         } 
+        // Check if the output type is shared-memory client
+        else if (strncmp(output_type, "SHMC", 4) == 0) {
+            output_type += 4;  // Skip the "SHMC" prefix
+            setup_SHMClient(descriptors, output_type);  // Set up a shared-memory client
+        } 
         // Check if the output type is TCP server
         else if (strncmp(output_type, "TCPS", 4) == 0) {
             output_type += 4;  // Skip the "TCPS" prefix
@@ -681,12 +3467,7 @@ int main(int argc, char *argv[]) {
         else if (strncmp(output_type, "UDPS", 4) == 0) {
             output_type += 4;  // Skip the "UDPS" prefix
             int port = atoi(output_type);  // Convert the port to an integer
-            // Set up a UDP server with the specified timeout
-            if (timeout != NULL) {
-                setup_UDPServer(descriptors, port, atoi(timeout));
-            } else {
-                setup_UDPServer(descriptors, port, 0);
-            }
+            setup_UDPServer(descriptors, port);  // Set up a UDP server
         } 
         // Check if the output type is Unix domain socket stream server
         else if (strncmp(output_type, "UDSSS", 5) == 0) {
@@ -694,6 +3475,7 @@ int main(int argc, char *argv[]) {
             setup_UDSSSServer(descriptors, output_type);  // Set up a Unix domain socket stream server
             descriptors[1] = descriptors[0];  // Set descriptors[1] to the socket
             descriptors[0] = STDIN_FILENO;  // Set descriptors[0] to standard input
+            transports[0] = TRANSPORT_STDIO;
         } 
         // Check if the output type is Unix domain socket datagram server
         else if (strncmp(output_type, "UDSSD", 5) == 0) {
@@ -701,6 +3483,7 @@ int main(int argc, char *argv[]) {
             setup_UDSSDServer(descriptors, output_type);  // Set up a Unix domain socket datagram server
             descriptors[1] = descriptors[0];  // Set descriptors[1] to the socket
             descriptors[0] = STDIN_FILENO;  // Set descriptors[0] to standard input
+            transports[0] = TRANSPORT_STDIO;
         } 
         // If the output type is invalid, print an error message and exit
         else {
@@ -711,60 +3494,109 @@ int main(int argc, char *argv[]) {
     }
 
     // If an execution command is specified
+    // Setup is done; from here on log records are written by a background thread
+    log_start();
+    if (current_session.accept_ns != 0) {
+        trace_instant("accept", current_session.id, current_session.accept_ns, NULL, 0);
+    }
+
     if (exec_command != NULL) {
-        // Redirect input descriptor to standard input if necessary
-        if (descriptors[0] != STDIN_FILENO) {
-            if (dup2(descriptors[0], STDIN_FILENO) == -1) {
-                close(descriptors[0]);
-                if (descriptors[1] != STDOUT_FILENO) {
-                    close(descriptors[1]);
-                }
-                fprintf(stderr, "failed to duplicating input descriptor: %s\n", strerror(errno));
-                exit(EXIT_FAILURE);
+        // Execute the command on the session's descriptors, or on pipes relayed to them with -P;
+        // only then does mync see the game's traffic, so otherwise only the game deadline applies
+        pid_t pid;
+        if (shm_channel_count > 0 && child_io == CHILD_IO_DIRECT) {
+            child_io = CHILD_IO_COPY;  // A command cannot use a channel as its stdin/stdout; mync relays it
+            signal(SIGPIPE, SIG_IGN);
+        }
+        if (child_io == CHILD_IO_DIRECT) {
+            current_session.idle_ms = 0;
+            session_activate(&current_session);
+            pid = executeCommand(exec_command, descriptors[0], descriptors[1], current_session.id);
+        } else {
+            session_activate(&current_session);
+            current_session.peer_in = descriptors[0];
+            current_session.peer_out = descriptors[1];
+            current_session.peer_transports[0] = transports[0];
+            current_session.peer_transports[1] = transports[1];
+            pid = start_piped_command(&current_session, exec_command);
+        }
+        if (pid == -1) {
+            exit(EXIT_FAILURE);
+        }
+        child_watch(&loop, &current_session.process, pid, handle_session_exit, &current_session);
+
+        // Serve the stats listener and the deadlines until the child exits
+        while (loop.running) {
+            run_loop_once();
+        }
+        // Flush stdout to ensure all output is printed before exiting
+        fflush(stdout);
+    } else if (game_strategy != NULL) {  // Play the game in-process on the descriptors
+        if (shm_channel_count > 0) {
+            fprintf(stderr, "-g needs socket or stdio peers, not shared-memory channels\n");
+            exit(EXIT_FAILURE);
+        }
+        session_activate(&current_session);
+        current_session.peer_in = descriptors[0];
+        current_session.peer_out = descriptors[1];
+        current_session.peer_transports[0] = transports[0];
+        current_session.peer_transports[1] = transports[1];
+        if (start_game(&current_session) == -1) {
+            fprintf(stderr, "Error starting the game: %s\n", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        while (loop.running) {
+            run_loop_once();
+        }
+    } else {  // If no execution command is specified, relay between the descriptors
+        // A bidirectional socket is relayed to stdout and fed from stdin; otherwise input goes
+        // to output, output's replies go to stdout and stdin also goes to output
+        struct relay_direction directions[3];
+        int direction_count = 0;
+        int open_directions = 0;
+        if (descriptors[0] == descriptors[1]) {
+            directions[direction_count++] = (struct relay_direction){descriptors[0], STDOUT_FILENO, transports[0],
+                TRANSPORT_STDIO, "input descriptor", "stdout", NULL, &open_directions, &current_session, 0};
+            directions[direction_count++] = (struct relay_direction){STDIN_FILENO, descriptors[1], TRANSPORT_STDIO,
+                transports[1], "stdin", "output descriptor", NULL, &open_directions, &current_session, 0};
+        } else {
+            directions[direction_count++] = (struct relay_direction){descriptors[0], descriptors[1], transports[0],
+                transports[1], "input descriptor", "output descriptor", NULL, &open_directions, &current_session, 0};
+            if (descriptors[1] != STDOUT_FILENO) {
+                directions[direction_count++] = (struct relay_direction){descriptors[1], STDOUT_FILENO,
+                    transports[1], TRANSPORT_STDIO, "output descriptor", "stdout", NULL, &open_directions, &current_session, 0};
+            }
+            if (descriptors[0] != STDIN_FILENO) {
+                directions[direction_count++] = (struct relay_direction){STDIN_FILENO, descriptors[1],
+                    TRANSPORT_STDIO, transports[1], "stdin", "output descriptor", NULL, &open_directions, &current_session, 0};
             }
         }
-        // Redirect output descriptor to standard output if necessary
-        if (descriptors[1] != STDOUT_FILENO) {
-            if (dup2(descriptors[1], STDOUT_FILENO) == -1) {
-                close(descriptors[1]);
-                if (descriptors[0] != STDIN_FILENO) {
-                    close(descriptors[0]);
-                }
-                fprintf(stderr, "failed to duplicating output descriptor: %s\n", strerror(errno));
+
+        // Take one ring buffer per relay direction from the pool
+        for (int i = 0; i < direction_count; i++) {
+            directions[i].ring = buffer_pool_acquire(&relay_pool, relay_buffer_size);
+            relay_coalesce_init(&directions[i]);
+            relay_shm_init(&directions[i]);
+            if (directions[i].ring == NULL) {
+                fprintf(stderr, "Error allocating relay buffers: %s\n", strerror(errno));
                 exit(EXIT_FAILURE);
             }
+            relay_start(&directions[i]);
+            open_directions++;
         }
-        // Execute the command
-        executeCommand(exec_command);
-    } else {  // If no execution command is specified, handle polling events
-        struct pollfd poll_file_descriptors[4];  // Array to store poll file descriptors
-        int num_file_descriptors = 4;  // Number of file descriptors to poll
-
-        // Set up poll descriptors
-        poll_file_descriptors[0].fd = descriptors[0];
-        poll_file_descriptors[0].events = POLLIN;
-
-        poll_file_descriptors[1].fd = descriptors[1];
-        poll_file_descriptors[1].events = POLLIN;
-
-        poll_file_descriptors[2].fd = STDIN_FILENO;
-        poll_file_descriptors[2].events = POLLIN;
-
-        poll_file_descriptors[3].fd = STDOUT_FILENO;
-        poll_file_descriptors[3].events = POLLIN;
+        session_activate(&current_session);
 
         // Polling loop
-        while (1) {
-            int poll_result = poll(poll_file_descriptors, num_file_descriptors, -1);
-            if (poll_result == -1) {
-                fprintf(stderr, "Error polling: %s\n", strerror(errno));
-                exit(EXIT_FAILURE);
-            }
+        while (loop.running) {
+            run_loop_once();
+        }
 
-            // Handle poll events
-            handle_poll_event(poll_file_descriptors, descriptors);
+        for (int i = 0; i < direction_count; i++) {
+            buffer_pool_release(&relay_pool, directions[i].ring);
         }
     }
+    buffer_pool_destroy(&relay_pool);
+    event_loop_destroy(&loop);
 
     // Close descriptors before exiting
     close(descriptors[0]);
@@ -0,0 +1,639 @@
+#include <stdio.h>       // Standard I/O library
+#include <stdlib.h>      // Standard library for general functions
+#include <unistd.h>      // Unix standard functions
+#include <string.h>      // String manipulation functions
+#include <errno.h>       // Error number definitions
+#include <fcntl.h>       // File control options
+#include <signal.h>      // Signal handling
+#include <poll.h>        // Polling for events on file descriptors
+#include <time.h>        // Monotonic clock
+#include <getopt.h>      // Command line option parsing
+#include <sys/types.h>   // Data types for system calls
+#include <sys/socket.h>  // Sockets API
+#include <sys/un.h>      // Unix domain sockets
+#include <sys/wait.h>    // Waiting for process termination
+#include <sys/resource.h>  // CPU time of mync and of the bench
+#include <netinet/in.h>  // Internet domain address structures
+#include <arpa/inet.h>   // Functions for IP address conversion
+#include "shm_ring.h"      // Shared-memory channels for the SHMS-SHMC mode
+
+#define BENCH_WARMUP 100        // Ping-pong messages discarded before measuring
+#define BENCH_WINDOW 64         // Datagrams allowed in flight during the throughput run
+#define BENCH_IDLE_MS 500       // Throughput run gives up after this long without progress
+#define BENCH_MAX_SIZE 65000    // Largest message size (fits in one UDP datagram)
+#define BENCH_GROUP "239.255.77.1"  // Multicast group used by the UDPM mode (administratively scoped)
+
+/**
+ * @brief One benchmarked mync configuration: a server input mode paired with a client output mode.
+ */
+struct bench_mode {
+    const char *name;    // Name used on the command line and in the results
+    const char *input;   // mync -i prefix (the bench connects to it)
+    const char *output;  // mync -o prefix (the bench listens for it)
+    int family;          // AF_INET or AF_UNIX
+    int type;            // SOCK_STREAM or SOCK_DGRAM
+    const char *group;   // Multicast group the output side joins, NULL for unicast
+    int opt_in;          // Only run when named with -m (needs multicast enabled on lo)
+    int shm;             // Shared-memory channels instead of sockets (SHMS/SHMC)
+};
+
+static const struct bench_mode bench_modes[] = {
+    {"TCPS-TCPC", "TCPS", "TCPC", AF_INET, SOCK_STREAM},
+    {"UDPS-UDPC", "UDPS", "UDPC", AF_INET, SOCK_DGRAM},
+    {"UDSSS-UDSCS", "UDSSS", "UDSCS", AF_UNIX, SOCK_STREAM},
+    {"UDSSD-UDSCD", "UDSSD", "UDSCD", AF_UNIX, SOCK_DGRAM},
+    {"UDPS-UDPM", "UDPS", "UDPM", AF_INET, SOCK_DGRAM, BENCH_GROUP, 1},
+    {"SHMS-SHMC", "SHMS", "SHMC", AF_UNIX, SOCK_STREAM, NULL, 0, 1},
+};
+
+struct shm_channel in_channel;   // The bench's end of mync's SHMS input
+struct shm_channel out_channel;  // The bench's end of mync's SHMC output
+
+/**
+ * @brief Results of one mode/message-size run.
+ */
+struct bench_result {
+    size_t messages;    // Messages delivered in the throughput run
+    size_t lost;        // Messages that never arrived (datagram modes only)
+    double seconds;     // Duration of the throughput run
+    double p50_us;      // Median one-way-through-mync round trip
+    double p99_us;      // 99th percentile round trip
+    double p999_us;     // 99.9th percentile round trip
+    double mync_cpu_us;   // mync's user+system CPU time per message relayed
+    double bench_cpu_us;  // The bench's own CPU time per message, sending and receiving
+};
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds.
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Fills a loopback or Unix socket address for the bench endpoints.
+ *
+ * @param mode The mode being benchmarked.
+ * @param port The port for AF_INET modes.
+ * @param path The socket path for AF_UNIX modes.
+ * @param addr The address to fill.
+ * @return socklen_t The address length.
+ */
+static socklen_t make_address(const struct bench_mode *mode, int port, const char *path, struct sockaddr_storage *addr) {
+    memset(addr, 0, sizeof(*addr));
+    if (mode->family == AF_INET) {
+        struct sockaddr_in *in = (struct sockaddr_in *)addr;
+        in->sin_family = AF_INET;
+        in->sin_port = htons(port);
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return sizeof(*in);
+    }
+    struct sockaddr_un *un = (struct sockaddr_un *)addr;
+    un->sun_family = AF_UNIX;
+    snprintf(un->sun_path, sizeof(un->sun_path), "%s", path);
+    return sizeof(*un);
+}
+
+/**
+ * @brief Creates the endpoint mync's output connects to (a listener or a bound datagram socket).
+ */
+static int open_output_peer(const struct bench_mode *mode, int port, const char *path) {
+    if (mode->shm) {
+        int fd = shm_listen(path);
+        if (fd == -1) {
+            perror("bench: listen for shared-memory client");
+            exit(1);
+        }
+        return fd;
+    }
+    struct sockaddr_storage addr;
+    socklen_t len = make_address(mode, port, path, &addr);
+    int fd = socket(mode->family, mode->type, 0);
+    if (fd == -1) {
+        perror("bench: socket");
+        exit(1);
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &(int){1}, sizeof(int));
+    if (mode->family == AF_UNIX) {
+        unlink(path);
+    }
+    if (mode->group != NULL) {
+        ((struct sockaddr_in *)&addr)->sin_addr.s_addr = inet_addr(mode->group);
+    }
+    if (bind(fd, (struct sockaddr *)&addr, len) == -1) {
+        perror("bench: bind output peer");
+        exit(1);
+    }
+    if (mode->group != NULL) {
+        // Join on lo, where mync publishes with if=127.0.0.1
+        struct ip_mreq membership;
+        membership.imr_multiaddr.s_addr = inet_addr(mode->group);
+        membership.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &(int){4 << 20}, sizeof(int));
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) == -1) {
+            perror("bench: join multicast group (is multicast enabled on lo?)");
+            exit(1);
+        }
+    }
+    if (mode->type == SOCK_STREAM && listen(fd, 1) == -1) {
+        perror("bench: listen");
+        exit(1);
+    }
+    return fd;
+}
+
+/**
+ * @brief Forks extra group members that drain the multicast stream, to show what each added subscriber costs.
+ *
+ * @param pids Receives the process ids.
+ */
+static void spawn_subscribers(const struct bench_mode *mode, int port, int count, pid_t *pids) {
+    for (int i = 0; i < count; i++) {
+        int fd = open_output_peer(mode, port, NULL);
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            perror("bench: fork");
+            exit(1);
+        }
+        if (pids[i] == 0) {
+            char buffer[BENCH_MAX_SIZE];
+            while (recv(fd, buffer, sizeof(buffer), 0) >= 0 || errno == EINTR) {
+            }
+            _exit(0);
+        }
+        close(fd);
+    }
+}
+
+/**
+ * @brief Starts mync relaying from the given input to the given output.
+ *
+ * mync's stdin is an idle pipe so that the relay loop does not spin on EOF.
+ *
+ * @param mync The path to the mync executable.
+ * @param input The -i argument.
+ * @param output The -o argument.
+ * @param stdin_pipe Receives the write end of mync's stdin pipe.
+ * @return pid_t The mync process id.
+ */
+static pid_t spawn_mync(const char *mync, const char *input, const char *output, int *stdin_pipe) {
+    int fds[2];
+    if (pipe(fds) == -1) {
+        perror("bench: pipe");
+        exit(1);
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("bench: fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        dup2(fds[0], STDIN_FILENO);
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(mync, mync, "-s", "64K", "-i", input, "-o", output, (char *)NULL);
+        perror("bench: exec mync");
+        _exit(1);
+    }
+    close(fds[0]);
+    *stdin_pipe = fds[1];
+    return pid;
+}
+
+/**
+ * @brief Connects to mync's input endpoint, retrying while mync starts up.
+ */
+static int connect_input(const struct bench_mode *mode, int port, const char *path) {
+    struct sockaddr_storage addr;
+    socklen_t len = make_address(mode, port, path, &addr);
+    for (int attempt = 0; attempt < 200; attempt++) {
+        if (mode->shm) {
+            if (shm_connect(path, &in_channel) == 0) {
+                return in_channel.wake_fd;
+            }
+            close(in_channel.control_fd);
+            usleep(10000);  // mync is not listening yet
+            continue;
+        }
+        int fd = socket(mode->family, mode->type, 0);
+        if (fd == -1) {
+            perror("bench: socket");
+            exit(1);
+        }
+        if (connect(fd, (struct sockaddr *)&addr, len) == 0) {
+            return fd;
+        }
+        close(fd);
+        usleep(10000);  // mync is not listening yet
+    }
+    fprintf(stderr, "bench: could not connect to mync %s\n", mode->input);
+    exit(1);
+}
+
+/**
+ * @brief Waits for a descriptor to become readable.
+ *
+ * @return int 1 if readable, 0 on timeout.
+ */
+static int wait_readable(int fd, int timeout_ms) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    return poll(&pfd, 1, timeout_ms) > 0;
+}
+
+/**
+ * @brief Receives one message of the given size from the output side.
+ *
+ * @return int 1 if the message arrived, 0 on timeout or error.
+ */
+static int receive_message(const struct bench_mode *mode, int fd, char *buffer, size_t size, int timeout_ms) {
+    if (mode->shm) {
+        size_t got = 0;
+        while (got < size) {
+            ssize_t n = shm_read(&out_channel, buffer + got, size - got);
+            if (n == -1 && errno == EAGAIN) {
+                if (!shm_wait(&out_channel, 0, timeout_ms)) {
+                    return 0;
+                }
+                continue;
+            }
+            if (n <= 0) {
+                return 0;
+            }
+            got += n;
+        }
+        return 1;
+    }
+    if (mode->type == SOCK_DGRAM) {
+        if (!wait_readable(fd, timeout_ms)) {
+            return 0;
+        }
+        return recv(fd, buffer, BENCH_MAX_SIZE, 0) > 0;
+    }
+    size_t got = 0;
+    while (got < size) {
+        if (!wait_readable(fd, timeout_ms)) {
+            return 0;
+        }
+        ssize_t n = recv(fd, buffer + got, size - got, 0);
+        if (n <= 0) {
+            return 0;
+        }
+        got += n;
+    }
+    return 1;
+}
+
+/**
+ * @brief Sends datagram probes until one makes it through mync, then drains stragglers.
+ *
+ * For UDPS the first datagram only registers the client and is not relayed,
+ * and for UDSSD the server may not be bound yet, so the path is confirmed end to end.
+ */
+static void prime_datagram_path(int in_fd, int out_fd, char *buffer) {
+    for (int attempt = 0; attempt < 250; attempt++) {
+        send(in_fd, "probe", 5, 0);
+        if (wait_readable(out_fd, 20)) {
+            while (wait_readable(out_fd, 50)) {
+                recv(out_fd, buffer, BENCH_MAX_SIZE, 0);
+            }
+            return;
+        }
+    }
+    fprintf(stderr, "bench: datagram path through mync never came up\n");
+    exit(1);
+}
+
+/**
+ * @brief Orders doubles for qsort.
+ */
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Returns the given percentile of a sorted sample.
+ */
+static double percentile(const double *sorted, size_t count, double fraction) {
+    if (count == 0) {
+        return 0;
+    }
+    size_t index = (size_t)(fraction * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+/**
+ * @brief Measures per-message latency through mync with one message in flight at a time.
+ */
+static void run_latency(const struct bench_mode *mode, int in_fd, int out_fd, char *message, char *buffer,
+                        size_t size, size_t count, struct bench_result *result) {
+    double *samples = malloc(count * sizeof(double));
+    size_t taken = 0;
+    for (size_t i = 0; i < count + BENCH_WARMUP; i++) {
+        long long start = now_ns();
+        if (mode->shm ? shm_write_all(&in_channel, message, size) == -1
+                      : send(in_fd, message, size, MSG_NOSIGNAL) != (ssize_t)size) {
+            perror("bench: send");
+            exit(1);
+        }
+        if (!receive_message(mode, out_fd, buffer, size, 1000)) {
+            if (mode->type == SOCK_STREAM) {
+                fprintf(stderr, "bench: stream stalled during latency run\n");
+                exit(1);
+            }
+            continue;  // Lost datagram: no sample
+        }
+        if (i >= BENCH_WARMUP) {
+            samples[taken++] = (now_ns() - start) / 1000.0;
+        }
+    }
+    qsort(samples, taken, sizeof(double), compare_double);
+    result->p50_us = percentile(samples, taken, 0.50);
+    result->p99_us = percentile(samples, taken, 0.99);
+    result->p999_us = percentile(samples, taken, 0.999);
+    free(samples);
+}
+
+/**
+ * @brief Measures throughput through SHMS/SHMC channels, writing and reading without blocking.
+ *
+ * When neither side can make progress, the bench sleeps until mync has
+ * moved data to the output channel.
+ */
+static void run_shm_throughput(char *message, char *buffer, size_t size, size_t count, struct bench_result *result) {
+    size_t total_bytes = size * count;
+    size_t sent_bytes = 0, received_bytes = 0;
+    long long start = now_ns();
+    while (received_bytes < total_bytes) {
+        int progress = 0;
+        if (sent_bytes < total_bytes) {
+            size_t offset = sent_bytes % size;
+            ssize_t n = shm_write(&in_channel, message + offset, size - offset);
+            if (n > 0) {
+                sent_bytes += n;
+                progress = 1;
+            }
+        }
+        ssize_t n = shm_read(&out_channel, buffer, BENCH_MAX_SIZE);
+        if (n > 0) {
+            received_bytes += n;
+            progress = 1;
+        } else if (n == 0) {
+            break;
+        }
+        if (!progress && !shm_wait(&out_channel, 0, BENCH_IDLE_MS)) {
+            fprintf(stderr, "bench: shared-memory stream stalled during throughput run\n");
+            exit(1);
+        }
+    }
+    result->seconds = (now_ns() - start) / 1e9;
+    result->messages = received_bytes / size;
+    result->lost = 0;
+}
+
+/**
+ * @brief Measures throughput by keeping the relay busy with many messages in flight.
+ */
+static void run_throughput(const struct bench_mode *mode, int in_fd, int out_fd, char *message, char *buffer,
+                           size_t size, size_t count, struct bench_result *result) {
+    if (mode->shm) {
+        run_shm_throughput(message, buffer, size, count, result);
+        return;
+    }
+    int stream = mode->type == SOCK_STREAM;
+    size_t total_bytes = size * count;
+    size_t sent_bytes = 0, received_bytes = 0;
+    size_t sent_msgs = 0, received_msgs = 0, dropped_msgs = 0;
+
+    fcntl(in_fd, F_SETFL, fcntl(in_fd, F_GETFL) | O_NONBLOCK);
+    long long start = now_ns();
+    while (stream ? received_bytes < total_bytes : received_msgs + dropped_msgs < count) {
+        int want_send = stream ? sent_bytes < total_bytes
+                               : sent_msgs < count && sent_msgs - received_msgs - dropped_msgs < BENCH_WINDOW;
+        struct pollfd pfds[2] = {{in_fd, want_send ? POLLOUT : 0, 0}, {out_fd, POLLIN, 0}};
+        if (poll(pfds, 2, BENCH_IDLE_MS) == 0) {
+            if (stream) {
+                fprintf(stderr, "bench: stream stalled during throughput run\n");
+                exit(1);
+            }
+            dropped_msgs = sent_msgs - received_msgs;  // Give up on the lost window and keep sending
+            continue;
+        }
+        if (pfds[0].revents & POLLOUT) {
+            if (stream) {
+                size_t offset = sent_bytes % size;
+                ssize_t n = send(in_fd, message + offset, size - offset, MSG_NOSIGNAL);
+                if (n > 0) {
+                    sent_bytes += n;
+                }
+            } else if (send(in_fd, message, size, 0) == (ssize_t)size) {
+                sent_msgs++;
+            }
+        }
+        if (pfds[1].revents & POLLIN) {
+            ssize_t n = recv(out_fd, buffer, BENCH_MAX_SIZE, MSG_DONTWAIT);
+            if (n > 0) {
+                received_bytes += n;
+                received_msgs++;
+            }
+        }
+    }
+    result->seconds = (now_ns() - start) / 1e9;
+    result->messages = stream ? received_bytes / size : received_msgs;
+    result->lost = stream ? 0 : count - result->messages;
+    fcntl(in_fd, F_SETFL, fcntl(in_fd, F_GETFL) & ~O_NONBLOCK);
+}
+
+/**
+ * @brief Converts a rusage time to microseconds.
+ */
+static double cpu_us(const struct timeval *tv) {
+    return tv->tv_sec * 1e6 + tv->tv_usec;
+}
+
+/**
+ * @brief Runs one mode at one message size against a fresh mync process.
+ */
+static void bench_one(const char *mync, const struct bench_mode *mode, int port, size_t size, size_t count,
+                      int subscribers, struct bench_result *result) {
+    char in_path[96], out_path[96], input[160], output[160];
+    snprintf(in_path, sizeof(in_path), "/tmp/mync_bench_in_%d.sock", port);
+    snprintf(out_path, sizeof(out_path), "/tmp/mync_bench_out_%d.sock", port);
+
+    if (mode->group != NULL) {
+        snprintf(input, sizeof(input), "%s%d", mode->input, port);
+        snprintf(output, sizeof(output), "%s%s,%d,ttl=0,loop=1,if=127.0.0.1", mode->output, mode->group, port + 1);
+    } else if (mode->family == AF_INET) {
+        snprintf(input, sizeof(input), "%s%d", mode->input, port);
+        snprintf(output, sizeof(output), "%s127.0.0.1,%d", mode->output, port + 1);
+    } else {
+        snprintf(input, sizeof(input), "%s%s", mode->input, in_path);
+        snprintf(output, sizeof(output), "%s%s", mode->output, out_path);
+    }
+
+    int peer = open_output_peer(mode, port + 1, out_path);
+    pid_t subscriber_pids[subscribers > 0 ? subscribers : 1];
+    spawn_subscribers(mode, port + 1, subscribers, subscriber_pids);
+    int stdin_pipe;
+    pid_t pid = spawn_mync(mync, input, output, &stdin_pipe);
+
+    int in_fd = connect_input(mode, port, in_path);
+    int out_fd = peer;
+    char *message = malloc(size);
+    char *buffer = malloc(BENCH_MAX_SIZE);
+    memset(message, 'x', size);
+
+    if (mode->type == SOCK_STREAM) {
+        if (!wait_readable(peer, 5000)) {
+            fprintf(stderr, "bench: mync never connected to %s\n", output);
+            exit(1);
+        }
+        if (mode->shm) {
+            if (shm_accept(peer, &out_channel, SHM_RING_SIZE) == -1) {
+                perror("bench: set up shared-memory output");
+                exit(1);
+            }
+            out_fd = out_channel.wake_fd;
+        } else {
+            out_fd = accept(peer, NULL, NULL);
+        }
+    } else {
+        prime_datagram_path(in_fd, out_fd, buffer);
+    }
+
+    struct rusage self_before, self_after, mync_usage;
+    getrusage(RUSAGE_SELF, &self_before);
+    run_latency(mode, in_fd, out_fd, message, buffer, size, count, result);
+    run_throughput(mode, in_fd, out_fd, message, buffer, size, count, result);
+    getrusage(RUSAGE_SELF, &self_after);
+
+    kill(pid, SIGTERM);
+    wait4(pid, NULL, 0, &mync_usage);
+    size_t relayed = count + BENCH_WARMUP + result->messages;  // Both runs; setup is negligible next to them
+    result->mync_cpu_us = (cpu_us(&mync_usage.ru_utime) + cpu_us(&mync_usage.ru_stime)) / relayed;
+    result->bench_cpu_us = (cpu_us(&self_after.ru_utime) - cpu_us(&self_before.ru_utime) +
+                            cpu_us(&self_after.ru_stime) - cpu_us(&self_before.ru_stime)) / relayed;
+    for (int i = 0; i < subscribers; i++) {
+        kill(subscriber_pids[i], SIGTERM);
+        waitpid(subscriber_pids[i], NULL, 0);
+    }
+    close(stdin_pipe);
+    if (mode->shm) {
+        shm_close(&in_channel);
+        shm_close(&out_channel);
+    } else {
+        close(in_fd);
+        if (out_fd != peer) {
+            close(out_fd);
+        }
+    }
+    close(peer);
+    unlink(in_path);
+    unlink(out_path);
+    free(message);
+    free(buffer);
+}
+
+int main(int argc, char *argv[]) {
+    const char *mync = "./mync";      // mync executable under test
+    const char *mode_name = NULL;     // Mode to run, NULL for all
+    char *sizes = "64,1024,16384";    // Comma-separated message sizes
+    size_t count = 2000;              // Messages per measurement
+    int port = 47000;                 // First loopback port to use
+    const char *results = NULL;       // CSV file to append results to
+    int subscribers = 0;              // Extra multicast group members (UDPM mode)
+    int option;
+
+    while ((option = getopt(argc, argv, "x:m:s:n:p:o:g:")) != -1) {
+        switch (option) {
+            case 'x':
+                mync = optarg;
+                break;
+            case 'm':
+                mode_name = optarg;
+                break;
+            case 's':
+                sizes = optarg;
+                break;
+            case 'n':
+                count = strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'o':
+                results = optarg;
+                break;
+            case 'g':
+                subscribers = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-x mync] [-m MODE] [-s sizes] [-n count] [-p port] [-o results.csv] "
+                        "[-g subscribers]\n", argv[0]);
+                fprintf(stderr, "Modes: TCPS-TCPC UDPS-UDPC UDSSS-UDSCS UDSSD-UDSCD SHMS-SHMC UDPS-UDPM (only with -m)\n");
+                exit(1);
+        }
+    }
+
+    FILE *out = stdout;
+    if (results != NULL) {
+        out = fopen(results, "a");
+        if (out == NULL) {
+            perror("bench: open results");
+            exit(1);
+        }
+        if (ftell(out) == 0) {
+            fprintf(out, "mode,msg_size,messages,lost,mb_per_s,msgs_per_s,p50_us,p99_us,p999_us,"
+                    "mync_cpu_us_per_msg,bench_cpu_us_per_msg\n");
+        }
+    }
+
+    int matched = 0;
+    for (size_t m = 0; m < sizeof(bench_modes) / sizeof(bench_modes[0]); m++) {
+        const struct bench_mode *mode = &bench_modes[m];
+        if (mode_name != NULL ? strcmp(mode_name, mode->name) != 0 : mode->opt_in) {
+            continue;
+        }
+        matched = 1;
+        char name[64];  // UDPM rows name the extra subscribers, e.g. UDPS-UDPM+4
+        snprintf(name, sizeof(name), mode->group != NULL && subscribers > 0 ? "%s+%d" : "%s", mode->name,
+                 subscribers);
+
+        char *list = strdup(sizes);
+        for (char *token = strtok(list, ","); token != NULL; token = strtok(NULL, ",")) {
+            size_t size = strtoul(token, NULL, 10);
+            if (size == 0 || size > BENCH_MAX_SIZE) {
+                fprintf(stderr, "bench: message size must be 1..%d\n", BENCH_MAX_SIZE);
+                exit(1);
+            }
+            struct bench_result result = {0};
+            bench_one(mync, mode, port, size, count, mode->group != NULL ? subscribers : 0, &result);
+            port += 2;
+
+            double mb = result.messages * (double)size / (1024.0 * 1024.0);
+            fprintf(out, "%s,%zu,%zu,%zu,%.2f,%.0f,%.1f,%.1f,%.1f,%.2f,%.2f\n", name, size, result.messages,
+                    result.lost, mb / result.seconds, result.messages / result.seconds, result.p50_us,
+                    result.p99_us, result.p999_us, result.mync_cpu_us, result.bench_cpu_us);
+            fflush(out);
+            fprintf(stderr, "%-12s %6zu B  %8.2f MB/s  %9.0f msg/s  p50 %.1f us  p99 %.1f us  p999 %.1f us  "
+                    "cpu/msg mync %.2f us bench %.2f us\n", name, size, mb / result.seconds,
+                    result.messages / result.seconds, result.p50_us, result.p99_us, result.p999_us,
+                    result.mync_cpu_us, result.bench_cpu_us);
+        }
+        free(list);
+    }
+
+    if (!matched) {
+        fprintf(stderr, "bench: unknown mode %s\n", mode_name);
+        exit(1);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+/*
+ * Statically defined tracepoints (USDT) for perf and bpftrace, e.g.
+ *   perf probe -x ./mync sdt_mync:relay_read && perf record -e sdt_mync:relay_read -p PID
+ *   bpftrace -e 'usdt:./ttt:ttt:game_end { @[arg0] = count(); }'
+ *
+ * A probe compiles to one nop plus an ELF note (.note.stapsdt) naming it
+ * and describing where its arguments live, so it costs nothing until a
+ * tracer patches the nop. SystemTap's <sys/sdt.h> is used when installed;
+ * otherwise the same note format is emitted here (x86-64 only, as for
+ * coroutine.c). Arguments must be integers; cast pointers to long.
+ */
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PROBES_HAVE_SDT 1
+#endif
+#endif
+
+#if defined(PROBES_HAVE_SDT)
+
+#define PROBE0(provider, name) DTRACE_PROBE(provider, name)
+#define PROBE1(provider, name, a1) DTRACE_PROBE1(provider, name, a1)
+#define PROBE2(provider, name, a1, a2) DTRACE_PROBE2(provider, name, a1, a2)
+#define PROBE3(provider, name, a1, a2, a3) DTRACE_PROBE3(provider, name, a1, a2, a3)
+
+#elif defined(__x86_64__) && defined(__GNUC__)
+
+// Argument size as the note encodes it: negative for signed types (printed negated by %n)
+#define PROBE_ARG_SIZE(x) ((((__typeof__(x))-1) < 0 ? 1 : -1) * (int)sizeof(x))
+#define PROBE_OPERAND(n, x) [size##n] "n" (PROBE_ARG_SIZE(x)), [arg##n] "nor" (x)
+
+// The note: the nop's address, the base used to relocate it, no semaphore, then provider, name and arguments
+#define PROBE_ASM(provider, name, args, ...)                                              \
+    __asm__ __volatile__(                                                                 \
+        "990: nop\n"                                                                      \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                     \
+        ".balign 4\n"                                                                     \
+        ".4byte 992f-991f, 994f-993f, 3\n"                                                \
+        "991: .asciz \"stapsdt\"\n"                                                       \
+        "992: .balign 4\n"                                                                \
+        "993: .8byte 990b\n"                                                              \
+        ".8byte _.stapsdt.base\n"                                                         \
+        ".8byte 0\n"                                                                      \
+        ".asciz \"" #provider "\"\n"                                                      \
+        ".asciz \"" #name "\"\n"                                                          \
+        ".asciz \"" args "\"\n"                                                           \
+        "994: .balign 4\n"                                                                \
+        ".popsection\n"                                                                   \
+        ".ifndef _.stapsdt.base\n"                                                        \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"           \
+        ".weak _.stapsdt.base\n"                                                          \
+        ".hidden _.stapsdt.base\n"                                                        \
+        "_.stapsdt.base: .space 1\n"                                                      \
+        ".size _.stapsdt.base, 1\n"                                                       \
+        ".popsection\n"                                                                   \
+        ".endif\n"                                                                        \
+        :: __VA_ARGS__)
+
+#define PROBE0(provider, name) PROBE_ASM(provider, name, "")
+#define PROBE1(provider, name, a1) \
+    PROBE_ASM(provider, name, "%n[size1]@%[arg1]", PROBE_OPERAND(1, a1))
+#define PROBE2(provider, name, a1, a2) \
+    PROBE_ASM(provider, name, "%n[size1]@%[arg1] %n[size2]@%[arg2]", PROBE_OPERAND(1, a1), PROBE_OPERAND(2, a2))
+#define PROBE3(provider, name, a1, a2, a3)                                                                       \
+    PROBE_ASM(provider, name, "%n[size1]@%[arg1] %n[size2]@%[arg2] %n[size3]@%[arg3]", PROBE_OPERAND(1, a1), \
+              PROBE_OPERAND(2, a2), PROBE_OPERAND(3, a3))
+
+#else
+
+#define PROBE0(provider, name) do { } while (0)
+#define PROBE1(provider, name, a1) do { (void)(a1); } while (0)
+#define PROBE2(provider, name, a1, a2) do { (void)(a1); (void)(a2); } while (0)
+#define PROBE3(provider, name, a1, a2, a3) do { (void)(a1); (void)(a2); (void)(a3); } while (0)
+
+#endif
+
+#endif
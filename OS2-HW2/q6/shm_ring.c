@@ -0,0 +1,483 @@
+#define _GNU_SOURCE  // memfd_create(), F_ADD_SEALS
+#include <stdio.h>         // Error messages
+#include <stdlib.h>        // exit()
+#include <string.h>        // memcpy()
+#include <stdint.h>        // uint64_t eventfd counters
+#include <unistd.h>        // close(), ftruncate()
+#include <errno.h>         // Error number definitions
+#include <fcntl.h>         // Memfd seals
+#include <poll.h>          // Sleeping on the eventfd
+#include <time.h>          // Monotonic clock for the spin budget
+#include <sys/mman.h>      // memfd_create(), mmap()
+#include <sys/socket.h>    // SCM_RIGHTS
+#include <sys/un.h>        // Unix domain sockets
+#include <sys/eventfd.h>   // Wakeups
+#include "shm_ring.h"
+
+#define SHM_MAGIC 0x6d796e63u  // "mync", sent with the descriptors
+
+#if defined(__x86_64__) || defined(__i386__)
+#define shm_cpu_relax() __builtin_ia32_pause()
+#else
+#define shm_cpu_relax() atomic_signal_fence(memory_order_seq_cst)
+#endif
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds.
+ */
+static long long shm_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Returns the initial spin budget: none on a single CPU, where the peer cannot run while we spin.
+ */
+static long shm_initial_spin(void) {
+    return sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SHM_SPIN_MAX_NS / 4 : 0;
+}
+
+/**
+ * @brief Wakes whoever sleeps on an eventfd.
+ */
+static void shm_signal(int fd) {
+    uint64_t one = 1;
+    while (write(fd, &one, sizeof(one)) == -1 && errno == EINTR) {
+    }
+}
+
+static int shm_ready(struct shm_channel *channel, int for_write);
+
+/**
+ * @brief Points the channel's rings into its mapping; ring 0 carries server-to-client data.
+ *
+ * Our reader_sleeping flag starts set, so the peer signals wake_fd for the
+ * first data and an event loop polling it needs no other arming.
+ */
+static void shm_attach_rings(struct shm_channel *channel, int server) {
+    struct shm_ring *rings[2];
+    rings[0] = channel->map;
+    rings[1] = (struct shm_ring *)((char *)channel->map + sizeof(struct shm_ring) + channel->capacity);
+    channel->tx = rings[server ? 0 : 1];
+    channel->rx = rings[server ? 1 : 0];
+    channel->peer_gone = 0;
+    channel->spin_ns = shm_initial_spin();
+    atomic_store_explicit(&channel->rx->reader_sleeping, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (shm_ready(channel, 0)) {
+        shm_signal(channel->wake_fd);  // The peer wrote before we set the flag
+    }
+}
+
+/**
+ * @brief Creates the Unix stream socket clients connect to for a channel.
+ *
+ * @param path The socket path.
+ * @return int The listening socket, or -1 on error (errno is set).
+ */
+int shm_listen(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(addr.sun_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(fd, 16) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Accepts a client and sets up a channel with it.
+ *
+ * Creates the sealed memfd holding both rings and one eventfd per side,
+ * then passes them to the client with SCM_RIGHTS.
+ *
+ * @param listen_fd A socket from shm_listen(); the call blocks until a client connects.
+ * @param channel The server's end of the channel.
+ * @param capacity Bytes per ring, a power of two.
+ * @return int 0 on success, -1 on error (errno is set).
+ */
+int shm_accept(int listen_fd, struct shm_channel *channel, size_t capacity) {
+    channel->control_fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (channel->control_fd == -1) {
+        return -1;
+    }
+    channel->capacity = capacity;
+    channel->map_size = 2 * (sizeof(struct shm_ring) + capacity);
+    int memfd = memfd_create("mync-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd == -1 || ftruncate(memfd, channel->map_size) == -1 ||
+        fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1) {
+        return -1;  // Sealed so a client cannot shrink the file under us and cause SIGBUS
+    }
+    channel->map = mmap(NULL, channel->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (channel->map == MAP_FAILED) {
+        return -1;
+    }
+    channel->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    channel->peer_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (channel->wake_fd == -1 || channel->peer_wake_fd == -1) {
+        return -1;
+    }
+    shm_attach_rings(channel, 1);
+
+    // Send the capacity with the memfd and both eventfds (the client's own first)
+    unsigned int header[2] = {SHM_MAGIC, (unsigned int)capacity};
+    struct iovec iov = {header, sizeof(header)};
+    int fds[3] = {memfd, channel->peer_wake_fd, channel->wake_fd};
+    char control[CMSG_SPACE(sizeof(fds))];
+    memset(control, 0, sizeof(control));
+    struct msghdr message = {0};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    int sent = sendmsg(channel->control_fd, &message, MSG_NOSIGNAL) == sizeof(header) ? 0 : -1;
+    close(memfd);  // The mapping keeps the memory alive
+    return sent;
+}
+
+/**
+ * @brief Connects to a channel server and maps the rings it passes back.
+ *
+ * @param path The server's socket path.
+ * @param channel The client's end of the channel.
+ * @return int 0 on success, -1 on error (errno is set).
+ */
+int shm_connect(const char *path, struct shm_channel *channel) {
+    channel->control_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (channel->control_fd == -1) {
+        return -1;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(channel->control_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        return -1;
+    }
+
+    unsigned int header[2];
+    struct iovec iov = {header, sizeof(header)};
+    int fds[3];
+    char control[CMSG_SPACE(sizeof(fds))];
+    struct msghdr message = {0};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (recvmsg(channel->control_fd, &message, MSG_CMSG_CLOEXEC) != sizeof(header) || header[0] != SHM_MAGIC) {
+        errno = EPROTO;
+        return -1;
+    }
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        errno = EPROTO;
+        return -1;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    channel->capacity = header[1];
+    channel->map_size = 2 * (sizeof(struct shm_ring) + channel->capacity);
+    channel->map = mmap(NULL, channel->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    close(fds[0]);
+    if (channel->map == MAP_FAILED) {
+        return -1;
+    }
+    channel->wake_fd = fds[1];
+    channel->peer_wake_fd = fds[2];
+    shm_attach_rings(channel, 0);
+    return 0;
+}
+
+/**
+ * @brief Reads what the peer has written, without blocking.
+ *
+ * @return ssize_t Bytes read; 0 at end of stream (the peer shut down or went away);
+ *         -1 with errno EAGAIN when the ring is empty.
+ */
+ssize_t shm_read(struct shm_channel *channel, void *buffer, size_t length) {
+    struct shm_ring *ring = channel->rx;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (tail == head) {
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire) || channel->peer_gone) {
+            return 0;
+        }
+        errno = EAGAIN;
+        return -1;
+    }
+    size_t n = tail - head < length ? tail - head : length;
+    size_t offset = head & (channel->capacity - 1);
+    size_t first = channel->capacity - offset < n ? channel->capacity - offset : n;
+    memcpy(buffer, ring->data + offset, first);
+    memcpy((char *)buffer + first, ring->data, n - first);
+    atomic_store_explicit(&ring->head, head + n, memory_order_release);
+
+    // Pairs with the fence in shm_wait(): either the writer sees the space or we see it sleeping
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->writer_sleeping, memory_order_relaxed)) {
+        shm_signal(channel->peer_wake_fd);
+    }
+    return n;
+}
+
+/**
+ * @brief Writes as much as fits in the peer's ring, without blocking.
+ *
+ * @return ssize_t Bytes written; -1 with errno EAGAIN when the ring is full,
+ *         or EPIPE when the peer has gone away.
+ */
+ssize_t shm_write(struct shm_channel *channel, const void *buffer, size_t length) {
+    if (channel->peer_gone) {
+        errno = EPIPE;
+        return -1;
+    }
+    struct shm_ring *ring = channel->tx;
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t space = channel->capacity - (tail - head);
+    if (space == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    size_t n = space < length ? space : length;
+    size_t offset = tail & (channel->capacity - 1);
+    size_t first = channel->capacity - offset < n ? channel->capacity - offset : n;
+    memcpy(ring->data + offset, buffer, first);
+    memcpy(ring->data, (const char *)buffer + first, n - first);
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->reader_sleeping, memory_order_relaxed)) {
+        shm_signal(channel->peer_wake_fd);
+    }
+    return n;
+}
+
+/**
+ * @brief Returns whether a read (or, with for_write, a write) would make progress.
+ */
+static int shm_ready(struct shm_channel *channel, int for_write) {
+    if (channel->peer_gone) {
+        return 1;
+    }
+    if (for_write) {
+        struct shm_ring *ring = channel->tx;
+        return atomic_load_explicit(&ring->tail, memory_order_relaxed) -
+               atomic_load_explicit(&ring->head, memory_order_acquire) < channel->capacity;
+    }
+    struct shm_ring *ring = channel->rx;
+    return atomic_load_explicit(&ring->tail, memory_order_acquire) !=
+               atomic_load_explicit(&ring->head, memory_order_relaxed) ||
+           atomic_load_explicit(&ring->closed, memory_order_acquire);
+}
+
+/**
+ * @brief Empties our eventfd's counter.
+ */
+static void shm_clear_wakeup(struct shm_channel *channel) {
+    uint64_t count;
+    if (read(channel->wake_fd, &count, sizeof(count)) == -1) {
+        // EAGAIN: nothing was pending
+    }
+}
+
+/**
+ * @brief Reads from the channel into a scatter list when its eventfd is registered with an event loop.
+ *
+ * The reader_sleeping flag is cleared while reading, so a peer writing in
+ * the meantime does not signal; it is set again before returning, and if
+ * data arrived in between the eventfd is signalled so the loop comes back.
+ * So is a wakeup meant for a writer waiting on the same eventfd.
+ *
+ * @param channel The channel.
+ * @param iov Buffers filled in order, e.g. the two free spans of a ring buffer.
+ * @param iovcnt Number of buffers.
+ * @return ssize_t As shm_read().
+ */
+ssize_t shm_read_event(struct shm_channel *channel, const struct iovec *iov, int iovcnt) {
+    shm_clear_wakeup(channel);
+    atomic_store_explicit(&channel->rx->reader_sleeping, 0, memory_order_relaxed);
+    ssize_t n = shm_read(channel, iov[0].iov_base, iov[0].iov_len);
+    for (int i = 1; i < iovcnt && n == (ssize_t)iov[i - 1].iov_len; i++) {
+        ssize_t more = shm_read(channel, iov[i].iov_base, iov[i].iov_len);
+        if (more <= 0) {
+            break;  // Report what the earlier buffers got; EOF shows on the next call
+        }
+        n += more;
+    }
+    atomic_store_explicit(&channel->rx->reader_sleeping, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if ((n != 0 && shm_ready(channel, 0)) ||
+        (atomic_load_explicit(&channel->tx->writer_sleeping, memory_order_relaxed) && shm_ready(channel, 1))) {
+        shm_signal(channel->wake_fd);  // More is waiting, or a writer is; make the loop call us again
+    }
+    return n;
+}
+
+/**
+ * @brief Asks for a wakeup on wake_fd once the peer frees space in tx, for a writer in an event loop.
+ *
+ * Sets the writer_sleeping flag, so the peer signals when it reads; if
+ * space appeared in the meantime, wake_fd is signalled straight away.
+ *
+ * @param channel The channel.
+ */
+void shm_write_event_arm(struct shm_channel *channel) {
+    atomic_store_explicit(&channel->tx->writer_sleeping, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (shm_ready(channel, 1)) {
+        shm_signal(channel->wake_fd);
+    }
+}
+
+/**
+ * @brief Ends a wait armed with shm_write_event_arm() once wake_fd has been readable.
+ *
+ * Clears the wakeup and the writer_sleeping flag; a wakeup that was meant
+ * for a reader polling the same eventfd is handed back.
+ *
+ * @param channel The channel.
+ */
+void shm_write_event_done(struct shm_channel *channel) {
+    shm_clear_wakeup(channel);
+    atomic_store_explicit(&channel->tx->writer_sleeping, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&channel->rx->reader_sleeping, memory_order_relaxed) && shm_ready(channel, 0)) {
+        shm_signal(channel->wake_fd);
+    }
+}
+
+/**
+ * @brief Tells the peer whether to signal wake_fd for data, for a reader in an event loop.
+ *
+ * A reader that stops polling stops being signalled, so its wakeups are not
+ * handed back and forth; when it starts again, data already waiting
+ * signals wake_fd straight away.
+ *
+ * @param channel The channel.
+ * @param watching Whether the reader polls wake_fd.
+ */
+void shm_read_event_watch(struct shm_channel *channel, int watching) {
+    atomic_store_explicit(&channel->rx->reader_sleeping, watching, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (watching && shm_ready(channel, 0)) {
+        shm_signal(channel->wake_fd);
+    }
+}
+
+/**
+ * @brief Waits until the channel can be read (or written, with for_write).
+ *
+ * Spins first, for an adaptive budget that doubles when spinning pays off
+ * and halves when it does not, then sets the sleeping flag and blocks on
+ * the eventfd. The control connection is watched too, so a peer that
+ * exits without shutting down ends the wait.
+ *
+ * @param channel The channel.
+ * @param for_write Wait for space in tx instead of data in rx.
+ * @param timeout_ms Longest sleep, or -1 to wait indefinitely.
+ * @return int 1 if ready, 0 on timeout.
+ */
+int shm_wait(struct shm_channel *channel, int for_write, int timeout_ms) {
+    if (channel->spin_ns > 0) {
+        long long deadline = shm_clock_ns() + channel->spin_ns;
+        do {
+            if (shm_ready(channel, for_write)) {
+                channel->spin_ns = channel->spin_ns * 2 > SHM_SPIN_MAX_NS ? SHM_SPIN_MAX_NS : channel->spin_ns * 2;
+                return 1;
+            }
+            shm_cpu_relax();
+        } while (shm_clock_ns() < deadline);
+        channel->spin_ns = channel->spin_ns / 2 < SHM_SPIN_MIN_NS ? SHM_SPIN_MIN_NS : channel->spin_ns / 2;
+    }
+
+    _Atomic int *sleeping = for_write ? &channel->tx->writer_sleeping : &channel->rx->reader_sleeping;
+    atomic_store_explicit(sleeping, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int ready = shm_ready(channel, for_write);
+    while (!ready) {
+        struct pollfd pfds[2] = {{channel->wake_fd, POLLIN, 0}, {channel->control_fd, POLLIN, 0}};
+        int polled = poll(pfds, 2, timeout_ms);
+        if (polled == -1 && errno == EINTR) {
+            continue;
+        }
+        if (polled <= 0) {
+            break;
+        }
+        if (pfds[1].revents) {
+            shm_peer_hangup(channel);  // The control connection only ever closes
+        }
+        shm_clear_wakeup(channel);
+        ready = shm_ready(channel, for_write);
+    }
+    atomic_store_explicit(sleeping, 0, memory_order_relaxed);
+
+    // Waiting for space may have consumed a wakeup meant for data; hand it back
+    if (for_write && shm_ready(channel, 0)) {
+        shm_signal(channel->wake_fd);
+    }
+    return ready;
+}
+
+/**
+ * @brief Writes all of a buffer, waiting for space as needed.
+ *
+ * @return int 0 on success, -1 with errno EPIPE if the peer went away.
+ */
+int shm_write_all(struct shm_channel *channel, const void *buffer, size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = shm_write(channel, (const char *)buffer + written, length - written);
+        if (n == -1 && errno == EAGAIN) {
+            shm_wait(channel, 1, -1);
+            continue;
+        }
+        if (n == -1) {
+            return -1;
+        }
+        written += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Records that the control connection hung up: reads drain what is left, then see end of stream.
+ *
+ * Event loops call this when the control descriptor becomes readable.
+ */
+void shm_peer_hangup(struct shm_channel *channel) {
+    channel->peer_gone = 1;
+    shm_signal(channel->wake_fd);  // Let a loop waiting on wake_fd notice
+}
+
+/**
+ * @brief Ends our direction of the channel: the peer reads what is left, then end of stream.
+ */
+void shm_shutdown(struct shm_channel *channel) {
+    atomic_store_explicit(&channel->tx->closed, 1, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+    shm_signal(channel->peer_wake_fd);
+}
+
+/**
+ * @brief Shuts down our direction and releases the mapping and descriptors.
+ */
+void shm_close(struct shm_channel *channel) {
+    shm_shutdown(channel);
+    munmap(channel->map, channel->map_size);
+    close(channel->wake_fd);
+    close(channel->peer_wake_fd);
+    close(channel->control_fd);
+}
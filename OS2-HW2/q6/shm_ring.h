@@ -0,0 +1,65 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stddef.h>     // size_t
+#include <stdatomic.h>  // Ring indices shared between processes
+#include <sys/types.h>  // ssize_t
+#include <sys/uio.h>    // struct iovec
+
+#define SHM_RING_SIZE (64 * 1024)  // Bytes per direction, a power of two
+#define SHM_SPIN_MIN_NS 1000       // Floor of the adaptive spin on machines with several CPUs
+#define SHM_SPIN_MAX_NS 50000      // Longest spin before sleeping on the eventfd
+#define SHM_CACHE_LINE 64          // Keeps the producer's and consumer's fields apart
+
+/**
+ * @brief One direction of a channel: a single-producer/single-consumer byte ring in shared memory.
+ *
+ * head and tail are free-running counters; the used region is [head, tail).
+ * Each side sets its sleeping flag before blocking on its eventfd, and the
+ * other side only signals (a syscall) when it sees that flag set.
+ */
+struct shm_ring {
+    _Atomic size_t tail __attribute__((aligned(SHM_CACHE_LINE)));  // Bytes produced
+    _Atomic int writer_sleeping;  // The producer is waiting for space
+    _Atomic int closed;           // The producer will write no more
+    _Atomic size_t head __attribute__((aligned(SHM_CACHE_LINE)));  // Bytes consumed
+    _Atomic int reader_sleeping;  // The consumer is waiting for data
+    char data[] __attribute__((aligned(SHM_CACHE_LINE)));          // The ring's bytes
+};
+
+/**
+ * @brief One end of a shared-memory channel: a ring to read, a ring to write and the wakeup descriptors.
+ *
+ * The memfd, both eventfds and the capacity are passed from the server to
+ * the client over a Unix stream socket, which stays open as the control
+ * connection: it hangs up when the peer exits, even if it crashed.
+ */
+struct shm_channel {
+    struct shm_ring *rx;  // Ring this end consumes
+    struct shm_ring *tx;  // Ring this end produces into
+    size_t capacity;      // Bytes per ring
+    void *map;            // The shared mapping
+    size_t map_size;      // Size of map
+    int wake_fd;          // Our eventfd: the peer signals it when rx has data or tx has space
+    int peer_wake_fd;     // The peer's eventfd
+    int control_fd;       // Unix socket the channel was set up over
+    int peer_gone;        // The control connection hung up
+    long spin_ns;         // Current adaptive spin budget, 0 on a single CPU
+};
+
+int shm_listen(const char *path);
+int shm_accept(int listen_fd, struct shm_channel *channel, size_t capacity);
+int shm_connect(const char *path, struct shm_channel *channel);
+ssize_t shm_read(struct shm_channel *channel, void *buffer, size_t length);
+ssize_t shm_write(struct shm_channel *channel, const void *buffer, size_t length);
+ssize_t shm_read_event(struct shm_channel *channel, const struct iovec *iov, int iovcnt);
+void shm_write_event_arm(struct shm_channel *channel);
+void shm_write_event_done(struct shm_channel *channel);
+void shm_read_event_watch(struct shm_channel *channel, int watching);
+int shm_write_all(struct shm_channel *channel, const void *buffer, size_t length);
+int shm_wait(struct shm_channel *channel, int for_write, int timeout_ms);
+void shm_peer_hangup(struct shm_channel *channel);
+void shm_shutdown(struct shm_channel *channel);
+void shm_close(struct shm_channel *channel);
+
+#endif
@@ -0,0 +1,210 @@
+#define _GNU_SOURCE  // pipe2()
+#include <stdio.h>       // Standard I/O library
+#include <stdlib.h>      // Standard library for general functions
+#include <unistd.h>      // Unix standard functions
+#include <string.h>      // String manipulation functions
+#include <errno.h>       // Error number definitions
+#include <fcntl.h>       // File control options
+#include <spawn.h>       // posix_spawnp()
+#include <time.h>        // Monotonic clock
+#include <getopt.h>      // Command line option parsing
+#include <sys/wait.h>    // Waiting for process termination
+
+#define SPAWN_WARMUP 10  // Spawns discarded before measuring each method
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds.
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Orders doubles for qsort.
+ */
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Returns the given percentile of a sorted sample.
+ */
+static double percentile(const double *sorted, size_t count, double fraction) {
+    if (count == 0) {
+        return 0;
+    }
+    size_t index = (size_t)(fraction * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+/**
+ * @brief Starts the command the way mync did before posix_spawn: fork(), dup2() and execvp().
+ *
+ * Returns once the child has exec'd, detected through a close-on-exec pipe,
+ * so both methods are timed up to the same point.
+ */
+static pid_t spawn_fork(char *const argv[], int null_fd) {
+    int exec_pipe[2];
+    if (pipe2(exec_pipe, O_CLOEXEC) == -1) {
+        perror("spawn_bench: pipe");
+        exit(1);
+    }
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("spawn_bench: fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    close(exec_pipe[1]);
+    char byte;
+    while (read(exec_pipe[0], &byte, 1) == -1 && errno == EINTR) {
+    }
+    close(exec_pipe[0]);
+    return pid;
+}
+
+/**
+ * @brief Starts the command the way mync does now: posix_spawnp() with dup2 file actions.
+ */
+static pid_t spawn_posix(char *const argv[], int null_fd) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, null_fd, STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, null_fd, STDOUT_FILENO);
+    pid_t pid;
+    int error = posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) {
+        fprintf(stderr, "spawn_bench: posix_spawnp: %s\n", strerror(error));
+        exit(1);
+    }
+    return pid;
+}
+
+/**
+ * @brief Times count spawns with one method and writes p50/p99/mean in microseconds.
+ *
+ * Children are reaped outside the timed region.
+ */
+static void bench_method(pid_t (*spawn)(char *const[], int), char *const argv[], int null_fd, size_t count,
+                         double *samples, double *p50, double *p99, double *mean) {
+    double sum = 0;
+    for (size_t i = 0; i < count + SPAWN_WARMUP; i++) {
+        long long start = now_ns();
+        pid_t pid = spawn(argv, null_fd);
+        long long elapsed = now_ns() - start;
+        waitpid(pid, NULL, 0);
+        if (i >= SPAWN_WARMUP) {
+            samples[i - SPAWN_WARMUP] = elapsed / 1000.0;
+            sum += elapsed / 1000.0;
+        }
+    }
+    qsort(samples, count, sizeof(double), compare_double);
+    *p50 = percentile(samples, count, 0.50);
+    *p99 = percentile(samples, count, 0.99);
+    *mean = sum / count;
+}
+
+int main(int argc, char *argv[]) {
+    char *command = "/bin/true";   // Command spawned; its argv is parsed once
+    char *sizes = "0,64,256,1024"; // Comma-separated parent RSS targets in MB
+    size_t count = 200;            // Spawns per method and size
+    const char *results = NULL;    // CSV file to append results to
+    int option;
+
+    while ((option = getopt(argc, argv, "x:r:n:o:")) != -1) {
+        switch (option) {
+            case 'x':
+                command = optarg;
+                break;
+            case 'r':
+                sizes = optarg;
+                break;
+            case 'n':
+                count = strtoul(optarg, NULL, 10);
+                break;
+            case 'o':
+                results = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-x command] [-r rss_mb,...] [-n count] [-o results.csv]\n", argv[0]);
+                exit(1);
+        }
+    }
+    if (count == 0) {
+        fprintf(stderr, "spawn_bench: count must be positive\n");
+        exit(1);
+    }
+
+    // Parse the command once, as mync does with -e
+    char *spawn_argv[64];
+    int n = 0;
+    for (char *token = strtok(strdup(command), " "); token != NULL && n < 63; token = strtok(NULL, " ")) {
+        spawn_argv[n++] = token;
+    }
+    spawn_argv[n] = NULL;
+
+    int null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    if (null_fd == -1) {
+        perror("spawn_bench: open /dev/null");
+        exit(1);
+    }
+
+    FILE *out = stdout;
+    if (results != NULL) {
+        out = fopen(results, "a");
+        if (out == NULL) {
+            perror("spawn_bench: open results");
+            exit(1);
+        }
+    }
+    if (ftell(out) <= 0) {
+        fprintf(out, "method,rss_mb,spawns,p50_us,p99_us,mean_us\n");
+    }
+
+    double *samples = malloc(count * sizeof(double));
+    if (samples == NULL) {
+        perror("spawn_bench: malloc");
+        exit(1);
+    }
+
+    // Grow the parent's resident set step by step; touched pages must be copied into fork()'s page tables
+    size_t resident_mb = 0;
+    char *list = strdup(sizes);
+    for (char *token = strtok(list, ","); token != NULL; token = strtok(NULL, ",")) {
+        size_t target_mb = strtoul(token, NULL, 10);
+        if (target_mb > resident_mb) {
+            size_t grow = (target_mb - resident_mb) * 1024 * 1024;
+            char *ballast = malloc(grow);
+            if (ballast == NULL) {
+                perror("spawn_bench: ballast");
+                exit(1);
+            }
+            memset(ballast, 1, grow);  // Kept for the life of the process
+            resident_mb = target_mb;
+        }
+
+        const char *names[] = {"fork_execvp", "posix_spawn"};
+        pid_t (*methods[])(char *const[], int) = {spawn_fork, spawn_posix};
+        for (int m = 0; m < 2; m++) {
+            double p50, p99, mean;
+            bench_method(methods[m], spawn_argv, null_fd, count, samples, &p50, &p99, &mean);
+            fprintf(out, "%s,%zu,%zu,%.1f,%.1f,%.1f\n", names[m], resident_mb, count, p50, p99, mean);
+            fflush(out);
+            fprintf(stderr, "%-12s rss %5zu MB  p50 %8.1f us  p99 %8.1f us  mean %8.1f us\n", names[m],
+                    resident_mb, p50, p99, mean);
+        }
+    }
+    free(list);
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include <stdio.h>          // Error messages
+#include <stdlib.h>         // exit()
+#include <stdint.h>         // uint64_t
+#include <unistd.h>         // read()
+#include <time.h>           // Monotonic clock
+#include <sys/timerfd.h>    // timerfd_create() and friends
+#include "timer_wheel.h"
+
+/**
+ * @brief Returns the monotonic clock in milliseconds.
+ */
+static long long wheel_clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Returns the tick the wall clock is currently in.
+ */
+static unsigned long long wheel_current_tick(const struct timer_wheel *wheel) {
+    return (unsigned long long)(wheel_clock_ms() - wheel->start_ms) / wheel->tick_ms;
+}
+
+/**
+ * @brief Empties a slot list (the head is a sentinel pointing at itself).
+ */
+static void slot_reset(struct timer *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+/**
+ * @brief Appends a timer to a slot list.
+ */
+static void slot_append(struct timer *head, struct timer *timer) {
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+/**
+ * @brief Places a pending timer in the level and slot matching its distance from now.
+ */
+static void wheel_place(struct timer_wheel *wheel, struct timer *timer) {
+    unsigned long long expires = timer->expires < wheel->now ? wheel->now : timer->expires;
+    unsigned long long delta = expires - wheel->now;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    if (delta >= (1ULL << (WHEEL_BITS * WHEEL_LEVELS))) {
+        expires = wheel->now + (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;  // Clamp to the wheel's range
+    }
+    int slot = (int)((expires >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+    slot_append(&wheel->slots[level][slot], timer);
+}
+
+/**
+ * @brief Re-places every timer of a higher-level slot into the levels below it.
+ *
+ * @return int The slot index, so the caller knows whether the next level also wrapped.
+ */
+static int wheel_cascade(struct timer_wheel *wheel, int level) {
+    int slot = (int)((wheel->now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+    struct timer *head = &wheel->slots[level][slot];
+    struct timer *timer = head->next;
+    slot_reset(head);
+    while (timer != head) {
+        struct timer *next = timer->next;
+        wheel_place(wheel, timer);
+        timer = next;
+    }
+    return slot;
+}
+
+/**
+ * @brief Arms the timerfd for the next tick that can have work, or disarms it when the wheel is empty.
+ *
+ * Only level 0 is scanned; if it is empty the wheel wakes at the next cascade point.
+ */
+static void wheel_rearm(struct timer_wheel *wheel) {
+    struct itimerspec spec = {{0, 0}, {0, 0}};
+    if (wheel->pending > 0) {
+        unsigned long long wake = wheel->now | (WHEEL_SLOTS - 1);  // Last tick before the next cascade
+        wake++;
+        for (unsigned long long tick = wheel->now; tick < wake; tick++) {
+            struct timer *head = &wheel->slots[0][tick & (WHEEL_SLOTS - 1)];
+            if (head->next != head) {
+                wake = tick;
+                break;
+            }
+        }
+        long long wake_ms = wheel->start_ms + (long long)wake * wheel->tick_ms;
+        spec.it_value.tv_sec = wake_ms / 1000;
+        spec.it_value.tv_nsec = (wake_ms % 1000) * 1000000 + 1;  // Non-zero even for tick 0
+    }
+    timerfd_settime(wheel->timerfd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+/**
+ * @brief Runs every tick up to the current time, cascading and firing timers.
+ */
+static void wheel_advance(struct timer_wheel *wheel) {
+    unsigned long long target = wheel_current_tick(wheel);
+    while (wheel->now <= target) {
+        int index = (int)(wheel->now & (WHEEL_SLOTS - 1));
+        // When level 0 wraps, pull the next slot of each higher level down (stopping at the first that did not wrap)
+        if (index == 0) {
+            for (int level = 1; level < WHEEL_LEVELS && wheel_cascade(wheel, level) == 0; level++) {
+            }
+        }
+        wheel->now++;
+
+        // Detach the due list first so callbacks can safely re-arm timers
+        struct timer due;
+        struct timer *head = &wheel->slots[0][index];
+        if (head->next == head) {
+            continue;
+        }
+        due.next = head->next;
+        due.prev = head->prev;
+        due.next->prev = &due;
+        due.prev->next = &due;
+        slot_reset(head);
+        while (due.next != &due) {
+            struct timer *timer = due.next;
+            due.next = timer->next;
+            timer->next->prev = &due;
+            timer->pending = 0;
+            wheel->pending--;
+            timer->callback(timer, timer->data);
+        }
+    }
+}
+
+/**
+ * @brief Handles the timerfd: advances the wheel and re-arms for the next due tick.
+ */
+static void wheel_event(struct event_loop *loop, int fd, short revents, void *data) {
+    struct timer_wheel *wheel = data;
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) == -1) {
+        // Spurious wakeup; the clock comparison below is what matters
+    }
+    wheel_advance(wheel);
+    wheel_rearm(wheel);
+}
+
+/**
+ * @brief Initializes an empty wheel and registers its timerfd with the event loop.
+ *
+ * @param wheel The wheel.
+ * @param loop The event loop that drives it.
+ * @param tick_ms The wheel resolution in milliseconds.
+ */
+void timer_wheel_init(struct timer_wheel *wheel, struct event_loop *loop, int tick_ms) {
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+            slot_reset(&wheel->slots[level][slot]);
+        }
+    }
+    wheel->now = 0;
+    wheel->tick_ms = tick_ms;
+    wheel->start_ms = wheel_clock_ms();
+    wheel->pending = 0;
+    wheel->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (wheel->timerfd == -1) {
+        perror("Error creating timerfd");
+        exit(1);
+    }
+    if (event_loop_add(loop, wheel->timerfd, POLLIN, wheel_event, wheel) == -1) {
+        perror("Error registering timerfd");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Prepares an unarmed timer.
+ *
+ * @param timer The timer.
+ * @param callback Run on expiry.
+ * @param data Passed to callback.
+ */
+void timer_init(struct timer *timer, timer_callback callback, void *data) {
+    timer->next = timer->prev = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->data = data;
+    timer->pending = 0;
+}
+
+/**
+ * @brief Arms (or re-arms) a timer to fire after delay_ms.
+ *
+ * @param wheel The wheel.
+ * @param timer The timer.
+ * @param delay_ms Milliseconds from now; rounded up to whole ticks.
+ */
+void timer_add(struct timer_wheel *wheel, struct timer *timer, long long delay_ms) {
+    timer_cancel(wheel, timer);
+    if (wheel->pending == 0) {
+        wheel->now = wheel_current_tick(wheel);  // Nothing pending, so the wheel can jump straight to the present
+    }
+    long long due_ms = wheel_clock_ms() - wheel->start_ms + delay_ms;
+    timer->expires = (unsigned long long)((due_ms + wheel->tick_ms - 1) / wheel->tick_ms);
+    timer->pending = 1;
+    wheel->pending++;
+    wheel_place(wheel, timer);
+    wheel_rearm(wheel);
+}
+
+/**
+ * @brief Disarms a timer if it is pending.
+ *
+ * @param wheel The wheel.
+ * @param timer The timer.
+ */
+void timer_cancel(struct timer_wheel *wheel, struct timer *timer) {
+    if (!timer->pending) {
+        return;
+    }
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = timer->prev = NULL;
+    timer->pending = 0;
+    wheel->pending--;
+}
+
+/**
+ * @brief Returns the wheel's notion of now in milliseconds since it was created.
+ *
+ * @param wheel The wheel.
+ * @return unsigned long long Milliseconds since timer_wheel_init().
+ */
+unsigned long long timer_wheel_now_ms(const struct timer_wheel *wheel) {
+    return (unsigned long long)(wheel_clock_ms() - wheel->start_ms);
+}
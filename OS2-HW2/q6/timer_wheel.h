@@ -0,0 +1,54 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "event_loop.h"
+
+#define WHEEL_BITS 6                        // 64 slots per level
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4                      // 64^4 ticks of range (about 4.6 hours at 1 ms); longer delays are re-cascaded
+
+struct timer;
+
+/**
+ * @brief Callback run when a timer expires. The timer is no longer pending when it runs.
+ *
+ * @param timer The expired timer.
+ * @param data The pointer given to timer_init().
+ */
+typedef void (*timer_callback)(struct timer *timer, void *data);
+
+/**
+ * @brief A timer embedded in its owner (e.g. a session), so arming it never allocates.
+ */
+struct timer {
+    struct timer *next;          // Next timer in the same slot
+    struct timer *prev;          // Previous timer in the same slot
+    unsigned long long expires;  // Expiry, in wheel ticks
+    timer_callback callback;     // Run on expiry
+    void *data;                  // Passed to callback
+    int pending;                 // Set while the timer is in the wheel
+};
+
+/**
+ * @brief A hierarchical timing wheel driven by a timerfd registered in the event loop.
+ *
+ * Adding and cancelling are O(1) list operations. Level 0 holds timers due in
+ * the next 64 ticks; each higher level covers 64 times the range of the one
+ * below and is cascaded down as the wheel turns.
+ */
+struct timer_wheel {
+    struct timer slots[WHEEL_LEVELS][WHEEL_SLOTS];  // List heads (sentinels) per slot
+    unsigned long long now;      // Current tick
+    long long start_ms;          // Monotonic time of tick 0
+    int tick_ms;                 // Milliseconds per tick
+    int timerfd;                 // Armed for the next tick that can have work; idle when empty
+    unsigned long pending;       // Timers in the wheel
+};
+
+void timer_wheel_init(struct timer_wheel *wheel, struct event_loop *loop, int tick_ms);
+void timer_init(struct timer *timer, timer_callback callback, void *data);
+void timer_add(struct timer_wheel *wheel, struct timer *timer, long long delay_ms);
+void timer_cancel(struct timer_wheel *wheel, struct timer *timer);
+unsigned long long timer_wheel_now_ms(const struct timer_wheel *wheel);
+
+#endif
@@ -0,0 +1,187 @@
+#include <stdio.h>     // Writing the trace file
+#include <stdlib.h>    // Memory allocation, atexit()
+#include <unistd.h>    // getpid()
+#include <pthread.h>   // Buffer list lock
+#include <time.h>      // Monotonic clock
+#include "trace.h"
+#include "log.h"
+
+int trace_enabled = 0;  // Set by trace_init(); every recording call checks it first
+
+static const char *trace_path;                                   // Where trace_write() puts the JSON
+static long long trace_origin_ns;                                // Timestamps are relative to this
+static struct trace_buffer *trace_buffers;                       // Every thread's buffer
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;   // Protects trace_buffers
+static __thread struct trace_buffer *local_buffer;               // This thread's buffer, once it has one
+
+/**
+ * @brief Returns the calling thread's buffer, allocating and registering it on first use.
+ *
+ * @return struct trace_buffer* The buffer, or NULL if it could not be allocated.
+ */
+static struct trace_buffer *trace_buffer_get(void) {
+    if (local_buffer != NULL) {
+        return local_buffer;
+    }
+    struct trace_buffer *buffer = calloc(1, sizeof(*buffer));
+    if (buffer == NULL) {
+        return NULL;
+    }
+    buffer->events = malloc(sizeof(struct trace_event) * TRACE_BUFFER_EVENTS);
+    if (buffer->events == NULL) {
+        free(buffer);
+        return NULL;
+    }
+    buffer->capacity = TRACE_BUFFER_EVENTS;
+    atomic_init(&buffer->count, 0);
+    pthread_mutex_lock(&trace_lock);
+    buffer->next = trace_buffers;
+    trace_buffers = buffer;
+    pthread_mutex_unlock(&trace_lock);
+    local_buffer = buffer;
+    return buffer;
+}
+
+/**
+ * @brief Appends an event to the calling thread's buffer.
+ */
+static void trace_add(const char *name, int session, long long start_ns, long long duration_ns,
+                      const char *arg_name, long long arg_value, const char *detail) {
+    struct trace_buffer *buffer = trace_buffer_get();
+    if (buffer == NULL) {
+        return;
+    }
+    size_t count = atomic_load_explicit(&buffer->count, memory_order_relaxed);
+    if (count == buffer->capacity) {
+        buffer->dropped++;
+        return;
+    }
+    struct trace_event *event = &buffer->events[count];
+    event->name = name;
+    event->arg_name = arg_name;
+    event->detail = detail;
+    event->arg_value = arg_value;
+    event->start_ns = start_ns;
+    event->duration_ns = duration_ns;
+    event->session = session;
+    atomic_store_explicit(&buffer->count, count + 1, memory_order_release);  // Publishes the event to trace_write()
+}
+
+/**
+ * @brief Turns tracing on and preallocates the calling thread's buffer; the trace is written at exit.
+ *
+ * @param path The Chrome/Perfetto JSON file to write.
+ */
+void trace_init(const char *path) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    trace_origin_ns = (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    trace_path = path;
+    if (trace_buffer_get() == NULL) {
+        perror("Error allocating the trace buffer");
+        exit(EXIT_FAILURE);
+    }
+    trace_enabled = 1;
+    atexit(trace_write);
+}
+
+/**
+ * @brief Records something that happened at one moment.
+ *
+ * @param name The event's name.
+ * @param session The session it belongs to, 0 for none.
+ * @param at_ns Monotonic time it happened.
+ * @param arg_name Name of a numeric argument, or NULL.
+ * @param arg_value The argument's value.
+ */
+void trace_instant(const char *name, int session, long long at_ns, const char *arg_name, long long arg_value) {
+    if (trace_enabled) {
+        trace_add(name, session, at_ns, -1, arg_name, arg_value, NULL);
+    }
+}
+
+/**
+ * @brief Records something that took time.
+ *
+ * @param name The event's name.
+ * @param session The session it belongs to, 0 for none.
+ * @param start_ns Monotonic time it started.
+ * @param end_ns Monotonic time it ended.
+ * @param arg_name Name of a numeric argument, or NULL.
+ * @param arg_value The argument's value.
+ */
+void trace_span(const char *name, int session, long long start_ns, long long end_ns,
+                const char *arg_name, long long arg_value) {
+    if (trace_enabled) {
+        trace_add(name, session, start_ns, end_ns - start_ns, arg_name, arg_value, NULL);
+    }
+}
+
+/**
+ * @brief Records an instant event carrying a short text, such as which deadline expired.
+ *
+ * @param detail A string literal.
+ */
+void trace_note(const char *name, int session, long long at_ns, const char *detail) {
+    if (trace_enabled) {
+        trace_add(name, session, at_ns, -1, NULL, 0, detail);
+    }
+}
+
+/**
+ * @brief Writes every recorded event as a Chrome trace (JSON object format). Registered with atexit().
+ *
+ * Each session is a thread of the mync process, named "Session N", so
+ * Perfetto or chrome://tracing shows one timeline row per session.
+ */
+void trace_write(void) {
+    if (!trace_enabled) {
+        return;
+    }
+    trace_enabled = 0;
+    FILE *out = fopen(trace_path, "w");
+    if (out == NULL) {
+        log_error("Error writing trace %s", trace_path);
+        return;
+    }
+    int pid = getpid();
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"mync\"}}", pid);
+
+    size_t written = 0;
+    unsigned long long dropped = 0;
+    int named_max = 0;  // Sessions 1..named_max already have a thread_name record
+    pthread_mutex_lock(&trace_lock);
+    for (struct trace_buffer *buffer = trace_buffers; buffer != NULL; buffer = buffer->next) {
+        size_t count = atomic_load_explicit(&buffer->count, memory_order_acquire);
+        dropped += buffer->dropped;
+        for (size_t i = 0; i < count; i++) {
+            struct trace_event *event = &buffer->events[i];
+            while (named_max < event->session) {
+                named_max++;
+                fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                        "\"args\":{\"name\":\"Session %d\"}}", pid, named_max, named_max);
+            }
+            double ts_us = (event->start_ns - trace_origin_ns) / 1000.0;
+            if (event->duration_ns >= 0) {
+                fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                        event->name, pid, event->session, ts_us, event->duration_ns / 1000.0);
+            } else {
+                fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f",
+                        event->name, pid, event->session, ts_us);
+            }
+            if (event->arg_name != NULL) {
+                fprintf(out, ",\"args\":{\"%s\":%lld}}", event->arg_name, event->arg_value);
+            } else if (event->detail != NULL) {
+                fprintf(out, ",\"args\":{\"detail\":\"%s\"}}", event->detail);
+            } else {
+                fprintf(out, "}");
+            }
+            written++;
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    log_info("Trace: %zu events written to %s, %llu dropped", written, trace_path, dropped);
+}
@@ -0,0 +1,42 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>     // size_t
+#include <stdatomic.h>  // Event counts read by the exit-time writer
+
+#define TRACE_BUFFER_EVENTS 65536  // Events kept per thread; later ones are counted as dropped
+
+/**
+ * @brief One timeline event. Names and texts are string literals, so only pointers are stored.
+ */
+struct trace_event {
+    const char *name;       // Event name shown on the timeline
+    const char *arg_name;   // Name of the numeric argument, or NULL
+    const char *detail;     // Free-text argument, or NULL
+    long long arg_value;    // Value of the numeric argument
+    long long start_ns;     // Monotonic time the event started (or happened)
+    long long duration_ns;  // Length of a span, -1 for an instant
+    int session;            // Session the event belongs to, 0 for none
+};
+
+/**
+ * @brief A thread's preallocated event buffer, linked into the trace's list on first use.
+ */
+struct trace_buffer {
+    struct trace_event *events;  // capacity slots
+    _Atomic size_t count;        // Events recorded
+    size_t capacity;             // Slots in events
+    unsigned long long dropped;  // Events lost to a full buffer
+    struct trace_buffer *next;   // Next thread's buffer
+};
+
+extern int trace_enabled;
+
+void trace_init(const char *path);
+void trace_instant(const char *name, int session, long long at_ns, const char *arg_name, long long arg_value);
+void trace_span(const char *name, int session, long long start_ns, long long end_ns,
+                const char *arg_name, long long arg_value);
+void trace_note(const char *name, int session, long long at_ns, const char *detail);
+void trace_write(void);
+
+#endif
@@ -2,8 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-
-#define SIZE 3  // Define the size of the Tic-Tac-Toe board
+#include "ttt.h"
+#include "probes.h"  // USDT probes: ttt:ai_move, ttt:player_move, ttt:game_end
 
 /**
  * @brief Initializes the Tic-Tac-Toe board with empty spaces.
@@ -141,6 +141,7 @@ void makeAIMove(char board[SIZE][SIZE], const char *strategy, char aiMark) {
 
         if (board[row][col] == ' ') {
             board[row][col] = aiMark;  // Place the AI's mark on the board
+            PROBE1(ttt, ai_move, strategy[i] - '0');
             printf("%d\n", strategy[i] - '0');  // Print the chosen slot number (1-9)
             fflush(stdout);  // Flush after printing the AI move
             return;  // Return after making the move
@@ -172,6 +173,7 @@ void makePlayerMove(char board[SIZE][SIZE], char playerMark) {
 
         if (board[row][col] == ' ') {
             board[row][col] = playerMark;  // Place the player's mark on the board
+            PROBE1(ttt, player_move, move);
             return;  // Exit the function after a valid move is made
         } else {
             printf("That spot is already taken. Try again.\n");
@@ -180,6 +182,7 @@ void makePlayerMove(char board[SIZE][SIZE], char playerMark) {
     }
 }
 
+#ifndef TTT_NO_MAIN  // mync links the game rules without main() (-g)
 /**
  * @brief The main function for the Tic-Tac-Toe game.
  * 
@@ -218,12 +221,14 @@ int main(int argc, char *argv[]) {
         if (isWinningMove(board, aiMark)) {
             printf("AI win\n");
             fflush(stdout);  // Flush after printing AI win message
+            PROBE1(ttt, game_end, 1);  // 1: AI win, -1: AI lost, 0: draw
             break;  // Exit the loop
         }
 
         if (isBoardFull(board)) {
             printf("DRAW\n");
             fflush(stdout);  // Flush after printing draw message
+            PROBE1(ttt, game_end, 0);
             break;  // Exit the loop
         }
 
@@ -233,15 +238,18 @@ int main(int argc, char *argv[]) {
         if (isWinningMove(board, playerMark)) {
             printf("AI lost\n");
             fflush(stdout);  // Flush after printing AI lost message
+            PROBE1(ttt, game_end, -1);
             break;  // Exit the loop
         }
 
         if (isBoardFull(board)) {
             printf("DRAW\n");
             fflush(stdout);  // Flush after printing draw message
+            PROBE1(ttt, game_end, 0);
             break;  // Exit the loop
         }
     }
 
     return 0;  // Return success
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,15 @@
+#ifndef TTT_H
+#define TTT_H
+
+#define SIZE 3  // Define the size of the Tic-Tac-Toe board
+
+void initializeBoard(char board[SIZE][SIZE]);
+void displayBoard(char board[SIZE][SIZE]);
+int validateStrategy(const char *strategy);
+void getBoardIndices(int number, int *row, int *col);
+int isWinningMove(char board[SIZE][SIZE], char player);
+int isBoardFull(char board[SIZE][SIZE]);
+void makeAIMove(char board[SIZE][SIZE], const char *strategy, char aiMark);
+void makePlayerMove(char board[SIZE][SIZE], char playerMark);
+
+#endif
@@ -0,0 +1,241 @@
+#include <stdio.h>         // Standard I/O library
+#include <stdlib.h>        // Standard library for general functions
+#include <unistd.h>        // sysconf()
+#include <string.h>        // String manipulation functions
+#include <getopt.h>        // Command line option parsing
+#include "ttt.h"           // Game rules
+#include "ttt_search.h"    // Minimax baseline
+#include "work_pool.h"     // Work-stealing pool
+
+#define STRATEGY_COUNT 362880  // 9!: every order of the nine slots
+#define DEFAULT_GRAIN 256      // Strategies evaluated per parallel_for slice
+
+/**
+ * @brief Outcomes of one AI over every line of play the player can choose.
+ */
+struct outcome {
+    unsigned short wins;    // Lines the AI wins
+    unsigned short losses;  // Lines the AI loses
+    unsigned short draws;   // Lines that fill the board
+};
+
+/**
+ * @brief What the evaluation shares with its tasks.
+ */
+struct evaluation {
+    struct outcome *outcomes;  // One per strategy index
+    struct work_pool *pool;    // Pool for the minimax baseline's searches, or NULL
+};
+
+/**
+ * @brief Writes the strategy with a given index (its rank among the 9! slot orders).
+ *
+ * @param index Index between 0 and STRATEGY_COUNT - 1.
+ * @param strategy Receives 9 digits and a terminator.
+ */
+void strategy_of_index(long index, char strategy[10]) {
+    char slots[] = "123456789";
+    int left = 9;
+    long factorial = STRATEGY_COUNT;
+    for (int i = 0; i < 9; i++) {
+        factorial /= left;
+        int pick = index / factorial;
+        index %= factorial;
+        strategy[i] = slots[pick];
+        memmove(slots + pick, slots + pick + 1, left - pick);  // Includes the terminator
+        left--;
+    }
+    strategy[9] = '\0';
+}
+
+/**
+ * @brief Plays the AI's next move: the strategy's first free slot, or a minimax search without a strategy.
+ */
+void ai_move(char board[SIZE][SIZE], const char *strategy, struct work_pool *pool) {
+    int row, col;
+    if (strategy == NULL) {
+        getBoardIndices(ttt_best_move(board, 'X', 'O', pool), &row, &col);
+        board[row][col] = 'X';
+        return;
+    }
+    for (int i = 0; i < 9; i++) {
+        getBoardIndices(strategy[i] - '0', &row, &col);
+        if (board[row][col] == ' ') {
+            board[row][col] = 'X';
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Plays out every game from a position where the AI is to move, as ttt's main loop would.
+ *
+ * @param board The board, restored before returning.
+ * @param strategy The AI's strategy, or NULL for minimax.
+ * @param pool Pool for minimax searches, or NULL.
+ * @param outcome Accumulates the result of each line.
+ */
+void play_all_lines(char board[SIZE][SIZE], const char *strategy, struct work_pool *pool, struct outcome *outcome) {
+    char saved[SIZE][SIZE];
+    memcpy(saved, board, sizeof(saved));
+    ai_move(board, strategy, pool);
+    if (isWinningMove(board, 'X')) {
+        outcome->wins++;
+    } else if (isBoardFull(board)) {
+        outcome->draws++;
+    } else {
+        for (int move = 1; move <= 9; move++) {
+            int row, col;
+            getBoardIndices(move, &row, &col);
+            if (board[row][col] != ' ') {
+                continue;
+            }
+            board[row][col] = 'O';
+            if (isWinningMove(board, 'O')) {
+                outcome->losses++;
+            } else if (isBoardFull(board)) {
+                outcome->draws++;
+            } else {
+                play_all_lines(board, strategy, pool, outcome);
+            }
+            board[row][col] = ' ';
+        }
+    }
+    memcpy(board, saved, sizeof(saved));
+}
+
+/**
+ * @brief parallel_for body: evaluates a slice of strategies.
+ */
+void evaluate_strategies(void *arg, long begin, long end) {
+    struct evaluation *evaluation = arg;
+    for (long index = begin; index < end; index++) {
+        char strategy[10];
+        char board[SIZE][SIZE];
+        strategy_of_index(index, strategy);
+        initializeBoard(board);
+        struct outcome *outcome = &evaluation->outcomes[index];
+        memset(outcome, 0, sizeof(*outcome));
+        play_all_lines(board, strategy, NULL, outcome);
+    }
+}
+
+/**
+ * @brief Orders strategies by fewest losing lines, then most winning lines, then index.
+ */
+int better(const struct outcome *outcomes, long a, long b) {
+    if (outcomes[a].losses != outcomes[b].losses) {
+        return outcomes[a].losses < outcomes[b].losses;
+    }
+    if (outcomes[a].wins != outcomes[b].wins) {
+        return outcomes[a].wins > outcomes[b].wins;
+    }
+    return a < b;
+}
+
+/**
+ * @brief Evaluates ttt strategies against every possible player, on a work-stealing pool.
+ *
+ * For each AI strategy (every order of the nine slots, or the first -n of
+ * them) every line of play the player could choose is played out with ttt's
+ * rules, and the strategies losing the fewest lines are reported along with
+ * the minimax AI as a baseline and each worker's utilization.
+ */
+int main(int argc, char *argv[]) {
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    long count = STRATEGY_COUNT;
+    long grain = DEFAULT_GRAIN;
+    int top = 10;
+    int option;
+    while ((option = getopt(argc, argv, "w:n:g:t:")) != -1) {
+        switch (option) {
+            case 'w':
+                workers = atol(optarg);
+                break;
+            case 'n':
+                count = atol(optarg);
+                break;
+            case 'g':
+                grain = atol(optarg);
+                break;
+            case 't':
+                top = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-w workers] [-n strategies] [-g grain] [-t top]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (count < 1 || count > STRATEGY_COUNT || grain < 1 || top < 0) {
+        fprintf(stderr, "Usage: %s [-w workers] [-n strategies] [-g grain] [-t top]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    struct work_pool pool;
+    if (work_pool_init(&pool, (int)workers) == -1) {
+        fprintf(stderr, "Invalid worker count: %ld (1-%d)\n", workers, WORK_POOL_MAX_WORKERS);
+        exit(EXIT_FAILURE);
+    }
+    struct evaluation evaluation;
+    evaluation.outcomes = malloc(sizeof(struct outcome) * count);
+    evaluation.pool = &pool;
+    if (evaluation.outcomes == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    long long started_ns = work_pool_now_ns();
+    work_pool_parallel_for(&pool, 0, count, grain, evaluate_strategies, &evaluation);
+    long long elapsed_ns = work_pool_now_ns() - started_ns;
+
+    // Pick the best strategies with a partial selection; top is small
+    long *best = malloc(sizeof(long) * (top > 0 ? top : 1));
+    int found = 0;
+    long unbeaten = 0;
+    for (long index = 0; index < count; index++) {
+        unbeaten += evaluation.outcomes[index].losses == 0;
+        int position = found < top ? found++ : top;
+        while (position > 0 && better(evaluation.outcomes, index, best[position - 1])) {
+            if (position < top) {
+                best[position] = best[position - 1];
+            }
+            position--;
+        }
+        if (position < top) {
+            best[position] = index;
+        }
+    }
+
+    printf("Evaluated %ld strategies on %d workers in %.3f s (%.0f strategies/s)\n",
+           count, pool.worker_count, elapsed_ns / 1e9, count / (elapsed_ns / 1e9));
+    printf("Strategies the player can never beat: %ld\n", unbeaten);
+    printf("%-10s %6s %6s %6s\n", "strategy", "wins", "losses", "draws");
+    for (int i = 0; i < found; i++) {
+        char strategy[10];
+        strategy_of_index(best[i], strategy);
+        struct outcome *outcome = &evaluation.outcomes[best[i]];
+        printf("%-10s %6u %6u %6u\n", strategy, outcome->wins, outcome->losses, outcome->draws);
+    }
+
+    // The minimax AI searches each of its root moves as a task of one group
+    struct outcome baseline;
+    memset(&baseline, 0, sizeof(baseline));
+    char board[SIZE][SIZE];
+    initializeBoard(board);
+    play_all_lines(board, NULL, &pool, &baseline);
+    printf("%-10s %6u %6u %6u\n", TTT_MINIMAX, baseline.wins, baseline.losses, baseline.draws);
+
+    printf("\n%-6s %10s %10s %14s %8s %12s\n", "worker", "tasks", "steals", "steal_attempts", "sleeps", "utilization");
+    for (int i = 0; i < pool.worker_count; i++) {
+        struct work_worker_stats *stats = &pool.workers[i].stats;
+        printf("%-6d %10llu %10llu %14llu %8llu %11.1f%%\n", i,
+               (unsigned long long)stats->tasks, (unsigned long long)stats->steals,
+               (unsigned long long)stats->steal_attempts, (unsigned long long)stats->sleeps,
+               work_pool_utilization(&pool, i) * 100);
+    }
+
+    free(best);
+    free(evaluation.outcomes);
+    work_pool_destroy(&pool);
+    return 0;
+}
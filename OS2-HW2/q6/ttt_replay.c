@@ -0,0 +1,277 @@
+#include <stdio.h>         // Standard I/O library
+#include <stdlib.h>        // Standard library for general functions
+#include <string.h>        // String manipulation functions
+#include <errno.h>         // Error number definitions
+#include <getopt.h>        // Command line option parsing
+#include <time.h>          // Monotonic clock
+#include <sys/resource.h>  // getrusage(), for the peak resident set
+#include "ttt.h"           // Game rules
+#include "game_log.h"      // The game log mync writes (-R)
+
+/*
+ * Replays a game log through ttt's rules: every move is played on a board,
+ * the AI's moves are checked against its strategy (minimax games are
+ * checked for legal moves and their result only), and each game's result
+ * is recomputed and compared with the logged one. Statistics are
+ * aggregated per strategy. The log is read block by block, mapped (-m) or
+ * streamed, so memory stays bounded whatever its size.
+ */
+
+#define STRATEGY_TABLE 1024    // Strategies tracked separately; the rest are counted together
+#define MISMATCH_REPORT 10     // Mismatched games printed in full
+
+/**
+ * @brief Statistics of the games one strategy played.
+ */
+struct strategy_stats {
+    char strategy[GAME_LOG_STRATEGY_LEN];  // The strategy, "" for the overflow entry
+    int order;                             // A slot order (not minimax), so the AI's moves can be checked
+    unsigned long long games;              // Games played
+    unsigned long long results[4];         // Per enum game_result
+    unsigned long long moves;              // Moves played
+};
+
+/**
+ * @brief State of a replay.
+ */
+struct replay {
+    struct strategy_stats *block_stats[GAME_LOG_STRATEGIES];  // Stats of the current block's strategies
+    unsigned long long games;             // Games replayed
+    unsigned long long moves;             // Moves replayed
+    unsigned long long results[4];        // Logged results, per enum game_result
+    unsigned long long lengths[10];       // Games per number of moves
+    unsigned long long openings[10];      // Games per player's first slot (0: the player never moved)
+    unsigned long long mismatches;        // Games whose moves or result do not replay
+    int verbose;                          // Print every mismatch, not just the first few
+};
+
+struct strategy_stats strategies[STRATEGY_TABLE + 1];  // The last entry counts the strategies past the table
+int strategy_count = 0;                               // Entries used before the overflow one
+struct game_log_reader reader;                        // Static: its dedup table is large
+
+const char *result_names[] = {"draw", "ai_win", "ai_lost", "abandoned"};
+
+/**
+ * @brief Returns the stats entry of a strategy, adding it if it is new.
+ */
+struct strategy_stats *stats_of(const char *strategy) {
+    for (int i = 0; i < strategy_count; i++) {
+        if (strcmp(strategies[i].strategy, strategy) == 0) {
+            return &strategies[i];
+        }
+    }
+    if (strategy_count == STRATEGY_TABLE) {
+        return &strategies[STRATEGY_TABLE];
+    }
+    struct strategy_stats *stats = &strategies[strategy_count++];
+    snprintf(stats->strategy, sizeof(stats->strategy), "%s", strategy);
+    stats->order = validateStrategy(strategy);
+    return stats;
+}
+
+/**
+ * @brief Prints a game that did not replay as logged.
+ */
+void report_mismatch(const struct game_log_game *game, const char *why) {
+    fprintf(stderr, "Mismatch (%s): strategy %s, result %s, moves ", why, game->strategy,
+            result_names[game->result]);
+    for (int i = 0; i < game->moves; i++) {
+        fputc('0' + game->history[i], stderr);
+    }
+    fputc('\n', stderr);
+}
+
+/**
+ * @brief Replays one game on a board and checks it: legal moves, the AI's choices, then the result.
+ *
+ * @param game The logged game.
+ * @param arg The replay.
+ */
+void replay_game(const struct game_log_game *game, void *arg) {
+    struct replay *replay = arg;
+    struct strategy_stats *stats = replay->block_stats[game->strategy_index];
+    char board[SIZE][SIZE];
+    initializeBoard(board);
+    int result = GAME_ABANDONED;
+    const char *why = NULL;
+    for (int i = 0; i < game->moves && why == NULL; i++) {
+        int slot = game->history[i];
+        int row, col;
+        if (result != GAME_ABANDONED) {
+            why = "moves after the end";
+            break;
+        }
+        if (slot < 1 || slot > 9) {
+            why = "no such slot";
+            break;
+        }
+        getBoardIndices(slot, &row, &col);
+        if (board[row][col] != ' ') {
+            why = "slot taken";
+            break;
+        }
+        char mark = i % 2 == 0 ? 'X' : 'O';
+        if (mark == 'X' && stats->order) {
+            // The AI plays its strategy's first free slot, as makeAIMove() does
+            int expected_row = 0, expected_col = 0;
+            for (int j = 0; j < 9; j++) {
+                getBoardIndices(stats->strategy[j] - '0', &expected_row, &expected_col);
+                if (board[expected_row][expected_col] == ' ') {
+                    break;
+                }
+            }
+            if (expected_row != row || expected_col != col) {
+                why = "not the strategy's move";
+                break;
+            }
+        }
+        board[row][col] = mark;
+        if (isWinningMove(board, mark)) {
+            result = mark == 'X' ? GAME_AI_WIN : GAME_AI_LOST;
+        } else if (isBoardFull(board)) {
+            result = GAME_DRAW;
+        }
+    }
+    if (why == NULL && result != game->result) {
+        why = "result differs";
+    }
+    if (why != NULL) {
+        if (replay->verbose || replay->mismatches < MISMATCH_REPORT) {
+            report_mismatch(game, why);
+        }
+        replay->mismatches++;
+    }
+
+    replay->games++;
+    replay->moves += game->moves;
+    replay->results[game->result]++;
+    replay->lengths[game->moves]++;
+    replay->openings[game->moves >= 2 ? game->history[1] : 0]++;
+    stats->games++;
+    stats->results[game->result]++;
+    stats->moves += game->moves;
+}
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds.
+ */
+long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Compares strategy stats by games played, most first.
+ */
+int by_games(const void *a, const void *b) {
+    const struct strategy_stats *x = a, *y = b;
+    return x->games < y->games ? 1 : x->games > y->games ? -1 : 0;
+}
+
+/**
+ * @brief Replays a game log and prints its statistics.
+ *
+ * Options: -m maps the log instead of streaming it, -s N prints the N
+ * strategies that played most (10), -v prints every mismatched game.
+ * Exits with 1 if any game did not replay as logged, 2 on errors.
+ */
+int main(int argc, char *argv[]) {
+    int use_mmap = 0;
+    int top = 10;
+    struct replay replay;
+    memset(&replay, 0, sizeof(replay));
+    int option;
+    while ((option = getopt(argc, argv, "ms:v")) != -1) {
+        switch (option) {
+            case 'm':
+                use_mmap = 1;
+                break;
+            case 's':
+                top = atoi(optarg);
+                break;
+            case 'v':
+                replay.verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-m] [-s strategies] [-v] <game log>\n", argv[0]);
+                exit(2);
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-m] [-s strategies] [-v] <game log>\n", argv[0]);
+        exit(2);
+    }
+    const char *path = argv[optind];
+    if (game_log_reader_open(&reader, path, use_mmap) == -1) {
+        fprintf(stderr, "Error opening game log %s: %s\n", path,
+                errno == EINVAL ? "not a game log" : strerror(errno));
+        exit(2);
+    }
+
+    long long start = now_ns();
+    unsigned long long blocks = 0, dedup_blocks = 0;
+    int status;
+    while ((status = game_log_next_block(&reader)) == 1) {
+        for (int i = 0; i < reader.header.strategy_count; i++) {
+            replay.block_stats[i] = stats_of(reader.strategies[i]);
+        }
+        if (game_log_block_games(&reader, replay_game, &replay) == -1) {
+            status = -1;
+            break;
+        }
+        blocks++;
+        dedup_blocks += reader.header.codec == GAME_LOG_DEDUP;
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    size_t bytes = reader.offset;
+    int torn = reader.torn;
+    game_log_reader_close(&reader);
+    if (status == -1) {
+        fprintf(stderr, "Error reading game log %s at byte %zu: %s\n", path, bytes,
+                errno == EINVAL ? "corrupt block" : strerror(errno));
+        exit(2);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("Log %s (%s): %zu bytes, %llu blocks (%llu deduplicated)%s\n", path, use_mmap ? "mapped" : "streamed",
+           bytes, blocks, dedup_blocks, torn ? ", ends in an incomplete block" : "");
+    printf("Replayed %llu games, %llu moves in %.3f s: %.0f moves/s, %.0f games/s, %.2f bytes/move, peak RSS %ld KB\n",
+           replay.games, replay.moves, seconds, seconds > 0 ? replay.moves / seconds : 0,
+           seconds > 0 ? replay.games / seconds : 0, replay.moves > 0 ? (double)bytes / replay.moves : 0,
+           usage.ru_maxrss);
+    printf("Results:");
+    for (int i = 0; i < 4; i++) {
+        printf(" %s %llu", result_names[i], replay.results[i]);
+    }
+    printf("; mismatches %llu\n", replay.mismatches);
+    printf("Moves per game:");
+    for (int i = 1; i < 10; i++) {
+        printf(" %d:%llu", i, replay.lengths[i]);
+    }
+    printf("\nPlayer's first slot:");
+    for (int i = 1; i < 10; i++) {
+        printf(" %d:%llu", i, replay.openings[i]);
+    }
+    printf("\n");
+
+    qsort(strategies, strategy_count, sizeof(strategies[0]), by_games);
+    printf("%-10s %12s %8s %8s %8s %10s %10s\n", "strategy", "games", "win%", "loss%", "draw%", "abandoned%",
+           "moves/game");
+    for (int i = 0; i <= strategy_count; i++) {
+        struct strategy_stats *stats = &strategies[i];
+        if (i == strategy_count && stats->games == 0) {
+            break;  // No strategies past the table
+        }
+        if (i >= top && i < strategy_count) {
+            continue;
+        }
+        double games = stats->games > 0 ? stats->games : 1;
+        printf("%-10s %12llu %8.2f %8.2f %8.2f %10.2f %10.2f\n", i == strategy_count ? "(others)" : stats->strategy,
+               stats->games, 100 * stats->results[GAME_AI_WIN] / games, 100 * stats->results[GAME_AI_LOST] / games,
+               100 * stats->results[GAME_DRAW] / games, 100 * stats->results[GAME_ABANDONED] / games,
+               stats->moves / games);
+    }
+    return replay.mismatches > 0 ? 1 : 0;
+}
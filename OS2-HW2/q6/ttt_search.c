@@ -0,0 +1,121 @@
+#include <string.h>  // memcpy()
+#include "ttt_search.h"
+
+#define TTT_SCORE_WIN 10  // Score of a win on the move that completes it; sooner wins score higher
+
+/**
+ * @brief Scores a position by exhaustive alpha-beta search, from the AI's point of view.
+ *
+ * @param board The Tic-Tac-Toe board.
+ * @param toMove The mark about to move.
+ * @param aiMark The AI's mark.
+ * @param playerMark The player's mark.
+ * @param depth Moves made since the search started.
+ * @param alpha Score the AI is already assured of.
+ * @param beta Score the player is already assured of.
+ * @return int Positive if the AI wins with best play, negative if it loses, 0 for a draw.
+ */
+int ttt_minimax(char board[SIZE][SIZE], char toMove, char aiMark, char playerMark, int depth, int alpha, int beta) {
+    if (isWinningMove(board, aiMark)) {
+        return TTT_SCORE_WIN - depth;
+    }
+    if (isWinningMove(board, playerMark)) {
+        return depth - TTT_SCORE_WIN;
+    }
+    if (isBoardFull(board)) {
+        return 0;
+    }
+
+    int maximizing = toMove == aiMark;
+    int best = maximizing ? -TTT_SCORE_WIN - 1 : TTT_SCORE_WIN + 1;
+    for (int slot = 1; slot <= 9 && alpha < beta; slot++) {
+        int row, col;
+        getBoardIndices(slot, &row, &col);
+        if (board[row][col] != ' ') {
+            continue;
+        }
+        board[row][col] = toMove;
+        int score = ttt_minimax(board, maximizing ? playerMark : aiMark, aiMark, playerMark, depth + 1, alpha, beta);
+        board[row][col] = ' ';
+        if (maximizing) {
+            best = score > best ? score : best;
+            alpha = best > alpha ? best : alpha;
+        } else {
+            best = score < best ? score : best;
+            beta = best < beta ? best : beta;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief One root move searched as a pool task.
+ */
+struct ttt_root_move {
+    struct work_task task;    // Task searching this move
+    char board[SIZE][SIZE];   // Board after the move, private to the task
+    char aiMark;              // The AI's mark
+    char playerMark;          // The player's mark
+    int slot;                 // The move (1-9)
+    int score;                // Result of the search
+};
+
+/**
+ * @brief Task body: scores the position after one root move.
+ */
+static void ttt_search_root_move(void *arg) {
+    struct ttt_root_move *move = arg;
+    move->score = ttt_minimax(move->board, move->playerMark, move->aiMark, move->playerMark, 1,
+                              -TTT_SCORE_WIN - 1, TTT_SCORE_WIN + 1);
+}
+
+/**
+ * @brief Finds the AI's best move, the lowest-numbered one among equally good moves.
+ *
+ * With a pool, each legal root move is searched as a task of one group,
+ * so the subtrees run on as many workers as are free.
+ *
+ * @param board The Tic-Tac-Toe board.
+ * @param aiMark The AI's mark.
+ * @param playerMark The player's mark.
+ * @param pool Pool to search on, or NULL to search on the calling thread.
+ * @return int The slot to play (1-9), or 0 if the board is full.
+ */
+int ttt_best_move(char board[SIZE][SIZE], char aiMark, char playerMark, struct work_pool *pool) {
+    struct ttt_root_move moves[9];
+    int count = 0;
+    for (int slot = 1; slot <= 9; slot++) {
+        int row, col;
+        getBoardIndices(slot, &row, &col);
+        if (board[row][col] != ' ') {
+            continue;
+        }
+        struct ttt_root_move *move = &moves[count++];
+        memcpy(move->board, board, sizeof(move->board));
+        move->board[row][col] = aiMark;
+        move->aiMark = aiMark;
+        move->playerMark = playerMark;
+        move->slot = slot;
+    }
+
+    if (pool != NULL && count > 1) {
+        struct task_group group;
+        task_group_init(&group, pool);
+        for (int i = 0; i < count; i++) {
+            task_group_spawn(&group, &moves[i].task, ttt_search_root_move, &moves[i]);
+        }
+        task_group_wait(&group);
+    } else {
+        for (int i = 0; i < count; i++) {
+            ttt_search_root_move(&moves[i]);
+        }
+    }
+
+    int best = 0;
+    for (int i = 1; i < count; i++) {
+        if (moves[i].score > moves[best].score) {
+            best = i;
+        }
+    }
+    return count > 0 ? moves[best].slot : 0;
+}
@@ -0,0 +1,12 @@
+#ifndef TTT_SEARCH_H
+#define TTT_SEARCH_H
+
+#include "ttt.h"
+#include "work_pool.h"
+
+#define TTT_MINIMAX "minimax"  // -g strategy that searches for the best move instead of following a slot order
+
+int ttt_minimax(char board[SIZE][SIZE], char toMove, char aiMark, char playerMark, int depth, int alpha, int beta);
+int ttt_best_move(char board[SIZE][SIZE], char aiMark, char playerMark, struct work_pool *pool);
+
+#endif
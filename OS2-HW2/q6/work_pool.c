@@ -0,0 +1,449 @@
+#include <stdlib.h>  // Memory allocation
+#include <string.h>  // memset()
+#include <sched.h>   // sched_yield()
+#include <signal.h>  // Keeping signals off the workers
+#include <time.h>    // Monotonic clock for busy time
+#include "work_pool.h"
+
+static __thread struct work_worker *current_worker;  // Worker running on this thread, or NULL
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds.
+ */
+long long work_pool_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Returns the calling thread's worker if it belongs to this pool, NULL otherwise.
+ */
+static struct work_worker *worker_of(struct work_pool *pool) {
+    return current_worker != NULL && current_worker->pool == pool ? current_worker : NULL;
+}
+
+/**
+ * @brief Pushes a task onto the bottom of the owner's deque.
+ *
+ * @return int 0 on success, -1 if the deque is full.
+ */
+static int deque_push(struct work_deque *deque, struct work_task *task) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= WORK_DEQUE_SIZE) {
+        return -1;
+    }
+    atomic_store_explicit(&deque->slots[bottom & (WORK_DEQUE_SIZE - 1)], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return 0;
+}
+
+/**
+ * @brief Pops the newest task from the bottom of the owner's deque.
+ *
+ * @return struct work_task* The task, or NULL if the deque is empty or a thief took the last one.
+ */
+static struct work_task *deque_take(struct work_deque *deque) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+    struct work_task *task = atomic_load_explicit(&deque->slots[bottom & (WORK_DEQUE_SIZE - 1)],
+                                                  memory_order_relaxed);
+    if (top == bottom) {
+        // The last task: race thieves for it through top
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed)) {
+            task = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+/**
+ * @brief Steals the oldest task from the top of another worker's deque.
+ *
+ * @return struct work_task* The task, or NULL if the deque is empty or another thief won.
+ */
+static struct work_task *deque_steal(struct work_deque *deque) {
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return NULL;
+    }
+    struct work_task *task = atomic_load_explicit(&deque->slots[top & (WORK_DEQUE_SIZE - 1)],
+                                                  memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+/**
+ * @brief Returns whether any deque or the injection queue holds a task.
+ */
+static int work_available(struct work_pool *pool) {
+    if (atomic_load(&pool->injected_count) > 0) {
+        return 1;
+    }
+    for (int i = 0; i < pool->worker_count; i++) {
+        struct work_deque *deque = &pool->workers[i].deque;
+        if (atomic_load(&deque->top) < atomic_load(&deque->bottom)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Wakes one sleeping worker, if any, after work was made available.
+ */
+static void work_pool_notify(struct work_pool *pool) {
+    atomic_thread_fence(memory_order_seq_cst);  // Pairs with the sleeper's increment of sleeping
+    if (atomic_load_explicit(&pool->sleeping, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/**
+ * @brief Finds a task: the caller's own deque first, then the injection queue, then a random victim.
+ *
+ * @param pool The pool.
+ * @param self The calling worker, or NULL for a thread outside the pool.
+ * @param seed Victim selection state.
+ * @return struct work_task* A task, or NULL if none was found.
+ */
+static struct work_task *find_work(struct work_pool *pool, struct work_worker *self, unsigned int *seed) {
+    struct work_task *task;
+    if (self != NULL && (task = deque_take(&self->deque)) != NULL) {
+        return task;
+    }
+    if (atomic_load_explicit(&pool->injected_count, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        task = pool->injected_head;
+        if (task != NULL) {
+            pool->injected_head = task->next;
+            if (pool->injected_head == NULL) {
+                pool->injected_tail = NULL;
+            }
+            atomic_fetch_sub(&pool->injected_count, 1);
+        }
+        pthread_mutex_unlock(&pool->lock);
+        if (task != NULL) {
+            return task;
+        }
+    }
+    int start = rand_r(seed) % pool->worker_count;
+    for (int i = 0; i < pool->worker_count; i++) {
+        struct work_worker *victim = &pool->workers[(start + i) % pool->worker_count];
+        if (victim == self) {
+            continue;
+        }
+        if (self != NULL) {
+            atomic_fetch_add_explicit(&self->stats.steal_attempts, 1, memory_order_relaxed);
+        }
+        if ((task = deque_steal(&victim->deque)) != NULL) {
+            if (self != NULL) {
+                atomic_fetch_add_explicit(&self->stats.steals, 1, memory_order_relaxed);
+            }
+            return task;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs a task and marks it finished in its group.
+ *
+ * The task's storage may be reused as soon as its group's count drops, so
+ * nothing in it is touched afterwards.
+ *
+ * @param self The worker running it, or NULL for a thread outside the pool.
+ * @param task The task.
+ */
+static void run_task(struct work_worker *self, struct work_task *task) {
+    struct task_group *group = task->group;
+    // Only the outermost task is timed; tasks run while it waits for its group are inside its time
+    long long started_ns = self != NULL && self->depth++ == 0 ? work_pool_now_ns() : 0;
+    task->run(task->arg);
+    if (self != NULL) {
+        atomic_fetch_add_explicit(&self->stats.tasks, 1, memory_order_relaxed);
+        if (--self->depth == 0) {
+            atomic_fetch_add_explicit(&self->stats.busy_ns, work_pool_now_ns() - started_ns,
+                                      memory_order_relaxed);
+        }
+    }
+    if (group != NULL) {
+        atomic_fetch_sub_explicit(&group->pending, 1, memory_order_release);
+    }
+}
+
+/**
+ * @brief Worker thread: runs tasks until the pool stops, sleeping while there are none.
+ */
+static void *worker_main(void *arg) {
+    struct work_worker *self = arg;
+    struct work_pool *pool = self->pool;
+    current_worker = self;
+    int idle = 0;
+    while (!atomic_load_explicit(&pool->stopping, memory_order_relaxed)) {
+        struct work_task *task = find_work(pool, self, &self->seed);
+        if (task != NULL) {
+            run_task(self, task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < WORK_IDLE_SPINS) {
+            sched_yield();
+            continue;
+        }
+        // Announce sleeping before the final check, so a submitter either sees us or we see its task
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->sleeping, 1);
+        if (!atomic_load(&pool->stopping) && !work_available(pool)) {
+            atomic_fetch_add_explicit(&self->stats.sleeps, 1, memory_order_relaxed);
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        atomic_fetch_sub(&pool->sleeping, 1);
+        pthread_mutex_unlock(&pool->lock);
+        idle = 0;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Starts a pool of worker threads.
+ *
+ * @param pool The pool.
+ * @param workers Number of worker threads (1 to WORK_POOL_MAX_WORKERS).
+ * @return int 0 on success, -1 on failure.
+ */
+int work_pool_init(struct work_pool *pool, int workers) {
+    if (workers < 1 || workers > WORK_POOL_MAX_WORKERS) {
+        return -1;
+    }
+    // Aligned so each deque's top and bottom sit on their own cache lines
+    pool->workers = aligned_alloc(64, sizeof(struct work_worker) * workers);
+    if (pool->workers == NULL) {
+        return -1;
+    }
+    memset(pool->workers, 0, sizeof(struct work_worker) * workers);
+    pool->worker_count = workers;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pool->injected_head = pool->injected_tail = NULL;
+    atomic_init(&pool->injected_count, 0);
+    atomic_init(&pool->sleeping, 0);
+    atomic_init(&pool->stopping, 0);
+    pool->started_ns = work_pool_now_ns();
+
+    // Workers take no signals, so signalfd and EINTR-driven handlers keep working on the creating thread
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    int result = 0;
+    for (int i = 0; i < workers; i++) {
+        struct work_worker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->index = i;
+        worker->seed = (unsigned int)pool->started_ns + i;
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            pool->worker_count = i;
+            result = -1;
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (result == -1) {
+        work_pool_destroy(pool);
+    }
+    return result;
+}
+
+/**
+ * @brief Stops and joins the workers. Tasks not yet started are dropped.
+ *
+ * @param pool The pool.
+ */
+void work_pool_destroy(struct work_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->stopping, 1);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->worker_count; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->workers);
+    pool->workers = NULL;
+    pool->worker_count = 0;
+}
+
+/**
+ * @brief Queues a task: on the caller's deque from a worker, on the injection queue otherwise.
+ *
+ * @param pool The pool.
+ * @param task The task, with run, arg and group set. It must stay valid until it has run.
+ */
+void work_pool_submit(struct work_pool *pool, struct work_task *task) {
+    struct work_worker *self = worker_of(pool);
+    if (self != NULL) {
+        if (deque_push(&self->deque, task) == -1) {
+            run_task(self, task);  // Deque full: the spawner has plenty of work to share already
+            return;
+        }
+        work_pool_notify(pool);
+        return;
+    }
+    task->next = NULL;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->injected_tail != NULL) {
+        pool->injected_tail->next = task;
+    } else {
+        pool->injected_head = task;
+    }
+    pool->injected_tail = task;
+    atomic_fetch_add(&pool->injected_count, 1);
+    if (atomic_load(&pool->sleeping) > 0) {
+        pthread_cond_signal(&pool->wake);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief Initializes an empty task group.
+ *
+ * @param group The group.
+ * @param pool The pool its tasks run on.
+ */
+void task_group_init(struct task_group *group, struct work_pool *pool) {
+    group->pool = pool;
+    atomic_init(&group->pending, 0);
+}
+
+/**
+ * @brief Spawns a task in a group.
+ *
+ * @param group The group.
+ * @param task Storage for the task, owned by the caller until task_group_wait() returns.
+ * @param run The work.
+ * @param arg Passed to run.
+ */
+void task_group_spawn(struct task_group *group, struct work_task *task, void (*run)(void *arg), void *arg) {
+    task->run = run;
+    task->arg = arg;
+    task->group = group;
+    atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+    work_pool_submit(group->pool, task);
+}
+
+/**
+ * @brief Waits for every task spawned in a group, running pool tasks meanwhile instead of blocking.
+ *
+ * @param group The group.
+ */
+void task_group_wait(struct task_group *group) {
+    struct work_pool *pool = group->pool;
+    struct work_worker *self = worker_of(pool);
+    unsigned int seed = (unsigned int)(size_t)group;
+    while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+        struct work_task *task = find_work(pool, self, self != NULL ? &self->seed : &seed);
+        if (task != NULL) {
+            run_task(self, task);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+/**
+ * @brief A slice of a parallel_for range.
+ */
+struct work_range {
+    struct work_task task;                          // Task running this slice
+    struct work_pool *pool;                         // Pool the loop runs on
+    long begin;                                     // First index
+    long end;                                       // One past the last index
+    long grain;                                     // Largest slice run without splitting
+    void (*body)(void *arg, long begin, long end);  // Loop body
+    void *arg;                                      // Passed to body
+};
+
+/**
+ * @brief Runs a slice, splitting off its upper halves as stealable tasks until it is one grain.
+ *
+ * Idle workers steal the largest halves first, so work spreads in
+ * logarithmically many steps and a busy pool splits no further than it has to.
+ */
+static void work_range_run(void *arg) {
+    struct work_range *range = arg;
+    struct work_range halves[WORK_SPLIT_DEPTH];
+    struct task_group group;
+    task_group_init(&group, range->pool);
+    long begin = range->begin;
+    long end = range->end;
+    int split = 0;
+    while (end - begin > range->grain && split < WORK_SPLIT_DEPTH) {
+        long middle = begin + (end - begin) / 2;
+        halves[split] = *range;
+        halves[split].begin = middle;
+        halves[split].end = end;
+        task_group_spawn(&group, &halves[split].task, work_range_run, &halves[split]);
+        split++;
+        end = middle;
+    }
+    range->body(range->arg, begin, end);
+    task_group_wait(&group);
+}
+
+/**
+ * @brief Runs body over [begin, end) in slices of at most grain indices, on the pool and the caller.
+ *
+ * @param pool The pool.
+ * @param begin First index.
+ * @param end One past the last index.
+ * @param grain Largest slice handed to one body call (at least 1).
+ * @param body Called with disjoint slices covering the range.
+ * @param arg Passed to body.
+ */
+void work_pool_parallel_for(struct work_pool *pool, long begin, long end, long grain,
+                            void (*body)(void *arg, long begin, long end), void *arg) {
+    if (begin >= end) {
+        return;
+    }
+    struct work_range range;
+    range.pool = pool;
+    range.begin = begin;
+    range.end = end;
+    range.grain = grain > 0 ? grain : 1;
+    range.body = body;
+    range.arg = arg;
+    work_range_run(&range);
+}
+
+/**
+ * @brief Returns the share of a worker's lifetime spent running tasks.
+ *
+ * @param pool The pool.
+ * @param worker The worker's index.
+ * @return double Utilization between 0 and 1.
+ */
+double work_pool_utilization(struct work_pool *pool, int worker) {
+    long long elapsed_ns = work_pool_now_ns() - pool->started_ns;
+    if (elapsed_ns <= 0) {
+        return 0;
+    }
+    return (double)atomic_load_explicit(&pool->workers[worker].stats.busy_ns, memory_order_relaxed) / elapsed_ns;
+}
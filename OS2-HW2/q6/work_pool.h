@@ -0,0 +1,102 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <pthread.h>    // Worker threads
+#include <stdatomic.h>  // Deque indices and counters shared between workers
+
+#define WORK_POOL_MAX_WORKERS 64    // Most workers one pool can run
+#define WORK_DEQUE_SIZE 1024        // Tasks one worker's deque holds, a power of two
+#define WORK_SPLIT_DEPTH 64         // Deepest range split of one parallel_for call
+#define WORK_IDLE_SPINS 64          // Failed steal rounds before a worker sleeps
+
+struct task_group;
+
+/**
+ * @brief A unit of work. Owned by whoever spawned it until its group's wait returns.
+ */
+struct work_task {
+    void (*run)(void *arg);    // The work
+    void *arg;                 // Passed to run
+    struct task_group *group;  // Group counting it, or NULL for a detached task
+    struct work_task *next;    // Link in the injection queue
+};
+
+/**
+ * @brief A worker's double-ended queue (Chase-Lev).
+ *
+ * The owner pushes and pops at bottom without locking; other workers steal
+ * from top with a compare-and-swap, so stealing takes the oldest (usually
+ * largest) pieces of work.
+ */
+struct work_deque {
+    _Alignas(64) _Atomic long top;                       // Next index thieves take
+    _Alignas(64) _Atomic long bottom;                    // Next index the owner pushes to
+    _Atomic(struct work_task *) slots[WORK_DEQUE_SIZE];  // Ring of task pointers
+};
+
+/**
+ * @brief Per-worker utilization counters, written only by their worker.
+ */
+struct work_worker_stats {
+    _Atomic unsigned long long tasks;           // Tasks run
+    _Atomic unsigned long long steals;          // Tasks taken from other workers' deques
+    _Atomic unsigned long long steal_attempts;  // Deques tried, successful or not
+    _Atomic unsigned long long busy_ns;         // Time spent running tasks
+    _Atomic unsigned long long sleeps;          // Times the worker ran out of work and slept
+};
+
+struct work_pool;
+
+/**
+ * @brief One worker thread with its deque.
+ */
+struct work_worker {
+    struct work_pool *pool;          // Pool it belongs to
+    int index;                       // Position in the pool
+    pthread_t thread;                // The thread
+    unsigned int seed;               // Victim selection state
+    int depth;                       // Tasks running on this thread's stack, nested by waits
+    struct work_deque deque;         // Tasks this worker spawned
+    struct work_worker_stats stats;  // Utilization counters
+};
+
+/**
+ * @brief A fixed set of worker threads that share work by stealing.
+ *
+ * Tasks spawned on a worker go to its own deque; tasks spawned by other
+ * threads (the event loop, a tool's main thread) go to the injection
+ * queue. Idle workers steal from random victims before going to sleep.
+ */
+struct work_pool {
+    struct work_worker *workers;       // The workers
+    int worker_count;                  // Entries in workers
+    pthread_mutex_t lock;              // Protects the injection queue and sleeping
+    pthread_cond_t wake;               // Signalled when work is injected or the pool stops
+    struct work_task *injected_head;   // Tasks from threads outside the pool, oldest first
+    struct work_task *injected_tail;   // Newest injected task
+    _Atomic int injected_count;        // Tasks in the injection queue
+    _Atomic int sleeping;              // Workers waiting on wake
+    _Atomic int stopping;              // Set by work_pool_destroy()
+    long long started_ns;              // When the pool started, for utilization
+};
+
+/**
+ * @brief Tasks whose completion someone waits for.
+ */
+struct task_group {
+    struct work_pool *pool;  // Pool the tasks run on
+    _Atomic long pending;    // Spawned tasks not yet finished
+};
+
+int work_pool_init(struct work_pool *pool, int workers);
+void work_pool_destroy(struct work_pool *pool);
+void work_pool_submit(struct work_pool *pool, struct work_task *task);
+void task_group_init(struct task_group *group, struct work_pool *pool);
+void task_group_spawn(struct task_group *group, struct work_task *task, void (*run)(void *arg), void *arg);
+void task_group_wait(struct task_group *group);
+void work_pool_parallel_for(struct work_pool *pool, long begin, long end, long grain,
+                            void (*body)(void *arg, long begin, long end), void *arg);
+double work_pool_utilization(struct work_pool *pool, int worker);
+long long work_pool_now_ns(void);
+
+#endif